@@ -25,8 +25,12 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 #include <unistd.h>
+#if HAVE_PTHREAD
+# include <pthread.h>
+#endif
 
 #include "kdt.h"
 
@@ -274,10 +278,10 @@ static void merge (KdtHeap * h1, KdtHeap * h2,
   kdt_heap_rewind (h2);
   int r2 = kdt_heap_get (h2, &p2);
   while (r1 && r2) {
-    if ((* compar) (&p2, &p1))
-      r1 = put (h1, &p1, &hm);
-    else
+    if ((* compar) (&p1, &p2) > 0)
       r2 = put (h2, &p2, &hm);
+    else
+      r1 = put (h1, &p1, &hm);
   }
   while (r1)
     r1 = put (h1, &p1, &hm);
@@ -298,16 +302,93 @@ static double elapsed (const struct timeval * start, const struct timeval * end)
 }
 #endif
 
+/* minimum number of points for which an in-memory sort is split
+   between threads */
+#define PARALLEL_SORT_MIN 100000
+
+typedef struct {
+  KdtPoint * p;
+  long len;
+  int (* compar) (const void *, const void *);
+  int nthreads;
+} ArraySort;
+
+static void array_sort (ArraySort * a);
+
+#if HAVE_PTHREAD
+static void * array_sort_thread (void * data)
+{
+  array_sort (data);
+  return NULL;
+}
+#endif
+
+/* sorts the halves of the array in parallel then merges them */
+static void array_sort (ArraySort * a)
+{
+#if HAVE_PTHREAD
+  if (a->nthreads > 1 && a->len >= PARALLEL_SORT_MIN) {
+    long len1 = a->len/2;
+    ArraySort a1 = { a->p, len1, a->compar, a->nthreads/2 };
+    ArraySort a2 = { a->p + len1, a->len - len1, a->compar, a->nthreads - a->nthreads/2 };
+    KdtPoint * tmp = malloc (a->len*sizeof (KdtPoint));
+    pthread_t thread;
+    if (tmp && !pthread_create (&thread, NULL, array_sort_thread, &a1)) {
+      array_sort (&a2);
+      int ret = pthread_join (thread, NULL);
+      assert (ret == 0);
+      KdtPoint * p1 = a1.p, * e1 = a1.p + a1.len;
+      KdtPoint * p2 = a2.p, * e2 = a2.p + a2.len, * m = tmp;
+      while (p1 < e1 && p2 < e2)
+	*m++ = (* a->compar) (p1, p2) > 0 ? *p2++ : *p1++;
+      while (p1 < e1)
+	*m++ = *p1++;
+      while (p2 < e2)
+	*m++ = *p2++;
+      memcpy (a->p, tmp, a->len*sizeof (KdtPoint));
+      free (tmp);
+      return;
+    }
+    free (tmp);
+  }
+#endif
+  qsort (a->p, a->len, sizeof (KdtPoint), a->compar);
+}
+
 static void kdt_heap_sort (KdtHeap * h,
 			   int  (*compar)   (const void *, const void *),
-			   void (*progress) (void *), void * data)
+			   void (*progress) (void *), void * data,
+			   int nthreads);
+
+#if HAVE_PTHREAD
+typedef struct {
+  KdtHeap * h;
+  int  (*compar)   (const void *, const void *);
+  void (*progress) (void *);
+  void * data;
+  int nthreads;
+} HeapSort;
+
+static void * heap_sort_thread (void * data)
+{
+  HeapSort * s = data;
+  kdt_heap_sort (s->h, s->compar, s->progress, s->data, s->nthreads);
+  return NULL;
+}
+#endif
+
+static void kdt_heap_sort (KdtHeap * h,
+			   int  (*compar)   (const void *, const void *),
+			   void (*progress) (void *), void * data,
+			   int nthreads)
 {
 #if TIMING
   struct timeval start;
   gettimeofday (&start, NULL);
 #endif
   if (h->len == h->buflen) {
-    qsort (h->p, h->len, sizeof (KdtPoint), compar);
+    ArraySort a = { h->p, h->len, compar, nthreads };
+    array_sort (&a);
     if (progress)
       (* progress) (data);
   }
@@ -315,8 +396,22 @@ static void kdt_heap_sort (KdtHeap * h,
     KdtHeap h2;
     long buflen = h->buflen;
     kdt_heap_split (h, h->len/2, &h2);
-    kdt_heap_sort (h, compar, progress, data);
-    kdt_heap_sort (&h2, compar, progress, data);
+    /* after the split, each half has its own file and buffer: they
+       can be sorted in parallel */
+#if HAVE_PTHREAD
+    HeapSort s = { &h2, compar, progress, data, nthreads/2 };
+    pthread_t thread;
+    if (nthreads > 1 && !pthread_create (&thread, NULL, heap_sort_thread, &s)) {
+      kdt_heap_sort (h, compar, progress, data, nthreads - nthreads/2);
+      int ret = pthread_join (thread, NULL);
+      assert (ret == 0);
+    }
+    else
+#endif
+    {
+      kdt_heap_sort (h, compar, progress, data, nthreads);
+      kdt_heap_sort (&h2, compar, progress, data, nthreads);
+    }
     merge (h, &h2, compar, buflen);
   }
 #if TIMING
@@ -356,10 +451,19 @@ typedef struct {
   int version;
 } Header;
 
+typedef struct {
+  char * p;
+  size_t len;
+} Mapping;
+
 struct _Kdt {
   Header h;
   FILE * nodes, * sums, * leaves;
   KdtPoint * buffer;
+  int nthreads;
+  /* read-only memory mappings of nodes, sums and leaves */
+  int mapped;
+  Mapping mnodes, msums, mleaves;
   /* progress stuff */
   void (* progress) (float complete, void * data);
   void * data;
@@ -516,11 +620,21 @@ static long update_bounds (KdtRect rect, KdtHeap * h)
   return len;
 }
 
+#if HAVE_PTHREAD
+static pthread_mutex_t progress_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
 static void progress (void * data)
 {
   Kdt * kdt = data;
+#if HAVE_PTHREAD
+  pthread_mutex_lock (&progress_mutex);
+#endif
   if (kdt->progress && kdt->m > 0)
     (* kdt->progress) (++kdt->i/(float) kdt->m, kdt->data);
+#if HAVE_PTHREAD
+  pthread_mutex_unlock (&progress_mutex);
+#endif
 }
 
 static void fwrite_check (const void * ptr, size_t size, size_t nmemb, 
@@ -552,7 +666,7 @@ static int split (KdtHeap * h1, KdtRect bound, int index, Kdt * kdt,
     //    fprintf (stderr, " splitting: %ld      \r", len);
     int nindex = (bound[0].h - bound[0].l < bound[1].h - bound[1].l);
     if (index != nindex) {
-      kdt_heap_sort (h1, nindex ? sort_y : sort_x, progress, kdt);
+      kdt_heap_sort (h1, nindex ? sort_y : sort_x, progress, kdt, kdt->nthreads);
       index = nindex;
     }
     else
@@ -632,9 +746,16 @@ static int split (KdtHeap * h1, KdtRect bound, int index, Kdt * kdt,
 Kdt * kdt_new (void)
 {
   Kdt * kdt = calloc (1, sizeof (Kdt));
+  kdt->nthreads = 1;
   return kdt;
 }
 
+/* sets the maximum number of threads used by kdt_create() */
+void kdt_set_threads (Kdt * kdt, int nthreads)
+{
+  kdt->nthreads = nthreads > 1 ? nthreads : 1;
+}
+
 static FILE * open_ext (const char * name, const char * ext, const char * mode)
 {
   int len = strlen (name), len1 = strlen (ext);
@@ -709,6 +830,47 @@ int kdt_create (Kdt * kdt, const char * name, int blksize,
   return 0;
 }
 
+static int map_file (FILE * fp, Mapping * m)
+{
+  struct stat sb;
+  if (fstat (fileno (fp), &sb))
+    return -1;
+  m->len = sb.st_size;
+  if (m->len == 0) /* mmap() does not accept empty mappings */
+    return 0;
+  if ((off_t) m->len != sb.st_size) /* file too large for the address space */
+    return -1;
+  void * p = mmap (NULL, m->len, PROT_READ, MAP_SHARED, fileno (fp), 0);
+  if (p == MAP_FAILED)
+    return -1;
+  m->p = p;
+  return 0;
+}
+
+static void unmap_file (Mapping * m)
+{
+  if (m->p)
+    munmap (m->p, m->len);
+  m->p = NULL;
+  m->len = 0;
+}
+
+/* Returns a pointer to @size bytes at offset @pos of @fp (or of its
+   mapping @m, if @kdt is mapped). In stdio mode the data is read into
+   @buf. */
+static const void * kdt_read (const Kdt * kdt, FILE * fp, const Mapping * m,
+			      long pos, size_t size, void * buf)
+{
+  if (kdt->mapped) {
+    if (pos < 0 || pos + size > m->len)
+      return NULL;
+    return m->p + pos;
+  }
+  if (fseek (fp, pos, SEEK_SET) || fread (buf, size, 1, fp) != 1)
+    return NULL;
+  return buf;
+}
+
 int kdt_open (Kdt * kdt, const char * name)
 {
   kdt->nodes  = open_ext (name, ".kdt", "r");
@@ -740,11 +902,30 @@ int kdt_open (Kdt * kdt, const char * name)
   if (check_32_bits (kdt))
     return -1;
 
+  if (!map_file (kdt->nodes, &kdt->mnodes) &&
+      !map_file (kdt->sums, &kdt->msums) &&
+      !map_file (kdt->leaves, &kdt->mleaves))
+    kdt->mapped = 1;
+  else {
+    /* fall back to stdio */
+    unmap_file (&kdt->mnodes);
+    unmap_file (&kdt->msums);
+    unmap_file (&kdt->mleaves);
+  }
+
   return 0;
 }
 
+int kdt_reentrant (const Kdt * kdt)
+{
+  return kdt->mapped;
+}
+
 void kdt_destroy (Kdt * kdt)
 {
+  unmap_file (&kdt->mnodes);
+  unmap_file (&kdt->msums);
+  unmap_file (&kdt->mleaves);
   if (kdt->nodes)
     fclose (kdt->nodes);
   if (kdt->sums)
@@ -768,36 +949,38 @@ int kdt_includes (const KdtRect rect, const KdtRect query)
 	  rect[0].l >= query[0].l && rect[1].l >= query[1].l);
 }
 
-static long query (const Kdt * kdt, const KdtRect rect, long len)
+typedef struct {
+  long np, sp, lp;
+} FilePointers;
+
+static long query (const Kdt * kdt, const KdtRect rect, long len, FilePointers * f)
 {
   if (len > kdt->h.np) {
-    Node node;
-    if (fread (&node, sizeof (Node), 1, kdt->nodes) != 1)
-      return -1;
-    long pos = ftell (kdt->nodes), lpos = ftell (kdt->leaves);
-    if (pos < 0 || lpos < 0)
+    Node buf;
+    const Node * node = kdt_read (kdt, kdt->nodes, &kdt->mnodes, f->np, sizeof (Node), &buf);
+    if (!node)
       return -1;
+    f->np += sizeof (Node);
+    long pos = f->np, lpos = f->lp;
     long n = 0;
-    if (kdt_intersects (node.bound1, rect)) {
+    if (kdt_intersects (node->bound1, rect)) {
 #if DEBUG
-      kdt_rect_write (node.bound1, stderr);
+      kdt_rect_write (node->bound1, stderr);
 #endif
-      long n1 = query (kdt, rect, node.len1);
+      long n1 = query (kdt, rect, node->len1, f);
       if (n1 < 0)
 	return -1;
       n += n1;
     }
-    if (kdt_intersects (node.bound2, rect)) {
+    if (kdt_intersects (node->bound2, rect)) {
 #if DEBUG
-      kdt_rect_write (node.bound2, stderr);
+      kdt_rect_write (node->bound2, stderr);
 #endif
       long snodes, ssums, sleaves;
-      sizes (&node, &snodes, &ssums, &sleaves);
-      if (fseek (kdt->nodes, pos + snodes, SEEK_SET))
-	return -1;
-      if (fseek (kdt->leaves, lpos + sleaves, SEEK_SET))
-	return -1;
-      long n1 = query (kdt, rect, len - node.len1);
+      sizes (node, &snodes, &ssums, &sleaves);
+      f->np = pos + snodes;
+      f->lp = lpos + sleaves;
+      long n1 = query (kdt, rect, len - node->len1, f);
       if (n1 < 0)
 	return -1;
       n += n1;
@@ -805,14 +988,15 @@ static long query (const Kdt * kdt, const KdtRect rect, long len)
     return n;
   }
   else if (len > 0) {
-    if (fread (kdt->buffer, sizeof (KdtPoint), len, kdt->leaves) != len)
+    const KdtPoint * a = kdt_read (kdt, kdt->leaves, &kdt->mleaves, 
+				   f->lp, len*sizeof (KdtPoint), kdt->buffer);
+    if (!a)
       return -1;
     int i, n = 0;
     for (i = 0; i < len; i++)
-      if (kdt->buffer[i].x >= rect[0].l && kdt->buffer[i].x <= rect[0].h && 
-	  kdt->buffer[i].y >= rect[1].l && kdt->buffer[i].y <= rect[1].h) {
-       	printf ("%.8f %.8f %f\n", 
-		kdt->buffer[i].x, kdt->buffer[i].y, kdt->buffer[i].z);
+      if (a[i].x >= rect[0].l && a[i].x <= rect[0].h && 
+	  a[i].y >= rect[1].l && a[i].y <= rect[1].h) {
+       	printf ("%.8f %.8f %f\n", a[i].x, a[i].y, a[i].z);
 	n++;
       }
     return n;
@@ -822,14 +1006,12 @@ static long query (const Kdt * kdt, const KdtRect rect, long len)
 
 long kdt_query (const Kdt * kdt, const KdtRect rect)
 {
-  rewind (kdt->nodes);
-  rewind (kdt->leaves);
-  Header h;
-  if (fread (&h, sizeof (Header), 1, kdt->nodes) != 1)
-    return -1;
-  if (!kdt_intersects (rect, h.bound))
+  if (!kdt_intersects (rect, kdt->h.bound))
     return 0;
-  return query (kdt, rect, h.len);
+  FilePointers f;
+  f.np = sizeof (Header);
+  f.sp = f.lp = 0;
+  return query (kdt, rect, kdt->h.len, &f);
 }
 
 static void intersection (const KdtRect rect1, const KdtRect rect2, 
@@ -914,36 +1096,31 @@ static void sum_add_sum (const KdtRect parent, KdtSum * sum,
   if (a->Hmax > sum->Hmax) sum->Hmax = a->Hmax;
 }
 
-typedef struct {
-  long np, sp, lp;
-} FilePointers;
-
 static long query_sum (const Kdt * kdt,
 		       KdtCheck includes, KdtCheck intersects, void * data, 
-		       KdtRect bound, long len,
+		       const KdtRect bound, long len,
 		       FilePointers * f,
 		       const KdtRect query, KdtSum * sum)
 {
   if (len > kdt->h.np) {
     if (length (bound) <= length (query) || (* includes) (bound, data)) {
-      KdtSumCore s;
-      if (fseek (kdt->sums, f->sp, SEEK_SET))
-	return -1;
-      if (fread (&s, sizeof (KdtSumCore), 1, kdt->sums) != 1)
+      KdtSumCore buf;
+      const KdtSumCore * s = kdt_read (kdt, kdt->sums, &kdt->msums, 
+				       f->sp, sizeof (KdtSumCore), &buf);
+      if (!s)
 	return -1;
 #if DEBUG
       fprintf (stderr, "read 1 sum %ld\n", sizeof (KdtSumCore));
 #endif
       f->sp += sizeof (KdtSumCore);
-      sum_add_sum (query, sum, bound, &s);
+      sum_add_sum (query, sum, bound, s);
       return len;
     }
     f->sp += sizeof (KdtSumCore);
 
-    Node node;
-    if (fseek (kdt->nodes, f->np, SEEK_SET))
-      return -1;
-    if (fread (&node, sizeof (Node), 1, kdt->nodes) != 1)
+    Node buf;
+    const Node * node = kdt_read (kdt, kdt->nodes, &kdt->mnodes, f->np, sizeof (Node), &buf);
+    if (!node)
       return -1;
     f->np += sizeof (Node);
 #if DEBUG
@@ -953,22 +1130,22 @@ static long query_sum (const Kdt * kdt,
     long pos = f->np, lpos = f->lp, spos = f->sp;
     long n = 0;
 
-    if ((* intersects) (node.bound1, data)) {
+    if ((* intersects) (node->bound1, data)) {
       long n1 = query_sum (kdt, includes, intersects, data, 
-			   node.bound1, node.len1, f, query, sum);
+			   node->bound1, node->len1, f, query, sum);
       if (n1 < 0)
 	return -1;
       n += n1;
     }
 
-    if ((* intersects) (node.bound2, data)) {
+    if ((* intersects) (node->bound2, data)) {
       long snodes, ssums, sleaves;
-      sizes (&node, &snodes, &ssums, &sleaves);
+      sizes (node, &snodes, &ssums, &sleaves);
       f->np = pos + snodes;
       f->sp = spos + ssums;
       f->lp = lpos + sleaves;
       long n1 = query_sum (kdt, includes, intersects, data, 
-			   node.bound2, len - node.len1, f, query, sum);
+			   node->bound2, len - node->len1, f, query, sum);
       if (n1 < 0)
 	return -1;
       n += n1;
@@ -982,14 +1159,13 @@ static long query_sum (const Kdt * kdt,
       fprintf (stderr, "# area: %f %f\n", area (query), area (bound)/len);
       kdt_rect_write (bound, stderr);
 #endif
-      if (fseek (kdt->leaves, f->lp, SEEK_SET))
-	return -1;
-      if (fread (kdt->buffer, sizeof (KdtPoint), len, kdt->leaves) != len)
+      const KdtPoint * a = kdt_read (kdt, kdt->leaves, &kdt->mleaves, 
+				     f->lp, len*sizeof (KdtPoint), kdt->buffer);
+      if (!a)
 	return -1;
 #if DEBUG
       fprintf (stderr, "read %ld leaves %ld\n", len, sizeof (KdtPoint));
 #endif
-      KdtPoint * a = kdt->buffer;
       int i, n = 0;
       for (i = 0; i < len; i++, a++) {
 	KdtRect boundp;
@@ -1015,20 +1191,159 @@ long kdt_query_sum (const Kdt * kdt,
 		    KdtCheck includes, KdtCheck intersects, void * data, 
 		    const KdtRect query, KdtSum * sum)
 {
-  rewind (kdt->nodes);
-  rewind (kdt->leaves);
-  Header h;
-  if (fread (&h, sizeof (Header), 1, kdt->nodes) != 1)
-    return -1;
   FilePointers f;
   f.np = sizeof (Header);
   f.sp = f.lp = 0;
-  if (!(* intersects) (h.bound, data))
+  if (!(* intersects) (kdt->h.bound, data))
     return 0;
-  return query_sum (kdt, includes, intersects, data, h.bound, h.len, &f, 
+  return query_sum (kdt, includes, intersects, data, kdt->h.bound, kdt->h.len, &f, 
 		    query, sum);
 }
 
+typedef struct {
+  KdtCheck includes, intersects;
+  void ** data;
+  const KdtRect * query;
+  KdtSum * sum;
+} Batch;
+
+/* Same as query_sum() but for the @na queries of @b with indices
+   @active: each node, sum and leaf is read only once for all the
+   queries which need it. The traversal order (and hence the result)
+   is the same as for individual queries. */
+static long query_sum_batch (const Kdt * kdt, const Batch * b,
+			     const int * active, int na,
+			     const KdtRect bound, long len,
+			     FilePointers * f)
+{
+  long n = 0;
+  int i;
+
+  if (len > kdt->h.np) {
+    const KdtSumCore * s = NULL;
+    KdtSumCore sbuf;
+    int * next = malloc (na*sizeof (int)), nn = 0;
+    for (i = 0; i < na; i++) {
+      int j = active[i];
+      if (length (bound) <= length (b->query[j]) || (* b->includes) (bound, b->data[j])) {
+	if (!s && 
+	    !(s = kdt_read (kdt, kdt->sums, &kdt->msums, f->sp, sizeof (KdtSumCore), &sbuf))) {
+	  free (next);
+	  return -1;
+	}
+	sum_add_sum (b->query[j], &b->sum[j], bound, s);
+	n += len;
+      }
+      else
+	next[nn++] = j;
+    }
+    f->sp += sizeof (KdtSumCore);
+    if (nn == 0) {
+      free (next);
+      return n;
+    }
+
+    Node buf;
+    const Node * node = kdt_read (kdt, kdt->nodes, &kdt->mnodes, f->np, sizeof (Node), &buf);
+    if (!node) {
+      free (next);
+      return -1;
+    }
+    f->np += sizeof (Node);
+
+    long pos = f->np, lpos = f->lp, spos = f->sp;
+    int * child = malloc (nn*sizeof (int)), nc = 0;
+
+    for (i = 0; i < nn; i++)
+      if ((* b->intersects) (node->bound1, b->data[next[i]]))
+	child[nc++] = next[i];
+    if (nc > 0) {
+      long n1 = query_sum_batch (kdt, b, child, nc, node->bound1, node->len1, f);
+      if (n1 < 0)
+	goto error;
+      n += n1;
+    }
+
+    nc = 0;
+    for (i = 0; i < nn; i++)
+      if ((* b->intersects) (node->bound2, b->data[next[i]]))
+	child[nc++] = next[i];
+    if (nc > 0) {
+      long snodes, ssums, sleaves;
+      sizes (node, &snodes, &ssums, &sleaves);
+      f->np = pos + snodes;
+      f->sp = spos + ssums;
+      f->lp = lpos + sleaves;
+      long n1 = query_sum_batch (kdt, b, child, nc, node->bound2, len - node->len1, f);
+      if (n1 < 0)
+	goto error;
+      n += n1;
+    }
+    free (child);
+    free (next);
+    return n;
+
+  error:
+    free (child);
+    free (next);
+    return -1;
+  }
+  else {
+    float h = length (bound)/sqrt (len); /* average distance between samples */
+    const KdtPoint * a = NULL;
+    for (i = 0; i < na; i++) {
+      int j = active[i];
+      if (h <= length (b->query[j])) {
+	if (!a && !(a = kdt_read (kdt, kdt->leaves, &kdt->mleaves, 
+				  f->lp, len*sizeof (KdtPoint), kdt->buffer)))
+	  return -1;
+	const KdtPoint * p = a;
+	KdtSum * sum = &b->sum[j];
+	long k;
+	for (k = 0; k < len; k++, p++) {
+	  KdtRect boundp;
+	  boundp[0].l = p->x - h/2.;
+	  boundp[0].h = p->x + h/2.;
+	  boundp[1].l = p->y - h/2.;
+	  boundp[1].h = p->y + h/2.;
+	  if ((* b->intersects) (boundp, b->data[j])) {
+	    double w = intersection_area (boundp, b->query[j]);
+	    sum_add_point (b->query[j], (KdtSumCore *) sum, p, w);
+	    sum->w += w;
+	    sum->coverage += w/area (b->query[j]);
+	    n++;
+	  }
+	}
+      }
+    }
+  }
+  return n;
+}
+
+/* Equivalent to calling kdt_query_sum() for each of the @n queries
+   @query[i] (with user data @data[i] and sum @sum[i]) but traverses
+   the tree only once. Returns the total number of points summed or
+   -1 on error. */
+long kdt_query_sum_batch (const Kdt * kdt, 
+			  KdtCheck includes, KdtCheck intersects, void ** data, 
+			  const KdtRect * query, KdtSum * sum, int n)
+{
+  int * active = malloc (n*sizeof (int)), na = 0, i;
+  for (i = 0; i < n; i++)
+    if ((* intersects) (kdt->h.bound, data[i]))
+      active[na++] = i;
+  long r = 0;
+  if (na > 0) {
+    Batch b = { includes, intersects, data, query, sum };
+    FilePointers f;
+    f.np = sizeof (Header);
+    f.sp = f.lp = 0;
+    r = query_sum_batch (kdt, &b, active, na, kdt->h.bound, kdt->h.len, &f);
+  }
+  free (active);
+  return r;
+}
+
 void kdt_sum_init (KdtSum * s)
 {
   kdt_sum_core_init ((KdtSumCore *) s);
@@ -99,6 +99,7 @@ int kdt_intersects  (const KdtRect rect, const KdtRect query);
 int kdt_includes    (const KdtRect rect, const KdtRect query);
 
 Kdt * kdt_new       (void);
+void kdt_set_threads (Kdt * kdt, int nthreads);
 int  kdt_create     (Kdt * kdt, 
 		     const char * name, 
 		     int blksize,
@@ -106,9 +107,13 @@ int  kdt_create     (Kdt * kdt,
 		     void (* progress) (float complete, void * data),
 		     void * data);
 int  kdt_open       (Kdt * kdt, const char * name);
+int  kdt_reentrant  (const Kdt * kdt);
 void kdt_destroy    (Kdt * kdt);
 long kdt_query      (const Kdt * kdt, const KdtRect rect);
 long kdt_query_sum  (const Kdt * kdt,
 		     KdtCheck includes, KdtCheck intersects, void * data,
 		     const KdtRect query, KdtSum * sum);
+long kdt_query_sum_batch (const Kdt * kdt,
+			  KdtCheck includes, KdtCheck intersects, void ** data,
+			  const KdtRect * query, KdtSum * sum, int n);
 void kdt_sum_init   (KdtSum * s);
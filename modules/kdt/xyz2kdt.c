@@ -59,7 +59,8 @@ static void progress (float complete, void * data)
 
 int main (int argc, char * argv[])
 {
-  int c = 0, pagesize = 4096;
+  int c = 0, pagesize = 4096, nthreads = 1;
+  long memory = 24;
   int verbose = 0;
 
   /* parse options using getopt */
@@ -67,15 +68,17 @@ int main (int argc, char * argv[])
 #ifdef HAVE_GETOPT_LONG
     static struct option long_options[] = {
       {"pagesize", required_argument, NULL, 'p'},
+      {"threads", required_argument, NULL, 't'},
+      {"memory", required_argument, NULL, 'm'},
       {"verbose", no_argument, NULL, 'v'},
       {"help", no_argument, NULL, 'h'},
       { NULL }
     };
     int option_index = 0;
-    switch ((c = getopt_long (argc, argv, "p:hv",
+    switch ((c = getopt_long (argc, argv, "p:t:m:hv",
 			      long_options, &option_index))) {
 #else /* not HAVE_GETOPT_LONG */
-    switch ((c = getopt (argc, argv, "p:hv"))) {
+    switch ((c = getopt (argc, argv, "p:t:m:hv"))) {
 #endif /* not HAVE_GETOPT_LONG */
     case 'v': /* verbose */
       verbose = 1;
@@ -83,6 +86,16 @@ int main (int argc, char * argv[])
     case 'p': /* pagesize */
       pagesize = atoi (optarg);
       break;
+    case 't': /* threads */
+      nthreads = atoi (optarg);
+      break;
+    case 'm': /* memory */
+      memory = atol (optarg);
+      if (memory <= 0) {
+	fprintf (stderr, "xyz2kdt: memory must be strictly positive\n");
+	return 1;
+      }
+      break;
     case 'h': /* help */
       fprintf (stderr,
 	       "Usage: xyz2kdt [OPTION] BASENAME\n"
@@ -92,6 +105,10 @@ int main (int argc, char * argv[])
 	       "terrain module of Gerris.\n"
 	       "\n"
 	       "  -p N  --pagesize=N  sets the pagesize in bytes (default is 4096)\n"
+	       "  -t N  --threads=N   sorts using N threads (default is 1)\n"
+	       "  -m N  --memory=N    sets the size of each sorting buffer in MB\n"
+	       "                      (default is 24). Datasets which fit in a single\n"
+	       "                      buffer are sorted in memory.\n"
 	       "  -v    --verbose     display progress bar\n"
 	       "  -h    --help        display this help and exit\n"
 	       "\n"
@@ -115,7 +132,7 @@ int main (int argc, char * argv[])
   if (verbose)
     fprintf (stderr, "xyz2kdt: reading points...\r");
   KdtHeap h;
-  kdt_heap_create (&h, kdt_tmpfile (), 0, -1, 1000000);
+  kdt_heap_create (&h, kdt_tmpfile (), 0, -1, memory*1000000/sizeof (KdtPoint));
   long n = 0;
   KdtPoint p;
   while (scanf ("%lf %lf %lf", &p.x, &p.y, &p.z) == 3) {
@@ -131,9 +148,18 @@ int main (int argc, char * argv[])
   struct timeval start;
   gettimeofday (&start, NULL);
   Kdt * kdt = kdt_new ();
+  kdt_set_threads (kdt, nthreads);
   kdt_create (kdt, argv[optind], pagesize, &h, verbose ? progress : NULL, &start);
   kdt_destroy (kdt);
 
+  if (verbose) {
+    struct timeval end;
+    gettimeofday (&end, NULL);
+    double elapsed = (end.tv_usec - start.tv_usec)/1e6 + (end.tv_sec - start.tv_sec);
+    fprintf (stderr, "\rxyz2kdt: %ld points indexed in %.1f s (%.0f points/s)\n",
+	     n, elapsed, elapsed > 0. ? n/elapsed : 0.);
+  }
+
   if (verbose) {
     Kdt * kdt = kdt_new ();
     KdtRect rect = {{-1e30,1e30},{-1e30,1e30}};
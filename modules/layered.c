@@ -94,6 +94,18 @@ static void layered_variable_swap (LayeredVariable * lv)
   gfs_variables_swap (lv->v, lv->vl[layered->l]);
 }
 
+/* The column kernels (vertical advection, hydrostatic potential,
+   vertical CFL) access the layers of a variable in a cell as the
+   contiguous array &GFS_VALUE (cell, vl[0]) */
+static gboolean column_is_contiguous (GfsVariable ** vl, guint nl)
+{
+  guint l;
+  for (l = 1; l < nl; l++)
+    if (vl[l]->i != vl[0]->i + l)
+      return FALSE;
+  return TRUE;
+}
+
 static void layered_variable_destroy (LayeredVariable * lv)
 {
   if (lv) {
@@ -199,6 +211,23 @@ static void layered_read (GtsObject ** o, GtsFile * fp)
     }
     i = i->next;
   }
+
+  GSList * columns = g_slist_prepend (g_slist_copy (layered->tracers), layered->v);
+  columns = g_slist_prepend (columns, layered->u);
+  for (i = columns; i; i = i->next) {
+    LayeredVariable * lv = i->data;
+    if (!column_is_contiguous (lv->vl, layered->nl)) {
+      gts_file_error (fp, "the layers of `%s' are not contiguous", lv->v->name);
+      break;
+    }
+  }
+  g_slist_free (columns);
+  if (fp->type == GTS_ERROR)
+    return;
+  if (!column_is_contiguous (layered->w, layered->nl) ||
+      !column_is_contiguous (layered->pr, layered->nl))
+    gts_file_error (fp, "the layers of the vertical velocity or "
+		    "hydrostatic potential are not contiguous");
 }
 
 static void layered_write (GtsObject * o, FILE * fp)
@@ -445,51 +474,80 @@ static void approximate_projection (GfsLayered * layered, GfsVariable * p)
 }
 
 typedef struct {
-  GfsVariable * v;
+  GfsLayered * layered;
+  GSList * v;
   double dt;
-  double * al, * ar;
+  double * unorm, * al, * ar;
 } AdvectionParams;
 
 static void cell_vertical_advection (FttCell * cell, AdvectionParams * p)
 {
-  double * al = p->al, * ar = p->ar, dt = p->dt;
-  GfsLayered * layered = GFS_LAYERED (p->v->domain);
-  double * a = &GFS_VALUE (cell, p->v);
+  double * unorm = p->unorm, * al = p->al, * ar = p->ar, dt = p->dt;
+  GfsLayered * layered = p->layered;
   double * u = &GFS_VALUE (cell, layered->w[0]);
   double * dz = layered->dz, H = layered->H;
 
   int n = layered->nl, i;
   for (i = 0; i < n; i++) {
-    double unorm = dt*((i > 0 ? u[i - 1] : 0.) + u[i])/(2.*dz[i]*H);
-    if (fabs (unorm) > 1.)
-      g_warning ("W CFL: %g", unorm);
-    /* fixme: this gradient is correct only for dz[i] constant */
-    double g = i == 0 ? a[i + 1] - a[i] : i == n - 1 ? a[i] - a[i-1] : (a[i + 1] - a[i - 1])/2.;
-    al[i] = a[i] + MIN ((1. - unorm)/2., 0.5)*g;
-    ar[i] = a[i] + MAX ((- 1. - unorm)/2., -0.5)*g;
+    unorm[i] = dt*((i > 0 ? u[i - 1] : 0.) + u[i])/(2.*dz[i]*H);
+    if (fabs (unorm[i]) > 1.)
+      g_warning ("W CFL: %g", unorm[i]);
   }
-  for (i = 0; i < n - 1; i++) {
-    double flux = (u[i] > 0. ? dt*u[i]*al[i] : 
-		   u[i] < 0. ? dt*u[i]*ar[i + 1] :
-		   dt*u[i]*(al[i] + ar[i + 1])/2.)/H;
-    a[i] -= flux/dz[i];
-    a[i + 1] += flux/dz[i + 1];
+
+  /* all the columns share the same vertical velocity */
+  GSList * j;
+  for (j = p->v; j; j = j->next) {
+    double * a = &GFS_VALUE (cell, ((LayeredVariable *) j->data)->vl[0]);
+    for (i = 0; i < n; i++) {
+      /* fixme: this gradient is correct only for dz[i] constant */
+      double g = i == 0 ? a[i + 1] - a[i] : i == n - 1 ? a[i] - a[i-1] : (a[i + 1] - a[i - 1])/2.;
+      al[i] = a[i] + MIN ((1. - unorm[i])/2., 0.5)*g;
+      ar[i] = a[i] + MAX ((- 1. - unorm[i])/2., -0.5)*g;
+    }
+    for (i = 0; i < n - 1; i++) {
+      double flux = (u[i] > 0. ? dt*u[i]*al[i] : 
+		     u[i] < 0. ? dt*u[i]*ar[i + 1] :
+		     dt*u[i]*(al[i] + ar[i + 1])/2.)/H;
+      a[i] -= flux/dz[i];
+      a[i + 1] += flux/dz[i + 1];
+    }
   }
 }
 
-static void vertical_advection (LayeredVariable * v, gdouble dt)
+static GfsVariable ** layers_bundle (GSList * list, guint nl, guint * n)
 {
-  GfsLayered * layered = GFS_LAYERED (v->v->domain);
+  GfsVariable ** v = g_malloc (g_slist_length (list)*nl*sizeof (GfsVariable *));
+  *n = 0;
+  while (list) {
+    guint l;
+    for (l = 0; l < nl; l++)
+      v[(*n)++] = ((LayeredVariable *) list->data)->vl[l];
+    list = list->next;
+  }
+  return v;
+}
+
+/* Vertical advection of the layered variables of @list: a single
+   traversal advects all the columns and their boundary conditions
+   are applied as a single bundle */
+static void vertical_advection (GfsLayered * layered, GSList * list, gdouble dt)
+{
+  if (list == NULL)
+    return;
+
+  GfsDomain * domain = GFS_DOMAIN (layered);
   AdvectionParams p;
-  p.v = v->vl[0]; p.dt = dt;
-  p.al = g_malloc (layered->nl*sizeof (double));
-  p.ar = g_malloc (layered->nl*sizeof (double));
-  gfs_domain_traverse_leaves (v->v->domain, (FttCellTraverseFunc) cell_vertical_advection, &p);
-  g_free (p.al);
-  g_free (p.ar);
-  int l;
-  for (l = 0; l < layered->nl; l++)
-    gfs_domain_bc (v->v->domain, FTT_TRAVERSE_LEAFS, -1, v->vl[l]);
+  p.layered = layered; p.v = list; p.dt = dt;
+  p.unorm = g_malloc (3*layered->nl*sizeof (double));
+  p.al = p.unorm + layered->nl;
+  p.ar = p.al + layered->nl;
+  gfs_domain_traverse_leaves (domain, (FttCellTraverseFunc) cell_vertical_advection, &p);
+  g_free (p.unorm);
+
+  guint n;
+  GfsVariable ** v = layers_bundle (list, layered->nl, &n);
+  gfs_domain_bc_bundle (domain, FTT_TRAVERSE_LEAFS, -1, v, n);
+  g_free (v);
 }
 
 static void advance_tracers (GfsLayered * layered, gdouble dt)
@@ -503,22 +561,29 @@ static void advance_tracers (GfsLayered * layered, gdouble dt)
   }
 
   GfsDomain * domain = GFS_DOMAIN (layered);
-  GSList * i = layered->tracers;
+  GSList * advected = NULL, * i = layered->tracers;
   while (i) {
     GfsVariable * v = ((LayeredVariable *) i->data)->v;
     if (GFS_VARIABLE_TRACER (v)->advection.scheme != GFS_NONE)
-      vertical_advection (i->data, dt);
-    gfs_domain_traverse_leaves (domain, (FttCellTraverseFunc) layered_variable_average, i->data);
-    gfs_domain_bc (domain, FTT_TRAVERSE_LEAFS, -1, v);
+      advected = g_slist_prepend (advected, i->data);
     i = i->next;
   }
+  vertical_advection (layered, advected, dt);
+  g_slist_free (advected);
+
+  guint n = 0;
+  GfsVariable ** v = g_malloc ((g_slist_length (layered->tracers) + 1)*sizeof (GfsVariable *));
+  for (i = layered->tracers; i; i = i->next) {
+    gfs_domain_traverse_leaves (domain, (FttCellTraverseFunc) layered_variable_average, i->data);
+    v[n++] = ((LayeredVariable *) i->data)->v;
+  }
+  gfs_domain_bc_bundle (domain, FTT_TRAVERSE_LEAFS, -1, v, n);
+  g_free (v);
 
   layered->ab = g_malloc (layered->nl*sizeof (double));
   gfs_domain_traverse_leaves (domain, (FttCellTraverseFunc) compute_hydrostatic_potential, layered);
   g_free (layered->ab);
-  int l;
-  for (l = 0; l < layered->nl; l++)
-    gfs_domain_bc (domain, FTT_TRAVERSE_LEAFS, -1, layered->pr[l]);
+  gfs_domain_bc_bundle (domain, FTT_TRAVERSE_LEAFS, -1, layered->pr, layered->nl);
 }
 
 static void layered_run (GfsSimulation * sim)
@@ -534,6 +599,13 @@ static void layered_run (GfsSimulation * sim)
   gfs_simulation_refine (sim);
   gfs_simulation_init (sim);
 
+  GSList * velocity = g_slist_prepend (g_slist_prepend (NULL, layered->v), layered->u);
+  GSList * lgmac_list = g_slist_prepend (g_slist_prepend (NULL, layered->lgmac[1]), 
+					 layered->lgmac[0]);
+  guint nlgmac;
+  GfsVariable ** lgmac = layers_bundle (lgmac_list, layered->nl, &nlgmac);
+  g_slist_free (lgmac_list);
+
   gfs_simulation_set_timestep (sim);
   if (sim->time.i == 0) {
     approximate_projection (layered, p);
@@ -584,13 +656,9 @@ static void layered_run (GfsSimulation * sim)
 		    layered->gmac);
     /* add barotropic pressure gradient to hydrostatic potential gradient on each level */
     gfs_domain_traverse_leaves (domain, (FttCellTraverseFunc) add_barotropic_gmac, layered);
-    int l;
-    for (l = 0; l < layered->nl; l++) {
-      /* we need to apply BC because
-	 gfs_face_velocity_advection_flux() interpolates gmac on faces */
-      gfs_domain_bc (domain, FTT_TRAVERSE_LEAFS, -1, layered->lgmac[0]->vl[l]);
-      gfs_domain_bc (domain, FTT_TRAVERSE_LEAFS, -1, layered->lgmac[1]->vl[l]);
-    }
+    /* we need to apply BC because
+       gfs_face_velocity_advection_flux() interpolates gmac on faces */
+    gfs_domain_bc_bundle (domain, FTT_TRAVERSE_LEAFS, -1, lgmac, nlgmac);
     gfs_variables_swap (p, pmac);
 
     gts_container_foreach (GTS_CONTAINER (sim->events), (GtsFunc) gfs_event_half_do, sim);
@@ -609,10 +677,8 @@ static void layered_run (GfsSimulation * sim)
       swap_velocities (layered);
     }
 
-    if (sim->advection_params.scheme == GFS_GODUNOV) {
-      vertical_advection (layered->u, sim->advection_params.dt);
-      vertical_advection (layered->v, sim->advection_params.dt);
-    }
+    if (sim->advection_params.scheme == GFS_GODUNOV)
+      vertical_advection (layered, velocity, sim->advection_params.dt);
 
     /* Coriolis */
     for (layered->l = 0; layered->l < layered->nl; layered->l++) {
@@ -646,6 +712,8 @@ static void layered_run (GfsSimulation * sim)
   }
   gts_container_foreach (GTS_CONTAINER (sim->events), (GtsFunc) gfs_event_do, sim);  
   gts_container_foreach (GTS_CONTAINER (sim->events), (GtsFunc) gts_object_destroy, NULL);
+  g_slist_free (velocity);
+  g_free (lgmac);
 }
 
 typedef struct {
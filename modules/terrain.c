@@ -556,25 +556,48 @@ static void add_weighted_kdt_sum  (KdtSum * s, const KdtSum * stmp, double w)
   s->coverage += stmp->coverage;
 }
 
-static void update_terrain_rms (GfsRefineTerrain * t, Polygon * poly, gboolean relative, RMS * rms)
+static void polygon_rect (Polygon * poly, KdtRect rect)
 {
-  rms_init (t, rms, poly, relative);
-  KdtSum s;
-  kdt_sum_init (&s);
-  guint i;
-  KdtRect rect;
   rect[0].l = poly->min[0]; rect[0].h = poly->max[0];
   rect[1].l = poly->min[1]; rect[1].h = poly->max[1];
-  for (i = 0; i < poly->rs->nrs; i++) {
-    KdtSum stmp;
-    kdt_sum_init (&stmp);
-    kdt_query_sum (poly->rs->rs[i],
-		   (KdtCheck) polygon_includes,
-		   (KdtCheck) polygon_intersects, poly, 
-		   rect, &stmp);
-    add_weighted_kdt_sum (&s, &stmp, poly->rs->weight[i]);
+}
+
+/* Fills @s with the weighted sums of all the databases of @rs over
+   each of the @n polygons @poly, traversing each database once */
+static void polygons_sum (Polygon * poly, guint n, Kdtrees * rs, KdtSum * s)
+{
+  KdtRect * rect = g_malloc (n*sizeof (KdtRect));
+  KdtSum * stmp = g_malloc (n*sizeof (KdtSum));
+  gpointer * data = g_malloc (n*sizeof (gpointer));
+  guint i, j;
+
+  for (j = 0; j < n; j++) {
+    kdt_sum_init (&s[j]);
+    polygon_rect (&poly[j], rect[j]);
+    data[j] = &poly[j];
   }
-  
+  for (i = 0; i < rs->nrs; i++) {
+    for (j = 0; j < n; j++)
+      kdt_sum_init (&stmp[j]);
+    kdt_query_sum_batch (rs->rs[i],
+			 (KdtCheck) polygon_includes,
+			 (KdtCheck) polygon_intersects, data,
+			 (const KdtRect *) rect, stmp, n);
+    for (j = 0; j < n; j++)
+      add_weighted_kdt_sum (&s[j], &stmp[j], rs->weight[i]);
+  }
+
+  g_free (rect);
+  g_free (stmp);
+  g_free (data);
+}
+
+static void rms_from_sum (GfsRefineTerrain * t, Polygon * poly, gboolean relative,
+			  const KdtSum * sum, RMS * rms)
+{
+  KdtSum s = *sum;
+
+  rms_init (t, rms, poly, relative);
   rms->m[0][0] = s.w;
   rms->n = s.n;
   if (s.w > 0.) {
@@ -671,14 +694,13 @@ static void update_terrain_rms (GfsRefineTerrain * t, Polygon * poly, gboolean r
   }
 }
 
-static void update_terrain (FttCell * cell, GfsRefineTerrain * t)
+static void update_terrain (FttCell * cell, GfsRefineTerrain * t,
+			    Polygon * poly, const KdtSum * sum)
 {
   RMS rms;
   guint i;
   g_assert (GFS_VALUE (cell, t->type) == REFINED);
-  Polygon poly;
-  polygon_init (gfs_object_simulation (t), &poly, cell, &t->rs);
-  update_terrain_rms (t, &poly, ftt_cell_parent (cell) != NULL, &rms);
+  rms_from_sum (t, poly, ftt_cell_parent (cell) != NULL, sum, &rms);
   rms_update (&rms);
 
   for (i = 0; i < NM; i++)
@@ -744,14 +766,13 @@ static gdouble corner_value (GfsRefineTerrain * t, FttVector * p, gdouble eps, g
   return w > 0 ? v/w : 0.;
 }
 
-static void update_error_estimate (FttCell * cell, GfsRefineTerrain * t, gboolean relative)
+static void update_error_estimate (FttCell * cell, GfsRefineTerrain * t, gboolean relative,
+				   Polygon * poly, const KdtSum * sum)
 {
   if (GFS_VALUE (cell, t->hn) > 0.) {
     RMS rms;
     guint i;
-    Polygon poly;
-    polygon_init (gfs_object_simulation (t), &poly, cell, &t->rs);
-    update_terrain_rms (t, &poly, relative, &rms);
+    rms_from_sum (t, poly, relative, sum, &rms);
     for (i = 0; i < NM; i++)
       rms.h[i] = GFS_VALUE (cell, t->h[i]);
     GFS_VALUE (cell, t->he) = rms_minimum (&rms);
@@ -760,7 +781,8 @@ static void update_error_estimate (FttCell * cell, GfsRefineTerrain * t, gboolea
     GFS_VALUE (cell, t->he) = 0.;
 }
 
-static void remove_knots (FttCell * cell, GfsRefineTerrain * t)
+static void remove_knots (FttCell * cell, GfsRefineTerrain * t,
+			  Polygon * poly, const KdtSum * sum)
 {
   gdouble size = ftt_cell_size (cell), eps = size/1000.;
   guint level = ftt_cell_level (cell);
@@ -781,7 +803,7 @@ static void remove_knots (FttCell * cell, GfsRefineTerrain * t)
     GFS_VALUE (cell, t->h[i]) = h[i];
   GFS_VALUE (cell, t->type) = FAIR;
 
-  update_error_estimate (cell, t, ftt_cell_parent (cell) != NULL);
+  update_error_estimate (cell, t, ftt_cell_parent (cell) != NULL, poly, sum);
 }
 
 static void update_height_and_check_for_refinement (FttCell * cell, GfsRefineTerrain * t)
@@ -1053,6 +1075,51 @@ static void hn_coarse_fine (FttCell * parent, GfsVariable * v)
   }
 }
 
+/* The cells of a given level together with their polygons and the
+   corresponding terrain sums */
+typedef struct {
+  GPtrArray * cells;
+  Polygon * poly;
+  KdtSum * sum;
+} TerrainLevel;
+
+static void add_level_cell (FttCell * cell, GPtrArray * cells)
+{
+  g_ptr_array_add (cells, cell);
+}
+
+static void terrain_level_init (TerrainLevel * l, GfsRefineTerrain * t)
+{
+  GfsSimulation * sim = gfs_object_simulation (t);
+  GfsDomain * domain = GFS_DOMAIN (sim);
+  guint i;
+
+  l->cells = g_ptr_array_new ();
+  traverse_boundary (domain, FTT_PRE_ORDER, FTT_TRAVERSE_LEVEL, t->level,
+		     (FttCellTraverseFunc) add_level_cell, l->cells);
+  l->poly = g_malloc (MAX (l->cells->len, 1)*sizeof (Polygon));
+  l->sum = g_malloc (MAX (l->cells->len, 1)*sizeof (KdtSum));
+  for (i = 0; i < l->cells->len; i++)
+    polygon_init (sim, &l->poly[i], l->cells->pdata[i], &t->rs);
+
+  /* the same sums are used by update_terrain() and remove_knots() */
+  gdouble start = gfs_clock_elapsed (domain->timer);
+  gfs_domain_timer_start (domain, "terrain_query");
+  if (l->cells->len > 0)
+    polygons_sum (l->poly, l->cells->len, &t->rs, l->sum);
+  gfs_domain_timer_stop (domain, "terrain_query");
+  gfs_debug ("GfsRefineTerrain: level %d: %d cells, %d queries in %g s",
+	     t->level, l->cells->len, l->cells->len*t->rs.nrs, 
+	     gfs_clock_elapsed (domain->timer) - start);
+}
+
+static void terrain_level_free (TerrainLevel * l)
+{
+  g_ptr_array_free (l->cells, TRUE);
+  g_free (l->poly);
+  g_free (l->sum);
+}
+
 static void terrain_refine (GfsRefine * refine, GfsSimulation * sim)
 {
   GfsDomain * domain = GFS_DOMAIN (sim);
@@ -1062,10 +1129,14 @@ static void terrain_refine (GfsRefine * refine, GfsSimulation * sim)
   traverse_boundary (domain, FTT_PRE_ORDER, FTT_TRAVERSE_ALL, -1,
 		     (FttCellTraverseFunc) reset_terrain, refine);
   do {
-    traverse_boundary (domain, FTT_PRE_ORDER, FTT_TRAVERSE_LEVEL, t->level,
-		       (FttCellTraverseFunc) update_terrain, refine);
-    traverse_boundary (domain, FTT_PRE_ORDER, FTT_TRAVERSE_LEVEL, t->level,
-		       (FttCellTraverseFunc) remove_knots, refine);
+    TerrainLevel l;
+    guint i;
+    terrain_level_init (&l, t);
+    for (i = 0; i < l.cells->len; i++)
+      update_terrain (l.cells->pdata[i], t, &l.poly[i], &l.sum[i]);
+    for (i = 0; i < l.cells->len; i++)
+      remove_knots (l.cells->pdata[i], t, &l.poly[i], &l.sum[i]);
+    terrain_level_free (&l);
     t->refined = FALSE;
     traverse_boundary (domain, FTT_PRE_ORDER, FTT_TRAVERSE_LEVEL, t->level,
 		       (FttCellTraverseFunc) update_height_and_check_for_refinement,
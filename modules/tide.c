@@ -33,10 +33,16 @@ static gdouble deltat = 0.;
 
 typedef struct _GfsBcTide         GfsBcTide;
 
+#define N  64 /* number of discretisation points */
+
+#define NM 14 /* number of tidal modes (must match those of FES2004) */
+
 struct _GfsBcTide {
   /*< private >*/
   GfsBcValue parent;
   gdouble ** amplitude, ** phase, x, size;
+  gdouble * Zr, * Zi; /* complex coefficients (N x NM) */
+  gdouble time, prediction[N]; /* predictions at time for each point */
 
   /*< public >*/
   GfsVariable * h, * p;
@@ -52,10 +58,6 @@ GfsBcClass * gfs_bc_tide_class  (void);
 
 /* GfsBcTide: Object */
 
-#define N  64 /* number of discretisation points */
-
-#define NM 14 /* number of tidal modes (must match those of FES2004) */
-
 static void bc_tide_write (GtsObject * o, FILE * fp)
 {
   GfsBcTide * bc = GFS_BC_TIDE (o);
@@ -76,6 +78,23 @@ static void set_gradient_boundary (FttCell * cell)
   cell->flags |= GFS_FLAG_GRADIENT_BOUNDARY;
 }
 
+static void bc_tide_coefficients (GfsBcTide * bc)
+{
+  guint i, j;
+
+  g_free (bc->Zr);
+  g_free (bc->Zi);
+  bc->Zr = g_malloc (N*NM*sizeof (gdouble));
+  bc->Zi = g_malloc (N*NM*sizeof (gdouble));
+  for (i = 0; i < N; i++)
+    for (j = 0; j < NM; j++) {
+      gdouble G = - bc->phase[i][j]*M_PI/180.;
+      bc->Zr[i*NM + j] = bc->amplitude[i][j]*cos (G);
+      bc->Zi[i*NM + j] = bc->amplitude[i][j]*sin (G);
+    }
+  bc->time = G_MAXDOUBLE; /* the predictions need to be updated */
+}
+
 static void bc_tide_read (GtsObject ** o, GtsFile * fp)
 {
   GfsBcTide * bc = GFS_BC_TIDE (*o);
@@ -194,6 +213,8 @@ static void bc_tide_read (GtsObject ** o, GtsFile * fp)
     g_free (lon);
     g_free (lat);
   }
+
+  bc_tide_coefficients (bc);
 }
 
 static void bc_tide_destroy (GtsObject * o)
@@ -208,12 +229,42 @@ static void bc_tide_destroy (GtsObject * o)
     g_free (bc->phase[0]);
     g_free (bc->phase);
   }
+  g_free (bc->Zr);
+  g_free (bc->Zi);
     
   (* GTS_OBJECT_CLASS (gfs_bc_tide_class ())->parent_class->destroy) (o);
 }
 
 static tidal_wave wave[NM];
 
+/* Tide_prediction (t, wave, Z) = f(t)*(cos(V(t))*Z.reel - sin(V(t))*Z.imag)
+   is linear in Z: the predictions at the discretisation points are
+   computed once for each time and linearly interpolated for each
+   face, as the coefficients Z would be */
+static void bc_tide_predictions (GfsBcTide * bc, gdouble t)
+{
+  if (t != bc->time) {
+    astro_ang_struct astro_ang;
+    gdouble fcos[NM], fsin[NM];
+    guint i, j;
+
+    init_argument (t, 0, 0, &astro_ang);
+    for (j = 0; j < NM; j++) {
+      gdouble V = greenwhich_argument (wave[j], &astro_ang) + nodal_phase (wave[j], &astro_ang);
+      gdouble f = nodal_factort (wave[j].formula, &astro_ang);
+      fcos[j] = f*cos (V);
+      fsin[j] = f*sin (V);
+    }
+    for (i = 0; i < N; i++) {
+      gdouble * Zr = &bc->Zr[i*NM], * Zi = &bc->Zi[i*NM], prediction = 0.;
+      for (j = 0; j < NM; j++)
+	prediction += fcos[j]*Zr[j] - fsin[j]*Zi[j];
+      bc->prediction[i] = prediction;
+    }
+    bc->time = t;
+  }
+}
+
 static gdouble amplitude_value (FttCellFace * face, GfsBcTide * bc, gdouble t)
 {
   FttComponent c = face->d < FTT_TOP ? FTT_Y : FTT_X;
@@ -231,19 +282,8 @@ static gdouble amplitude_value (FttCellFace * face, GfsBcTide * bc, gdouble t)
   if (bc->amplitude[i+1][2] < 0.)
     a = 0.;
 
-  gdouble prediction = 0.;
-  guint j;
-  for (j = 0; j < NM; j++) {
-    fcomplex Z1, Z2, Z;
-    Z1.reel = bc->amplitude[i][j]*cos (- bc->phase[i][j]*M_PI/180.);
-    Z1.imag = bc->amplitude[i][j]*sin (- bc->phase[i][j]*M_PI/180.);
-    Z2.reel = bc->amplitude[i+1][j]*cos (- bc->phase[i+1][j]*M_PI/180.);
-    Z2.imag = bc->amplitude[i+1][j]*sin (- bc->phase[i+1][j]*M_PI/180.);
-    Z.reel = (1. - a)*Z1.reel + a*Z2.reel;
-    Z.imag = (1. - a)*Z1.imag + a*Z2.imag;
-    prediction += Tide_prediction (t, wave[j], Z, 0, 0);
-  }
-  return prediction;
+  bc_tide_predictions (bc, t);
+  return (1. - a)*bc->prediction[i] + a*bc->prediction[i+1];
 }
 
 static gdouble tide_value (FttCellFace * f, GfsBc * b)
@@ -311,6 +351,7 @@ static void gfs_bc_tide_init (GfsBc * bc)
   bc->bc =             (FttFaceTraverseFunc) tide;
   bc->homogeneous_bc = (FttFaceTraverseFunc) homogeneous_tide;
   bc->face_bc =        (FttFaceTraverseFunc) face_tide;
+  GFS_BC_TIDE (bc)->time = G_MAXDOUBLE;
 }
 
 GfsBcClass * gfs_bc_tide_class (void)
@@ -54,30 +54,53 @@ typedef struct {
   REAL * CG;    /* Group velocities (NK) */
   REAL * WN;    /* Wavenumbers (NK) */
   REAL * ALPHA; /* Nondimensional 1-D spectrum (NK) */  
+  gdouble * omega; /* Angular frequencies (NK) */
 } SourceParams;
 
 static void energy_to_action (FttCell * cell, SourceParams * p)
 {
-  guint i, j;
+  guint i, j, ntheta = p->wave->ntheta;
   REAL * A = p->A;
-  for (i = 0; i < p->wave->nk; i++)
-    for (j = 0; j < p->wave->ntheta; j++) {
-      *A = GFS_VALUE (cell, p->wave->F[i][j])*p->CG[i]/(2.*M_PI*frequency (i));
-      if (*A < 0.)
-        *A = 0.;
-      A++;
+  if (p->wave->spectrum >= 0) {
+    /* contiguous spectrum */
+    const gdouble * E = &GFS_VALUEI (cell, p->wave->spectrum);
+    for (i = 0; i < p->wave->nk; i++, A += ntheta, E += ntheta) {
+      gdouble CG = p->CG[i], omega = p->omega[i];
+      for (j = 0; j < ntheta; j++) {
+	gdouble a = E[j]*CG/omega;
+	A[j] = a < 0. ? 0. : a;
+      }
     }
+  }
+  else
+    for (i = 0; i < p->wave->nk; i++)
+      for (j = 0; j < ntheta; j++) {
+	*A = GFS_VALUE (cell, p->wave->F[i][j])*p->CG[i]/p->omega[i];
+	if (*A < 0.)
+	  *A = 0.;
+	A++;
+      }
 }
 
 static void action_to_energy (FttCell * cell, SourceParams * p)
 {
-  guint i, j;
+  guint i, j, ntheta = p->wave->ntheta;
   REAL * A = p->A;
-  for (i = 0; i < p->wave->nk; i++)
-    for (j = 0; j < p->wave->ntheta; j++) {
-      GFS_VALUE (cell, p->wave->F[i][j]) = *A*(2.*M_PI*frequency (i))/p->CG[i];
-      A++;
+  if (p->wave->spectrum >= 0) {
+    /* contiguous spectrum */
+    gdouble * E = &GFS_VALUEI (cell, p->wave->spectrum);
+    for (i = 0; i < p->wave->nk; i++, A += ntheta, E += ntheta) {
+      gdouble CG = p->CG[i], omega = p->omega[i];
+      for (j = 0; j < ntheta; j++)
+	E[j] = A[j]*omega/CG;
     }
+  }
+  else
+    for (i = 0; i < p->wave->nk; i++)
+      for (j = 0; j < ntheta; j++) {
+	GFS_VALUE (cell, p->wave->F[i][j]) = *A*p->omega[i]/p->CG[i];
+	A++;
+      }
 }
 
 static void stability_correction (FttCell * cell, SourceParams * p, REAL * U10ABS, REAL * U10DIR)
@@ -272,6 +295,7 @@ static void wavewatch_source (GfsWave * wave)
   p.CG = g_malloc (wave->nk*sizeof (REAL));
   p.WN = g_malloc (wave->nk*sizeof (REAL));
   p.ALPHA = g_malloc (wave->nk*sizeof (REAL));
+  p.omega = g_malloc (wave->nk*sizeof (gdouble));
   p.ustar = gfs_variable_from_name (domain->variables, "Ustar");
   p.fpi = gfs_variable_from_name (domain->variables, "Fpi");
   p.u10 = gfs_variable_from_name (domain->variables, "U10");
@@ -281,6 +305,7 @@ static void wavewatch_source (GfsWave * wave)
   guint i;
   for (i = 0; i < wave->nk; i++) {
     REAL omega = 2.*M_PI*frequency (i);
+    p.omega[i] = 2.*M_PI*frequency (i);
     p.WN[i] = omega*omega/9.81;
     p.CG[i] = 9.81/omega/2.;
   }
@@ -294,6 +319,7 @@ static void wavewatch_source (GfsWave * wave)
   g_free (p.CG);
   g_free (p.WN);
   g_free (p.ALPHA);
+  g_free (p.omega);
 
   gfs_domain_timer_stop (domain, "wavewatch_source");
 }
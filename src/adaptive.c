@@ -62,12 +62,21 @@ void gfs_cell_coarse_init (FttCell * cell, GfsDomain * domain)
  * \beginobject{GfsAdapt}
  */
 
+/* Logarithmic histogram of the refinement costs used by adapt_global():
+   COST_BINS_PER_OCTAVE bins for each factor of two between
+   2^-COST_OCTAVES and 2^COST_OCTAVES, plus one bin for smaller (or
+   negative) costs and one bin for larger costs */
+#define COST_OCTAVES         64
+#define COST_BINS_PER_OCTAVE 8
+#define COST_BINS            (2*COST_OCTAVES*COST_BINS_PER_OCTAVE + 2)
+
 typedef struct {
   GfsSimulation * sim;
   guint nc;
-  GtsEHeap * hcoarse, * hfine;
-  gdouble clim;
-  GfsVariable * hcoarsev, * hfinev, * costv, * c;
+  gdouble threshold, cmax;
+  GfsVariable * rv, * cv, * costv, * c;
+  /* number of cells followed by the refinement and coarsening histograms */
+  gdouble h[2*COST_BINS + 1];
 } AdaptParams;
 
 static void gfs_adapt_destroy (GtsObject * o)
@@ -833,10 +842,10 @@ GfsEventClass * gfs_adapt_thickness_class (void)
 
 /** \endobject{GfsAdaptThickness} */
 
-static void refine_cell_corner (FttCell * cell, GfsDomain * domain)
+static void add_corner_cell (FttCell * cell, GPtrArray * a)
 {
   if (FTT_CELL_IS_LEAF (cell) && ftt_refine_corner (cell))
-    ftt_cell_refine_single (cell, domain->cell_init, domain->cell_init_data);
+    g_ptr_array_add (a, cell);
 }
 
 /**
@@ -846,6 +855,10 @@ static void refine_cell_corner (FttCell * cell, GfsDomain * domain)
  * Force the grading of the tree hierarchy of domain, matches the
  * boundaries, recomputes merged cells and applies the boundary
  * conditions for all variables.
+ *
+ * If the "morton" parameter of @domain is set, the cell data are
+ * relocated every @domain->morton reshapes (see
+ * gfs_domain_relocate_data()).
  */
 void gfs_domain_reshape (GfsDomain * domain, guint depth)
 {
@@ -853,11 +866,15 @@ void gfs_domain_reshape (GfsDomain * domain, guint depth)
 
   g_return_if_fail (domain != NULL);
 
-  for (l = depth - 2; l >= 0; l--)
+  GPtrArray * a = g_ptr_array_new ();
+  for (l = depth - 2; l >= 0; l--) {
     gfs_domain_cell_traverse (domain,
 			      FTT_PRE_ORDER, FTT_TRAVERSE_LEVEL, l,
-			      (FttCellTraverseFunc) refine_cell_corner,
-			      domain);
+			      (FttCellTraverseFunc) add_corner_cell, a);
+    ftt_cell_refine_array (a, domain->cell_init, domain->cell_init_data);
+    g_ptr_array_set_size (a, 0);
+  }
+  g_ptr_array_free (a, TRUE);
   gfs_domain_match (domain);
   gfs_set_merged (domain);
   GSList * i = domain->variables;
@@ -871,40 +888,14 @@ void gfs_domain_reshape (GfsDomain * domain, guint depth)
     gfs_domain_projection_reshape (i->data);
     i = i->next;
   }
-}
-
-#define CELL_COST(cell) (GFS_VALUE (cell, p->costv))
-#define CELL_HCOARSE(c) (GFS_DOUBLE_TO_POINTER (GFS_VALUE (c, p->hcoarsev)))
-#define CELL_HFINE(c) (GFS_DOUBLE_TO_POINTER (GFS_VALUE (c, p->hfinev)))
 
-static FttCell * remove_top_coarse (GtsEHeap * h, gdouble * cost, GfsVariable * hcoarse)
-{
-  FttCell * cell = gts_eheap_remove_top (h, cost);
-
-  if (cell)
-    GFS_VALUE (cell, hcoarse) = 0.;
-  while (cell && !FTT_CELL_IS_LEAF (cell)) {
-    cell = gts_eheap_remove_top (h, cost);
-    if (cell) 
-      GFS_VALUE (cell, hcoarse) = 0.;
+  if (domain->morton && ++domain->nreshape >= domain->morton) {
+    gfs_domain_relocate_data (domain);
+    domain->nreshape = 0;
   }
-  return cell;
-}
-
-static FttCell * remove_top_fine (GtsEHeap * h, gdouble * cost, GfsVariable * hfine)
-{
-  FttCell * cell = gts_eheap_remove_top (h, cost);
-
-  if (cell)
-    GFS_VALUE (cell, hfine) = 0.;
-  while (cell && ftt_cell_depth (cell) - ftt_cell_level (cell) != 1) {
-    cell = gts_eheap_remove_top (h, cost);
-    if (cell) 
-      GFS_VALUE (cell, hfine) = 0.;
-  }
-  return cell;
 }
 
+#define CELL_COST(cell) (GFS_VALUE (cell, p->costv))
 static gdouble refine_cost (FttCell * cell, GfsSimulation * sim)
 {
   GSList * i = sim->adapts->items;
@@ -925,7 +916,7 @@ static void compute_cost (FttCell * cell, AdaptParams * p)
 {
   gdouble cost = refine_cost (cell, p->sim);
 
-  GFS_VALUE (cell, p->hcoarsev) = GFS_VALUE (cell, p->hfinev) = 0.;
+  GFS_VALUE (cell, p->rv) = GFS_VALUE (cell, p->cv) = 0.;
   if (FTT_CELL_IS_LEAF (cell))
     CELL_COST (cell) = cost;
   else {
@@ -989,162 +980,12 @@ static guint maxlevel (FttCell * cell, GfsSimulation * sim)
   return maxlevel;
 }
 
-static void fill_heaps (FttCell * cell, AdaptParams * p)
-{
-  guint level = ftt_cell_level (cell);
-  FttCell * parent = ftt_cell_parent (cell);
-  
-  if (level < maxlevel (cell, p->sim))
-    GFS_DOUBLE_TO_POINTER (GFS_VALUE (cell, p->hcoarsev)) = 
-      gts_eheap_insert_with_key (p->hcoarse, cell, - CELL_COST (cell));
-  if (parent && !GFS_CELL_IS_PERMANENT (parent) && GFS_VALUE (parent, p->hfinev) == 0. &&
-      level > minlevel (parent, p->sim))
-    GFS_DOUBLE_TO_POINTER (GFS_VALUE (parent, p->hfinev)) = 
-      gts_eheap_insert_with_key (p->hfine, parent, CELL_COST (parent));
-}
-
-static gboolean fine_cell_coarsenable (FttCell * cell, AdaptParams * p)
-{
-  if (GFS_CELL_IS_BOUNDARY (cell))
-    return TRUE;
-  if (GFS_CELL_IS_PERMANENT (cell))
-    return FALSE;
-  if (CELL_COST (cell) >= -p->clim)
-    return FALSE;
-  if (ftt_cell_level (cell) < minlevel (cell, p->sim))
-    return FALSE;
-  if (ftt_refine_corner (cell))
-    return FALSE;
-  return TRUE;
-}
-
-static void fine_cell_cleanup (FttCell * cell, AdaptParams * p)
-{
-  if (!GFS_CELL_IS_BOUNDARY (cell)) {
-    gpointer o;
-
-    p->nc--;
-    if ((o = CELL_HCOARSE (cell)))
-      gts_eheap_remove (p->hcoarse, o);
-    if ((o = CELL_HFINE (cell)))
-      gts_eheap_remove (p->hfine, o);
-  }
-  gfs_cell_cleanup (cell, GFS_DOMAIN (p->sim));
-}
-
-static void cell_fine_init (FttCell * cell, AdaptParams * p)
-{
-  FttCellChildren child;
-  GfsDomain * domain = GFS_DOMAIN (p->sim);
-  guint n;
-
-  (* domain->cell_init) (cell, domain->cell_init_data);
-  ftt_cell_children (cell, &child);
-  for (n = 0; n < FTT_CELLS; n++)
-    if (child.c[n])
-      CELL_COST (child.c[n]) = G_MAXDOUBLE;
-  if (!GFS_CELL_IS_BOUNDARY (cell))
-    p->nc += FTT_CELLS;
-}
-
-static gboolean adapt_global (GfsSimulation * simulation,
-			      guint * depth,
-			      GfsAdaptStats * s,
-			      guint mincells, guint maxcells,
-			      GfsVariable * c,
-			      gdouble cmax)
-{
-  GfsDomain * domain = GFS_DOMAIN (simulation);
-  gint l;
-  gdouble ccoarse = 0., cfine = 0.;
-  FttCell * coarse, * fine;
-  gboolean changed = TRUE, global_changed = FALSE;
-  AdaptParams apar;
-  
-  apar.sim = simulation;
-  apar.nc = 0;
-  apar.costv = gfs_temporary_variable (domain);
-  apar.hcoarsev = gfs_temporary_variable (domain);
-  apar.hfinev = gfs_temporary_variable (domain);
-  apar.hcoarse = gts_eheap_new (NULL, NULL);
-  apar.hfine = gts_eheap_new (NULL, NULL);
-  apar.c = c;
-  
-  gfs_domain_cell_traverse (domain, 
-			    FTT_POST_ORDER, FTT_TRAVERSE_NON_LEAFS, -1,
-			    (FttCellTraverseFunc) gfs_cell_reset, apar.costv);
-  for (l = *depth; l >= 0; l--)
-    gfs_domain_cell_traverse (domain, 
-			      FTT_PRE_ORDER, FTT_TRAVERSE_LEVEL, l,
-			      (FttCellTraverseFunc) compute_cost, &apar);
-  if (apar.c)
-    gfs_domain_cell_traverse (domain, 
-			      FTT_PRE_ORDER, FTT_TRAVERSE_ALL, -1,
-			      (FttCellTraverseFunc) store_cost, &apar);
-  gts_eheap_freeze (apar.hcoarse);
-  gts_eheap_freeze (apar.hfine);
-  gfs_domain_cell_traverse (domain, FTT_PRE_ORDER, FTT_TRAVERSE_LEAFS, -1,
-			    (FttCellTraverseFunc) fill_heaps, &apar);
-  gts_eheap_thaw (apar.hcoarse);
-  gts_eheap_thaw (apar.hfine);
-  coarse = remove_top_coarse (apar.hcoarse, &ccoarse, apar.hcoarsev);
-  fine = remove_top_fine (apar.hfine, &cfine, apar.hfinev);
-#ifdef DEBUG
-  fprintf (stderr, "initial: %g %g %d\n", cfine, -ccoarse, apar.nc);
-#endif /* DEBUG */
-  while (changed) {
-#ifdef DEBUG
-    fprintf (stderr, "%g %g %d\n", cfine, -ccoarse, apar.nc);
-#endif /* DEBUG */
-    changed = FALSE;
-    if (fine && ((cfine < -ccoarse && apar.nc > maxcells) || 
-		 (cfine < cmax && apar.nc >= mincells))) {
-      guint n = apar.nc;
-	
-      apar.clim = MIN (ccoarse, -cmax);
-      ftt_cell_coarsen (fine,
-			(FttCellCoarsenFunc) fine_cell_coarsenable, &apar,
-			(FttCellCleanupFunc) fine_cell_cleanup, &apar);
-#ifdef DEBUG
-      fprintf (stderr, "coarsen: %d\n", apar.nc);
-#endif /* DEBUG */
-      fine = remove_top_fine (apar.hfine, &cfine, apar.hfinev);
-      s->removed += n - apar.nc;
-      changed = global_changed = TRUE;
-    }
-    if (coarse && ((-ccoarse > cfine && apar.nc < mincells) ||
-		   (-ccoarse > cmax && apar.nc <= maxcells))) {
-      guint level = ftt_cell_level (coarse), n = apar.nc;
-	
-      ftt_cell_refine_corners (coarse, (FttCellInitFunc) cell_fine_init, &apar);
-      ftt_cell_refine_single (coarse, (FttCellInitFunc) cell_fine_init, &apar);
-      if (level + 1 > *depth)
-	*depth = level + 1;
-#ifdef DEBUG
-      fprintf (stderr, "refine: %d\n", apar.nc);
-#endif /* DEBUG */
-      coarse = remove_top_coarse (apar.hcoarse, &ccoarse, apar.hcoarsev);
-      s->created += apar.nc - n;
-      changed = global_changed = TRUE;
-    }
-  }
-  gts_range_add_value (&s->cmax, -ccoarse);
-  gts_range_add_value (&s->ncells, apar.nc);
-
-  gts_eheap_destroy (apar.hcoarse);
-  gts_eheap_destroy (apar.hfine);
-  gts_object_destroy (GTS_OBJECT (apar.costv));
-  gts_object_destroy (GTS_OBJECT (apar.hcoarsev));
-  gts_object_destroy (GTS_OBJECT (apar.hfinev));  
-
-  return global_changed;
-}
-
 typedef struct {
   GfsSimulation * sim;
   guint depth, nc;
   GfsVariable * r, * c;
   GfsAdaptStats * s;
+  GPtrArray * refined;
   gboolean changed;
 } AdaptLocalParams;
 
@@ -1187,17 +1028,39 @@ static void local_cell_fine_init (FttCell * parent,  AdaptLocalParams * p)
   }
 }
 
-static void refine_cell (FttCell * cell, AdaptLocalParams * p)
+static void add_refinable_cell (FttCell * cell, AdaptLocalParams * p)
 {
-  if (REFINABLE (cell, p)) {
+  if (REFINABLE (cell, p))
+    g_ptr_array_add (p->refined, cell);
+}
+
+static void refine_cells (AdaptLocalParams * p)
+{
+  GfsDomain * domain = GFS_DOMAIN (p->sim);
+  guint i;
+
+  gfs_domain_timer_start (domain, "adapt_refine");
+  p->refined = g_ptr_array_new ();
+  gfs_domain_cell_traverse (domain,
+			    FTT_PRE_ORDER, FTT_TRAVERSE_LEAFS, -1,
+			    (FttCellTraverseFunc) add_refinable_cell, p);
+  /* the corner neighbors are appended to the same array: they are
+     coarser than the cells which need them and ftt_cell_refine_array()
+     refines the coarser levels first */
+  guint n = p->refined->len;
+  for (i = 0; i < n; i++) {
+    FttCell * cell = p->refined->pdata[i];
     guint level = ftt_cell_level (cell);
 
-    ftt_cell_refine_corners (cell, (FttCellInitFunc) local_cell_fine_init, p);
-    ftt_cell_refine_single (cell, (FttCellInitFunc) local_cell_fine_init, p);
+    ftt_cell_refine_corners_array (cell, p->refined);
     if (level + 1 > p->depth)
       p->depth = level + 1;
     p->changed = TRUE;
   }
+  ftt_cell_refine_array (p->refined, (FttCellInitFunc) local_cell_fine_init, p);
+  g_ptr_array_free (p->refined, TRUE);
+  p->refined = NULL;
+  gfs_domain_timer_stop (domain, "adapt_refine");
 }
 
 static void refine_cell_mark (FttCell * cell, AdaptLocalParams * p)
@@ -1268,9 +1131,7 @@ static gboolean adapt_local (GfsSimulation * sim, guint * depth, GfsAdaptStats *
   gfs_domain_bc (domain, FTT_TRAVERSE_NON_LEAFS, -1, p.c);
   /* enforce fine/fine faces on periodic/MPI boundaries */
   gts_container_foreach (GTS_CONTAINER (domain), (GtsFunc) enforce_periodic, &p);
-  gfs_domain_cell_traverse (domain,
-			    FTT_PRE_ORDER, FTT_TRAVERSE_LEAFS, -1,
-			    (FttCellTraverseFunc) refine_cell, &p);
+  refine_cells (&p);
   gts_container_foreach (GTS_CONTAINER (domain), (GtsFunc) coarsen_box, &p);
   gts_object_destroy (GTS_OBJECT (p.r));
   gts_object_destroy (GTS_OBJECT (p.c));
@@ -1280,6 +1141,188 @@ static gboolean adapt_local (GfsSimulation * sim, guint * depth, GfsAdaptStats *
   return p.changed;
 }
 
+static guint cost_bin (gdouble cost)
+{
+  if (!(cost > 0.))
+    return 0;
+  gdouble b = (log (cost)/M_LN2 + COST_OCTAVES)*COST_BINS_PER_OCTAVE;
+  if (b < 0.)
+    return 0;
+  if (b >= COST_BINS - 2)
+    return COST_BINS - 1;
+  return 1 + (guint) b;
+}
+
+static gdouble cost_bin_min (guint b)
+{
+  if (b == 0)
+    return - G_MAXDOUBLE;
+  if (b >= COST_BINS)
+    return G_MAXDOUBLE;
+  return pow (2., (b - 1.)/COST_BINS_PER_OCTAVE - COST_OCTAVES);
+}
+
+#define REFINE_HISTOGRAM(p, b)  ((p)->h[1 + (b)])
+#define COARSEN_HISTOGRAM(p, b) ((p)->h[1 + COST_BINS + (b)])
+
+static void fill_histogram (FttCell * cell, AdaptParams * p)
+{
+  guint level = ftt_cell_level (cell);
+  FttCell * parent = ftt_cell_parent (cell);
+  
+  if (level < maxlevel (cell, p->sim)) {
+    GFS_VALUE (cell, p->rv) = 1.;
+    REFINE_HISTOGRAM (p, cost_bin (CELL_COST (cell))) += FTT_CELLS;
+  }
+  /* the parents of leaf cells only are candidates for coarsening */
+  if (parent && GFS_VALUE (parent, p->cv) == 0.) {
+    if (!GFS_CELL_IS_PERMANENT (parent) && ftt_cell_depth (parent) == level &&
+	level > minlevel (parent, p->sim)) {
+      GFS_VALUE (parent, p->cv) = 1.;
+      COARSEN_HISTOGRAM (p, cost_bin (CELL_COST (parent))) += FTT_CELLS;
+    }
+    else
+      GFS_VALUE (parent, p->cv) = -1.;
+  }
+}
+
+/* Returns: the cost threshold above which leaf cells are refined and
+   below which coarsening candidates are coarsened, so that the
+   (estimated) total number of cells is within [mincells,maxcells] */
+static gdouble budget_threshold (AdaptParams * p, 
+				 guint mincells, guint maxcells,
+				 gdouble cmax)
+{
+  guint b, t = cost_bin (cmax);
+  gdouble n = p->h[0];
+
+  for (b = 0; b < COST_BINS; b++)
+    if (b < t)
+      n -= COARSEN_HISTOGRAM (p, b);
+    else
+      n += REFINE_HISTOGRAM (p, b);
+#ifdef DEBUG
+  fprintf (stderr, "budget: %g cells at cmax: %g\n", n, cmax);
+#endif /* DEBUG */
+  if (n > maxcells) {
+    while (t < COST_BINS && n > maxcells) {
+      /* bin t is coarsened rather than refined */
+      n -= COARSEN_HISTOGRAM (p, t) + REFINE_HISTOGRAM (p, t);
+      t++;
+    }
+    return cost_bin_min (t);
+  }
+  if (n < mincells) {
+    while (t > 0 && n < mincells) {
+      t--;
+      /* bin t is refined rather than coarsened */
+      n += REFINE_HISTOGRAM (p, t) + COARSEN_HISTOGRAM (p, t);
+    }
+    return cost_bin_min (t);
+  }
+  return cmax;
+}
+
+static void mark_cell (FttCell * cell, AdaptParams * p)
+{
+  if (FTT_CELL_IS_LEAF (cell)) {
+    FttCell * parent = ftt_cell_parent (cell);
+
+    if (GFS_VALUE (cell, p->rv) > 0.) {
+      if (CELL_COST (cell) > p->threshold) {
+	GFS_VALUE (cell, p->cv) = 0.;
+	return;
+      }
+      GFS_VALUE (cell, p->rv) = 0.;
+      if (CELL_COST (cell) > p->cmax)
+	p->cmax = CELL_COST (cell);
+    }
+    GFS_VALUE (cell, p->cv) = parent ? GFS_VALUE (parent, p->cv) : 0.;
+  }
+  else
+    GFS_VALUE (cell, p->cv) = (GFS_VALUE (cell, p->cv) > 0. && 
+			       CELL_COST (cell) < p->threshold);
+}
+
+/* Adapts the mesh so that the total number of cells (over all the
+   processes) is within [mincells,maxcells]. Rather than refining and
+   coarsening cells one at a time, the cost threshold is found using
+   a (global) histogram of the costs of the cells which can be
+   refined/coarsened and all the cells are then refined/coarsened
+   together. The number of cells is only approximately bounded
+   (i.e. up to the resolution of the histogram and to the cells
+   added to keep the mesh graded). */
+static gboolean adapt_global (GfsSimulation * simulation,
+			      guint * depth,
+			      GfsAdaptStats * s,
+			      guint mincells, guint maxcells,
+			      GfsVariable * c,
+			      gdouble cmax)
+{
+  GfsDomain * domain = GFS_DOMAIN (simulation);
+  AdaptParams apar;
+  gint l;
+  
+  apar.sim = simulation;
+  apar.nc = 0;
+  apar.costv = gfs_temporary_variable (domain);
+  apar.rv = gfs_temporary_variable (domain);
+  apar.cv = gfs_temporary_variable (domain);
+  apar.c = c;
+  memset (apar.h, 0, sizeof (apar.h));
+  
+  gfs_domain_cell_traverse (domain, 
+			    FTT_POST_ORDER, FTT_TRAVERSE_NON_LEAFS, -1,
+			    (FttCellTraverseFunc) gfs_cell_reset, apar.costv);
+  for (l = *depth; l >= 0; l--)
+    gfs_domain_cell_traverse (domain, 
+			      FTT_PRE_ORDER, FTT_TRAVERSE_LEVEL, l,
+			      (FttCellTraverseFunc) compute_cost, &apar);
+  if (apar.c)
+    gfs_domain_cell_traverse (domain, 
+			      FTT_PRE_ORDER, FTT_TRAVERSE_ALL, -1,
+			      (FttCellTraverseFunc) store_cost, &apar);
+  gfs_domain_cell_traverse (domain, FTT_PRE_ORDER, FTT_TRAVERSE_LEAFS, -1,
+			    (FttCellTraverseFunc) fill_histogram, &apar);
+  apar.h[0] = apar.nc;
+#ifdef HAVE_MPI
+  if (domain->pid >= 0) {
+    gdouble * h = g_malloc (sizeof (apar.h));
+    MPI_Allreduce (apar.h, h, 2*COST_BINS + 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    memcpy (apar.h, h, sizeof (apar.h));
+    g_free (h);
+  }
+#endif /* HAVE_MPI */
+  apar.threshold = budget_threshold (&apar, mincells, maxcells, cmax);
+  apar.cmax = 0.;
+  gfs_domain_cell_traverse (domain, FTT_PRE_ORDER, FTT_TRAVERSE_ALL, -1,
+			    (FttCellTraverseFunc) mark_cell, &apar);
+  gfs_domain_bc (domain, FTT_TRAVERSE_ALL, -1, apar.cv);
+
+  AdaptLocalParams p;
+  p.sim = simulation;
+  p.depth = *depth;
+  p.r = apar.rv;
+  p.c = apar.cv;
+  p.s = s;
+  p.nc = apar.nc;
+  p.changed = FALSE;
+  /* enforce fine/fine faces on periodic/MPI boundaries */
+  gts_container_foreach (GTS_CONTAINER (domain), (GtsFunc) enforce_periodic, &p);
+  refine_cells (&p);
+  gts_container_foreach (GTS_CONTAINER (domain), (GtsFunc) coarsen_box, &p);
+  *depth = p.depth;
+
+  gts_range_add_value (&s->cmax, apar.cmax);
+  gts_range_add_value (&s->ncells, p.nc);
+
+  gts_object_destroy (GTS_OBJECT (apar.costv));
+  gts_object_destroy (GTS_OBJECT (apar.rv));
+  gts_object_destroy (GTS_OBJECT (apar.cv));
+
+  return p.changed;
+}
+
 /**
  * gfs_simulation_adapt:
  * @simulation: a #GfsSimulation.
@@ -1327,7 +1370,7 @@ gboolean gfs_simulation_adapt (GfsSimulation * simulation)
   if (active) {
     guint depth = gfs_domain_depth (domain), depth_before = depth;
 
-    if (maxcells < G_MAXINT)
+    if (mincells > 0 || maxcells < G_MAXINT)
       changed = adapt_global (simulation, &depth, &simulation->adapts_stats, 
 			      mincells, maxcells, c, cmax);
     else
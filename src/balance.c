@@ -23,6 +23,7 @@
 #include "balance.h"
 #include "mpi_boundary.h"
 #include "adaptive.h"
+#include "particle.h"
 
 /**
  * Dynamic load-balancing.
@@ -305,6 +306,10 @@ static gboolean gfs_event_balance_event (GfsEvent * event, GfsSimulation * sim)
 	  gfs_domain_bc (domain, FTT_TRAVERSE_LEAFS, -1, i->data);
 	  i = i->next;
 	}
+	/* particles follow the boxes containing them */
+	for (i = sim->events->items; i; i = i->next)
+	  if (GFS_IS_EVENT_LIST (i->data) && GFS_EVENT_LIST (i->data)->distributed)
+	    gfs_particles_migrate (sim, i->data);
       }
 #else /* not HAVE_MPI */
       g_assert_not_reached ();
@@ -569,6 +569,7 @@ static void gfs_boundary_destroy (GtsObject * object)
     g_hash_table_destroy (unique);
     g_hash_table_destroy (boundary->bc);
   }
+  g_slist_free (boundary->bundle);
 
   (* GTS_OBJECT_CLASS (gfs_boundary_class ())->parent_class->destroy) (object);
 }
@@ -1271,6 +1272,7 @@ static void set_buffers_size (GfsBoundaryPeriodic * boundary)
 		     (FttCellTraverseFunc) boundary_size, &count);
   g_array_set_size (boundary->rcvbuf, count);
   g_array_set_size (boundary->sndbuf, count);
+  boundary->size = count;
 }
 
 static void boundary_tree (FttCell * cell, GfsBoundaryPeriodic * boundary)
@@ -1426,6 +1428,19 @@ static void receive (GfsBoundary * bb,
 				(FttFaceTraverseFunc) face_update, boundary);
     break;
 
+  case GFS_BOUNDARY_CENTER_BUNDLE: {
+    /* the values of each variable of the bundle follow each other */
+    GSList * i = bb->bundle;
+    while (i) {
+      bb->v = i->data;
+      ftt_cell_traverse (GFS_BOUNDARY (boundary)->root,
+			 FTT_PRE_ORDER, flags, max_depth,
+			 (FttCellTraverseFunc) center_update, boundary);
+      i = i->next;
+    }
+    break;
+  }
+
   case GFS_BOUNDARY_MATCH_VARIABLE:
     match_update (GFS_BOUNDARY (boundary)->root, boundary);
     ftt_cell_flatten (GFS_BOUNDARY (boundary)->root, 
@@ -1621,6 +1636,26 @@ GfsBoundaryPeriodic * gfs_boundary_periodic_rotate_new (GfsBoundaryClass * klass
   return boundary;
 }
 
+/**
+ * gfs_boundary_periodic_reserve:
+ * @boundary: a #GfsBoundaryPeriodic.
+ * @n: a number of variables.
+ *
+ * Makes sure that the send and receive buffers of @boundary are large
+ * enough to exchange the values of @n (cell-centered) variables at
+ * once (see gfs_domain_bc_bundle()).
+ */
+void gfs_boundary_periodic_reserve (GfsBoundaryPeriodic * boundary,
+				    guint n)
+{
+  g_return_if_fail (boundary != NULL);
+
+  if (boundary->sndbuf->len < n*boundary->size)
+    g_array_set_size (boundary->sndbuf, n*boundary->size);
+  if (boundary->rcvbuf->len < n*boundary->size)
+    g_array_set_size (boundary->rcvbuf, n*boundary->size);
+}
+
 /** \endobject{GfsBoundaryPeriodic} */
 
 /**
@@ -140,6 +140,7 @@ typedef enum {
   GFS_BOUNDARY_CENTER_VARIABLE,
   GFS_BOUNDARY_FACE_VARIABLE,
   GFS_BOUNDARY_MATCH_VARIABLE,
+  GFS_BOUNDARY_CENTER_BUNDLE,
   GFS_BOUNDARY_VARIABLE_NUMBER
 } GfsBoundaryVariableType;
 
@@ -158,6 +159,7 @@ struct _GfsBoundary {
   GfsVariable * v;
   GfsBoundaryVariableType type;
   GHashTable * bc;
+  GSList * bundle;
 };
 
 struct _GfsBoundaryClass {
@@ -260,7 +262,7 @@ struct _GfsBoundaryPeriodic {
   GfsBox * matching;
   FttDirection d;
   GArray * sndbuf, * rcvbuf;
-  guint sndcount, rcvcount;
+  guint sndcount, rcvcount, size;
 
   gdouble rotate;
 };
@@ -285,6 +287,8 @@ GfsBoundaryPeriodic * gfs_boundary_periodic_rotate_new (GfsBoundaryClass * klass
 							GfsBox * matching,
 							FttDirection rotate,
 							gdouble orientation);
+void                  gfs_boundary_periodic_reserve  (GfsBoundaryPeriodic * boundary,
+						      guint n);
 
 /* GfsGEdge: Header */
   
@@ -37,6 +37,11 @@
 #include "init.h"
 
 #include "config.h"
+#ifdef HAVE_LINUX_PERF_EVENT_H
+#  include <linux/perf_event.h>
+#  include <sys/syscall.h>
+#  include <sys/ioctl.h>
+#endif /* HAVE_LINUX_PERF_EVENT_H */
 
 /* GfsLocateArray: Object */
 
@@ -162,6 +167,13 @@ void gfs_locate_array_destroy (GfsLocateArray * a)
 
 /**
  * Spatial domain.
+ *
+ * With the option morton = N, the boxes are traversed in Morton
+ * (Z-curve) order of their positions and the cell data are relocated
+ * in traversal order every N reshapes of the mesh. Static meshes are
+ * never reshaped and their data are not relocated. The memory used
+ * by the cell data doubles during each relocation. The test "morton"
+ * reports the cache misses with and without this option.
  * \beginobject{GfsDomain}
  */
 
@@ -190,6 +202,8 @@ static void domain_write (GtsObject * o, FILE * fp)
   fprintf (fp, "version = %d ", atoi (GFS_BUILD_VERSION));
   if (!domain->overlap)
     fputs ("overlap = 0 ", fp);
+  if (domain->morton)
+    fprintf (fp, "morton = %u ", domain->morton);
   if (domain->max_depth_write > -2) {
     GSList * i = domain->variables_io;
 
@@ -223,6 +237,7 @@ static void domain_read (GtsObject ** o, GtsFile * fp)
     {GTS_INT,    "binary",    TRUE},
     {GTS_INT,    "version",   TRUE},
     {GTS_INT,    "overlap",   TRUE},
+    {GTS_UINT,   "morton",    TRUE},
     {GTS_NONE}
   };
   gchar * variables = NULL;
@@ -244,12 +259,16 @@ static void domain_read (GtsObject ** o, GtsFile * fp)
   var[8].data = &domain->binary;
   var[9].data = &domain->version;
   var[10].data = &domain->overlap;
+  var[11].data = &domain->morton;
   gts_file_assign_variables (fp, var);
   if (fp->type == GTS_ERROR) {
     g_free (variables);
     return;
   }
 
+  if (var[11].set)
+    domain->dirty = TRUE;
+
   if (var[4].set || var[5].set || var[6].set)
     g_warning ("the (lx,ly,lz) parameters are obsolete, please use GfsMetricStretch instead");
 
@@ -538,6 +557,37 @@ static void cleanup_each_box (GfsBox * box, GfsDomain * domain)
   }
 }
 
+typedef struct {
+  FttTraverseType order;
+  FttTraverseFlags flags;
+  gint max_depth;
+  FttCell ** cells;
+  guint n;
+} CachedTraversal;
+
+static void traversals_free (GfsDomain * domain)
+{
+  GSList * i = domain->traversals;
+  while (i) {
+    CachedTraversal * c = i->data;
+    g_free (c->cells);
+    g_free (c);
+    i = i->next;
+  }
+  g_slist_free (domain->traversals);
+  domain->traversals = NULL;
+}
+
+static void counters_close (GfsDomain * domain)
+{
+  GfsCounter c;
+  for (c = 0; c < GFS_COUNTER_NUMBER; c++)
+    if (domain->counters[c] >= 0) {
+      close (domain->counters[c]);
+      domain->counters[c] = -1;
+    }
+}
+
 static void domain_destroy (GtsObject * o)
 {
   GfsDomain * domain = GFS_DOMAIN (o);
@@ -564,6 +614,9 @@ static void domain_destroy (GtsObject * o)
 
   g_hash_table_foreach (domain->timers, (GHFunc) free_pair, NULL);
   g_hash_table_destroy (domain->timers);
+  if (domain->trace)
+    g_array_free (domain->trace, TRUE);
+  counters_close (domain);
 
   g_slist_free (domain->variables_io);
 
@@ -575,6 +628,8 @@ static void domain_destroy (GtsObject * o)
   g_ptr_array_free (domain->sorted, TRUE);
   domain->sorted = NULL;
 
+  traversals_free (domain);
+
   (* GTS_OBJECT_CLASS (gfs_domain_class ())->parent_class->destroy) (o);
 }
 
@@ -594,6 +649,47 @@ static int compare_boxes (const void * p1, const void * p2)
     return 0;
 }
 
+static void box_morton_index (GfsBox * b, guint i[FTT_DIMENSION])
+{
+  FttVector p;
+  ftt_cell_pos (b->root, &p);
+  gdouble h = ftt_cell_size (b->root);
+  FttComponent c;
+  for (c = 0; c < FTT_DIMENSION; c++)
+    i[c] = floor ((&p.x)[c]/h + 0.5) + 1073741824.;
+}
+
+/* whether the most significant bit of @x is lower than that of @y */
+static gboolean less_msb (guint x, guint y)
+{
+  return x < y && x < (x ^ y);
+}
+
+static int compare_boxes_morton (const void * p1, const void * p2)
+{
+  GfsBox * b1 = *(GfsBox **)p1;
+  GfsBox * b2 = *(GfsBox **)p2;
+  if (!GFS_IS_BOX (b1) || !GFS_IS_BOX (b2))
+    return 0;
+
+  /* the order is given by the component with the most significant
+     differing bit */
+  guint i1[FTT_DIMENSION], i2[FTT_DIMENSION], x = 0;
+  FttComponent c, cmax = 0;
+  box_morton_index (b1, i1);
+  box_morton_index (b2, i2);
+  for (c = 0; c < FTT_DIMENSION; c++) {
+    guint y = i1[c] ^ i2[c];
+    if (less_msb (x, y)) {
+      cmax = c;
+      x = y;
+    }
+  }
+  if (i1[cmax] != i2[cmax])
+    return i1[cmax] < i2[cmax] ? -1 : 1;
+  return b1->id < b2->id ? -1 : b1->id > b2->id;
+}
+
 static void domain_foreach (GtsContainer * c, 
 			    GtsFunc func, 
 			    gpointer data)
@@ -607,7 +703,8 @@ static void domain_foreach (GtsContainer * c,
       g_ptr_array_set_size (a, 0);
       (* GTS_CONTAINER_CLASS (GTS_OBJECT_CLASS (gfs_domain_class ())->parent_class)->foreach)
 	(c, (GtsFunc) add_item, a);
-      qsort (a->pdata, a->len, sizeof (gpointer), compare_boxes);
+      qsort (a->pdata, a->len, sizeof (gpointer), 
+	     GFS_DOMAIN (c)->morton ? compare_boxes_morton : compare_boxes);
       GFS_DOMAIN (c)->dirty = FALSE;
     }
     guint i;
@@ -656,6 +753,13 @@ static void domain_init (GfsDomain * domain)
   domain->clock = g_timer_new ();
   domain->timer = gfs_clock_new ();
   domain->timers = g_hash_table_new (g_str_hash, g_str_equal);
+  static guint serial = 0;
+  domain->serial = ++serial;
+  domain->running = NULL;
+  domain->trace = NULL;
+  GfsCounter c;
+  for (c = 0; c < GFS_COUNTER_NUMBER; c++)
+    domain->counters[c] = -1;
 
   gts_range_init (&domain->size);
 
@@ -687,6 +791,8 @@ static void domain_init (GfsDomain * domain)
 
   domain->sorted = g_ptr_array_new ();
   domain->dirty = TRUE;
+  domain->morton = domain->nreshape = 0;
+  domain->traversals = NULL;
   
   domain->projections = NULL;
 }
@@ -855,15 +961,16 @@ void gfs_domain_copy_bc (GfsDomain * domain,
   g_return_if_fail (v != NULL);
   g_return_if_fail (v1 != NULL);
 
+  static GfsTimerCache cache = { 0, NULL };
   if (domain->profile_bc)
-    gfs_domain_timer_start (domain, "bc");
+    gfs_timer_start (domain, gfs_domain_timer_cached (domain, "bc", &cache));
 
   gts_container_foreach (GTS_CONTAINER (domain), (GtsFunc) box_bc, &b);
   gts_container_foreach (GTS_CONTAINER (domain), (GtsFunc) box_receive_bc, &b);
   gts_container_foreach (GTS_CONTAINER (domain), (GtsFunc) box_synchronize, &b.c);
 
   if (domain->profile_bc)
-    gfs_domain_timer_stop (domain, "bc");
+    gfs_timer_stop (domain, cache.t);
 }
 
 /**
@@ -886,6 +993,93 @@ void gfs_domain_bc (GfsDomain * domain,
   gfs_domain_copy_bc (domain, flags, max_depth, v, v);
 }
 
+typedef struct {
+  FttTraverseFlags flags;
+  gint max_depth;
+  GfsVariable ** v;
+  guint n;
+} BcBundle;
+
+static void box_reserve_bundle (GfsBox * box, BcBundle * p)
+{
+  FttDirection d;
+
+  for (d = 0; d < FTT_NEIGHBORS; d++)
+    if (GFS_IS_BOUNDARY_PERIODIC (box->neighbor[d]))
+      gfs_boundary_periodic_reserve (GFS_BOUNDARY_PERIODIC (box->neighbor[d]), p->n);
+}
+
+static void box_bc_bundle (GfsBox * box, BcBundle * p)
+{
+  FttDirection d;
+
+  for (d = 0; d < FTT_NEIGHBORS; d++)
+    if (GFS_IS_BOUNDARY (box->neighbor[d])) {
+      GfsBoundary * b = GFS_BOUNDARY (box->neighbor[d]);
+      guint i;
+
+      g_slist_free (b->bundle);
+      b->bundle = NULL;
+      for (i = 0; i < p->n; i++) {
+	GfsBc * bc = gfs_boundary_lookup_bc (b, p->v[i]);
+
+	if (bc) {
+	  b->v = p->v[i];
+	  b->type = GFS_BOUNDARY_CENTER_VARIABLE;
+	  gfs_boundary_update (b);
+	  ftt_face_traverse_boundary (b->root, b->d,
+				      FTT_PRE_ORDER, p->flags, p->max_depth,
+				      bc->bc, bc);
+	  b->bundle = g_slist_prepend (b->bundle, p->v[i]);
+	}
+      }
+      if (b->bundle) {
+	b->bundle = g_slist_reverse (b->bundle);
+	b->type = GFS_BOUNDARY_CENTER_BUNDLE;
+	gfs_boundary_send (b);
+      }
+    }
+}
+
+/**
+ * gfs_domain_bc_bundle:
+ * @domain: a #GfsDomain.
+ * @flags: the traversal flags.
+ * @max_depth: the maximum depth of the traversal.
+ * @v: an array of #GfsVariable.
+ * @n: the size of @v.
+ *
+ * Apply the boundary conditions in @domain for the @n variables
+ * @v. This is equivalent to calling gfs_domain_bc() for each variable
+ * but the values of all the variables are exchanged at once through
+ * periodic and parallel boundaries (i.e. using a single message per
+ * boundary).
+ */
+void gfs_domain_bc_bundle (GfsDomain * domain,
+			   FttTraverseFlags flags,
+			   gint max_depth,
+			   GfsVariable ** v,
+			   guint n)
+{
+  BcBundle p = { flags, max_depth, v, n };
+  BcData b = { flags, max_depth, NULL, NULL, FTT_XYZ };
+
+  g_return_if_fail (domain != NULL);
+  g_return_if_fail (v != NULL);
+
+  static GfsTimerCache cache = { 0, NULL };
+  if (domain->profile_bc)
+    gfs_timer_start (domain, gfs_domain_timer_cached (domain, "bc", &cache));
+
+  gts_container_foreach (GTS_CONTAINER (domain), (GtsFunc) box_reserve_bundle, &p);
+  gts_container_foreach (GTS_CONTAINER (domain), (GtsFunc) box_bc_bundle, &p);
+  gts_container_foreach (GTS_CONTAINER (domain), (GtsFunc) box_receive_bc, &b);
+  gts_container_foreach (GTS_CONTAINER (domain), (GtsFunc) box_synchronize, &b.c);
+
+  if (domain->profile_bc)
+    gfs_timer_stop (domain, cache.t);
+}
+
 static void box_homogeneous_bc (GfsBox * box, BcData * p)
 {
   FttDirection d;
@@ -954,15 +1148,16 @@ void gfs_domain_homogeneous_bc (GfsDomain * domain,
   g_return_if_fail (ov != NULL);
   g_return_if_fail (v != NULL);
 
+  static GfsTimerCache cache = { 0, NULL };
   if (domain->profile_bc)
-    gfs_domain_timer_start (domain, "bc");
+    gfs_timer_start (domain, gfs_domain_timer_cached (domain, "bc", &cache));
 
   gts_container_foreach (GTS_CONTAINER (domain), (GtsFunc) box_homogeneous_bc, &b);
   gts_container_foreach (GTS_CONTAINER (domain), (GtsFunc) box_receive_bc, &b);
   gts_container_foreach (GTS_CONTAINER (domain), (GtsFunc) box_synchronize, &b.c);
 
   if (domain->profile_bc)
-    gfs_domain_timer_stop (domain, "bc");
+    gfs_timer_stop (domain, cache.t);
 }
 
 /**
@@ -1220,15 +1415,16 @@ void gfs_domain_face_bc (GfsDomain * domain,
   g_return_if_fail (c == FTT_XYZ || (c >= 0 && c < FTT_DIMENSION));
   g_return_if_fail (v != NULL);
 
+  static GfsTimerCache cache = { 0, NULL };
   if (domain->profile_bc)
-    gfs_domain_timer_start (domain, "face_bc");
+    gfs_timer_start (domain, gfs_domain_timer_cached (domain, "face_bc", &cache));
 
   gts_container_foreach (GTS_CONTAINER (domain), (GtsFunc) box_face_bc, &b);
   gts_container_foreach (GTS_CONTAINER (domain), (GtsFunc) box_receive_bc, &b);
   gts_container_foreach (GTS_CONTAINER (domain), (GtsFunc) box_synchronize, &b.c);
 
   if (domain->profile_bc)
-    gfs_domain_timer_stop (domain, "face_bc");
+    gfs_timer_stop (domain, cache.t);
 }
 
 static void box_changed (GfsBox * box, gboolean * changed)
@@ -1434,6 +1630,75 @@ FttCellTraverse * gfs_domain_cell_traverse_new (GfsDomain * domain,
   return t;
 }
 
+/* Returns the cached traversal of @domain for @order, @flags and
+   @max_depth, built first if necessary */
+static CachedTraversal * cached_traversal (GfsDomain * domain,
+					   FttTraverseType order,
+					   FttTraverseFlags flags,
+					   gint max_depth)
+{
+  guint version = ftt_topology_version ();
+  if (version != domain->traversals_version || domain->dirty) {
+    traversals_free (domain);
+    domain->traversals_version = version;
+  }
+
+  GSList * i = domain->traversals;
+  while (i) {
+    CachedTraversal * c = i->data;
+    if (c->order == order && c->flags == flags && c->max_depth == max_depth)
+      return c;
+    i = i->next;
+  }
+
+  CachedTraversal * c = g_malloc (sizeof (CachedTraversal));
+  c->order = order;
+  c->flags = flags;
+  c->max_depth = max_depth;
+  GPtrArray * a = g_ptr_array_new ();
+  gfs_domain_cell_traverse (domain, order, flags, max_depth,
+			    (FttCellTraverseFunc) cell_traverse_add, a);
+  c->n = a->len;
+  g_ptr_array_add (a, NULL);
+  c->cells = (FttCell **) a->pdata;
+  g_ptr_array_free (a, FALSE);
+  domain->traversals = g_slist_prepend (domain->traversals, c);
+  return c;
+}
+
+/**
+ * gfs_domain_cell_traverse_borrow:
+ * @domain: a #GfsDomain.
+ * @order: the order in which the cells are visited - %FTT_PRE_ORDER,
+ * %FTT_POST_ORDER. 
+ * @flags: which types of children are to be visited.
+ * @max_depth: the maximum depth of the traversal. Cells below this
+ * depth will not be traversed. If @max_depth is -1 all cells in the
+ * tree are visited.
+ * @t: a #FttCellTraverse.
+ *
+ * Initialises @t with the same cells as gfs_domain_cell_traverse_new()
+ * but without copying them: the list of cells is kept by @domain and
+ * is only rebuilt when the topology of the mesh changes (see
+ * ftt_topology_version()). Several traversals can be borrowed at the
+ * same time.
+ *
+ * @t must not be passed to ftt_cell_traverse_destroy() and must not
+ * be used after the mesh has been modified.
+ */
+void gfs_domain_cell_traverse_borrow (GfsDomain * domain,
+				      FttTraverseType order,
+				      FttTraverseFlags flags,
+				      gint max_depth,
+				      FttCellTraverse * t)
+{
+  g_return_if_fail (domain != NULL);
+  g_return_if_fail (t != NULL);
+
+  CachedTraversal * c = cached_traversal (domain, order, flags, max_depth);
+  t->current = t->cells = c->cells;
+}
+
 /**
  * gfs_domain_traverse_layers:
  * @domain: a #GfsDomain.
@@ -2637,6 +2902,99 @@ FttCell * gfs_domain_locate (GfsDomain * domain,
   return NULL;
 }
 
+/* TRUE if ftt_cell_locate() would go through @cell to locate @p:
+   points on a face belong to the cell with the lowest coordinates */
+static gboolean cell_owns_point (FttCell * cell, const FttVector * p)
+{
+  FttVector o;
+  ftt_cell_pos (cell, &o);
+  gdouble h = ftt_cell_size (cell)/2.;
+  return (p->x > o.x - h && p->x <= o.x + h &&
+	  p->y > o.y - h && p->y <= o.y + h
+#if !FTT_2D
+	  && p->z > o.z - h && p->z <= o.z + h
+#endif
+	  );
+}
+
+/* TRUE if @p is strictly inside @cell */
+static gboolean cell_contains_point (FttCell * cell, const FttVector * p)
+{
+  FttVector o;
+  ftt_cell_pos (cell, &o);
+  gdouble h = ftt_cell_size (cell)/2.;
+  return (p->x > o.x - h && p->x < o.x + h &&
+	  p->y > o.y - h && p->y < o.y + h
+#if !FTT_2D
+	  && p->z > o.z - h && p->z < o.z + h
+#endif
+	  );
+}
+
+/**
+ * gfs_domain_locate_hint:
+ * @domain: a #GfsDomain.
+ * @target: position of the point to look for.
+ * @max_depth: maximum depth to consider (-1 means no restriction, -2
+ * see gfs_domain_locate()).
+ * @hint: a #FttCell of @domain close to @target or %NULL.
+ *
+ * Same as gfs_domain_locate() but the search starts from @hint
+ * (typically the cell containing a previous, nearby position). The
+ * neighbor of @hint in the direction of @target is tried first, then
+ * the search goes up the tree until a cell containing @target is
+ * found and down again to the requested depth. If @target is not
+ * strictly contained in the box of this cell, the search falls back
+ * to gfs_domain_locate(). Points on the faces of cells are located
+ * as they would be by gfs_domain_locate() i.e. the result does not
+ * depend on @hint.
+ *
+ * Note that @hint must be a valid cell of @domain i.e. the mesh must
+ * not have changed since @hint was obtained.
+ *
+ * Returns: a #FttCell of @domain containing (boundary included) the
+ * point defined by @target or %NULL if @target is not contained in
+ * any cell of @domain.  
+ */
+FttCell * gfs_domain_locate_hint (GfsDomain * domain,
+				  FttVector target,
+				  gint max_depth,
+				  FttCell * hint)
+{
+  g_return_val_if_fail (domain != NULL, NULL);
+
+  if (hint == NULL)
+    return gfs_domain_locate (domain, target, max_depth, NULL);
+
+  FttCell * cell = hint;
+  if (!cell_owns_point (cell, &target)) {
+    /* try the neighbor in the direction of the target */
+    FttVector o;
+    FttComponent c, cmax = FTT_X;
+    gdouble dmax = 0.;
+    ftt_cell_pos (cell, &o);
+    for (c = 0; c < FTT_DIMENSION; c++) {
+      gdouble d = fabs ((&target.x)[c] - (&o.x)[c]);
+      if (d > dmax) {
+	dmax = d;
+	cmax = c;
+      }
+    }
+    FttCell * neighbor = ftt_cell_neighbor (cell, 2*cmax + ((&target.x)[cmax] < (&o.x)[cmax]));
+    if (neighbor && !GFS_CELL_IS_BOUNDARY (neighbor))
+      cell = neighbor;
+  }
+
+  while (!FTT_CELL_IS_ROOT (cell) &&
+	 (!cell_owns_point (cell, &target) ||
+	  (max_depth >= 0 && ftt_cell_level (cell) > max_depth)))
+    cell = ftt_cell_parent (cell);
+  /* points on the boundary of a box may belong to a neighboring box */
+  if (FTT_CELL_IS_ROOT (cell) && !cell_contains_point (cell, &target))
+    return gfs_domain_locate (domain, target, max_depth, NULL);
+  return ftt_cell_locate (cell, target, max_depth);
+}
+
 /**
  * gfs_domain_boundary_locate:
  * @domain: a #GfsDomain.
@@ -2780,7 +3138,7 @@ void gfs_domain_advect_point (GfsDomain * domain,
   u = gfs_domain_velocity (domain);
   for (c = 0; c < FTT_DIMENSION; c++)
     (&p1.x)[c] += dt*gfs_interpolate (cell, p0, u[c])/2.;
-  cell = gfs_domain_locate (domain, p1, -1, NULL);
+  cell = gfs_domain_locate_hint (domain, p1, -1, cell);
   if (cell == NULL)
     return;
   for (c = 0; c < FTT_DIMENSION; c++)
@@ -2969,6 +3327,51 @@ void gfs_cell_reinit (FttCell * cell, GfsDomain * domain)
   cell->data = g_realloc (cell->data, gfs_domain_variables_size (domain));
 }
 
+static void relocate_data (FttCell * cell, gpointer * data)
+{
+  GfsDomain * domain = data[0];
+  GPtrArray * old = data[1];
+  if (cell->data) {
+    gsize size = gfs_domain_variables_size (domain);
+    gpointer d = g_malloc (size);
+    memcpy (d, cell->data, size);
+    g_ptr_array_add (old, cell->data);
+    cell->data = d;
+  }
+}
+
+/**
+ * gfs_domain_relocate_data:
+ * @domain: a #GfsDomain.
+ *
+ * Reallocates the data of all the cells of @domain in the order in
+ * which they are traversed (Morton order within each box, see also
+ * the "morton" parameter of #GfsDomain for the order of the boxes),
+ * so that neighboring cells are more likely to have neighboring data
+ * in memory.
+ *
+ * The old blocks are only freed once all the new blocks have been
+ * allocated, so that the allocator does not reuse them. The peak
+ * memory used by the cell data is therefore twice their size.
+ */
+void gfs_domain_relocate_data (GfsDomain * domain)
+{
+  g_return_if_fail (domain != NULL);
+
+  gfs_domain_timer_start (domain, "relocate_data");
+  gpointer data[2];
+  GPtrArray * old = g_ptr_array_new ();
+  data[0] = domain;
+  data[1] = old;
+  gfs_domain_cell_traverse (domain, FTT_PRE_ORDER, FTT_TRAVERSE_ALL, -1,
+			    (FttCellTraverseFunc) relocate_data, data);
+  guint i;
+  for (i = 0; i < old->len; i++)
+    g_free (old->pdata[i]);
+  g_ptr_array_free (old, TRUE);
+  gfs_domain_timer_stop (domain, "relocate_data");
+}
+
 /**
  * gfs_cell_fine_init:
  * @parent: a #FttCell.
@@ -4124,30 +4527,237 @@ void gfs_domain_remove_specks (GfsDomain * domain)
 }
 
 /**
- * gfs_domain_timer_start:
+ * gfs_domain_timer:
  * @domain: a #GfsDomain.
  * @name: the name of the timer.
  *
- * Starts timer @name of @domain. If @name does not exist it is
- * created first.
+ * Timers which are started and stopped often can be registered once
+ * using this function and then used directly with gfs_timer_start()
+ * and gfs_timer_stop(), which avoids looking up @name each time.
+ *
+ * Returns: timer @name of @domain, created first if it does not exist.
  */
-void gfs_domain_timer_start (GfsDomain * domain, const gchar * name)
+GfsTimer * gfs_domain_timer (GfsDomain * domain, const gchar * name)
 {
   GfsTimer * t;
 
-  g_return_if_fail (domain != NULL);
-  g_return_if_fail (name != NULL);
+  g_return_val_if_fail (domain != NULL, NULL);
+  g_return_val_if_fail (name != NULL, NULL);
 
   t = g_hash_table_lookup (domain->timers, name);
   if (t == NULL) {
-    t = g_malloc (sizeof (GfsTimer));
+    t = g_malloc0 (sizeof (GfsTimer));
     gts_range_init (&t->r);
-    g_hash_table_insert (domain->timers, g_strdup (name), t);
+    t->start = -1.;
+    t->name = g_strdup (name);
+    g_hash_table_insert (domain->timers, t->name, t);
   }
-  else
-    g_return_if_fail (t->start < 0.);
+  return t;
+}
+
+/**
+ * gfs_domain_timer_cached:
+ * @domain: a #GfsDomain.
+ * @name: the name of the timer.
+ * @cache: a #GfsTimerCache, initially filled with zeros.
+ *
+ * Same as gfs_domain_timer() but @name is only looked up when @cache
+ * does not already hold the timer of @domain. This is used by
+ * frequently called functions which keep @cache in a static variable:
+ * the lookup is only repeated when they are called for another
+ * domain.
+ *
+ * Returns: timer @name of @domain, created first if it does not exist.
+ */
+GfsTimer * gfs_domain_timer_cached (GfsDomain * domain, 
+				    const gchar * name,
+				    GfsTimerCache * cache)
+{
+  g_return_val_if_fail (domain != NULL, NULL);
+  g_return_val_if_fail (name != NULL, NULL);
+  g_return_val_if_fail (cache != NULL, NULL);
+
+  if (cache->domain != domain->serial) {
+    cache->t = gfs_domain_timer (domain, name);
+    cache->domain = domain->serial;
+  }
+  return cache->t;
+}
+
+#define COUNTER_ENABLED GFS_COUNTER_NUMBER
+#define COUNTER_RUNNING (GFS_COUNTER_NUMBER + 1)
+
+/* Reads the current values of the hardware counters of @domain
+   (which must be enabled) into @v, followed by the times during which
+   the group was enabled and running (i.e. actually scheduled on the
+   PMU) */
+static gboolean counters_read (GfsDomain * domain, guint64 * v)
+{
+#ifdef HAVE_LINUX_PERF_EVENT_H
+  /* PERF_FORMAT_GROUP layout: nr, time_enabled, time_running, values */
+  guint64 buf[GFS_COUNTER_NUMBER + 3];
+  if (read (domain->counters[0], buf, sizeof (buf)) == sizeof (buf) &&
+      buf[0] == GFS_COUNTER_NUMBER) {
+    memcpy (v, &buf[3], GFS_COUNTER_NUMBER*sizeof (guint64));
+    v[COUNTER_ENABLED] = buf[1];
+    v[COUNTER_RUNNING] = buf[2];
+    return TRUE;
+  }
+#endif /* HAVE_LINUX_PERF_EVENT_H */
+  return FALSE;
+}
+
+/**
+ * gfs_domain_timer_counters:
+ * @domain: a #GfsDomain.
+ *
+ * Enables the hardware performance counters (cycles, instructions,
+ * last-level cache misses and branch misses) of the calling process
+ * for the timers of @domain. The counts accumulated by each timer are
+ * stored in its @counters array.
+ *
+ * This uses the Linux perf_event_open() interface and fails if it is
+ * not available or not permitted (see
+ * /proc/sys/kernel/perf_event_paranoid).
+ *
+ * Returns: %TRUE if the counters are enabled, %FALSE otherwise.
+ */
+gboolean gfs_domain_timer_counters (GfsDomain * domain)
+{
+  g_return_val_if_fail (domain != NULL, FALSE);
+
+  if (domain->counters[0] >= 0)
+    return TRUE;
+#ifdef HAVE_LINUX_PERF_EVENT_H
+  static const guint64 config[GFS_COUNTER_NUMBER] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES
+  };
+  GfsCounter c;
+
+  for (c = 0; c < GFS_COUNTER_NUMBER; c++) {
+    struct perf_event_attr attr;
+    memset (&attr, 0, sizeof (attr));
+    attr.size = sizeof (attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config[c];
+    attr.read_format = (PERF_FORMAT_GROUP |
+			PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    /* the group leader starts disabled and enables all the counters */
+    attr.disabled = (c == 0);
+    domain->counters[c] = syscall (__NR_perf_event_open, &attr, 0, -1, 
+				   c == 0 ? -1 : domain->counters[0], 0);
+    if (domain->counters[c] < 0) {
+      gfs_debug ("perf_event_open: %s", strerror (errno));
+      counters_close (domain);
+      return FALSE;
+    }
+  }
+  ioctl (domain->counters[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  return TRUE;
+#else /* not HAVE_LINUX_PERF_EVENT_H */
+  return FALSE;
+#endif /* not HAVE_LINUX_PERF_EVENT_H */
+}
+
+/**
+ * gfs_timer_start:
+ * @domain: a #GfsDomain.
+ * @t: a #GfsTimer of @domain.
+ *
+ * Starts timer @t. Timers started while @t is running are nested
+ * within @t.
+ */
+void gfs_timer_start (GfsDomain * domain, GfsTimer * t)
+{
+  g_return_if_fail (domain != NULL);
+  g_return_if_fail (t != NULL);
+  g_return_if_fail (t->start < 0.);
+
+  if (t->r.n == 0) {
+    t->parent = domain->running;
+    t->depth = t->parent ? t->parent->depth + 1 : 0;
+  }
+  t->caller = domain->running;
+  domain->running = t;
+  t->nested = 0.;
+  if (domain->counters[0] >= 0 && !counters_read (domain, t->cstart))
+    counters_close (domain);
+  if (domain->counters[0] < 0)
+    memset (t->cstart, 0, sizeof (t->cstart));
+  t->wstart = g_timer_elapsed (domain->clock, NULL);
   t->start = gfs_clock_elapsed (domain->timer);
-  gfs_debug ("starting %s at %g", name, t->start);
+  gfs_debug ("starting %s at %g", t->name, t->start);
+}
+
+/**
+ * gfs_timer_stop:
+ * @domain: a #GfsDomain.
+ * @t: a #GfsTimer of @domain.
+ *
+ * Stops timer @t. This function fails if @t is not the innermost
+ * running timer: timers must be stopped in the reverse order in which
+ * they were started.
+ */
+void gfs_timer_stop (GfsDomain * domain, GfsTimer * t)
+{
+  gdouble end, wend;
+  guint64 cend[GFS_COUNTER_NUMBER + 2];
+
+  g_return_if_fail (domain != NULL);
+  gboolean counters = (domain->counters[0] >= 0 && counters_read (domain, cend));
+  end = gfs_clock_elapsed (domain->timer);
+  wend = g_timer_elapsed (domain->clock, NULL);
+  g_return_if_fail (t != NULL);
+  g_return_if_fail (t->start >= 0.);
+  g_return_if_fail (domain->running == t);
+
+  gts_range_add_value (&t->r, end - t->start);
+  gts_range_update (&t->r);
+  t->self += end - t->start - t->nested;
+  t->wall += wend - t->wstart;
+  if (counters && t->cstart[COUNTER_ENABLED] > 0) {
+    /* when the PMU is shared, the group is only scheduled for part of
+       the time: the counts are scaled to the time it was enabled */
+    gdouble enabled = cend[COUNTER_ENABLED] - t->cstart[COUNTER_ENABLED];
+    gdouble running = cend[COUNTER_RUNNING] - t->cstart[COUNTER_RUNNING];
+    t->enabled += enabled;
+    t->running += running;
+    if (running > 0.) {
+      GfsCounter c;
+      for (c = 0; c < GFS_COUNTER_NUMBER; c++)
+	t->counters[c] += (cend[c] - t->cstart[c])*enabled/running;
+    }
+  }
+  if (t->caller)
+    t->caller->nested += end - t->start;
+  domain->running = t->caller;
+  if (domain->trace) {
+    GfsTimerRecord r = { t, t->wstart, wend - t->wstart };
+    g_array_append_val (domain->trace, r);
+  }
+  gfs_debug ("stopping %s: elapsed: %g", t->name, end - t->start);
+  t->start = -1.;
+}
+
+/**
+ * gfs_domain_timer_start:
+ * @domain: a #GfsDomain.
+ * @name: the name of the timer.
+ *
+ * Starts timer @name of @domain. If @name does not exist it is
+ * created first.
+ */
+void gfs_domain_timer_start (GfsDomain * domain, const gchar * name)
+{
+  g_return_if_fail (domain != NULL);
+  g_return_if_fail (name != NULL);
+
+  gfs_timer_start (domain, gfs_domain_timer (domain, name));
 }
 
 /**
@@ -4161,20 +4771,51 @@ void gfs_domain_timer_start (GfsDomain * domain, const gchar * name)
 void gfs_domain_timer_stop (GfsDomain * domain, const gchar * name)
 {
   GfsTimer * t;
-  gdouble end;
 
   g_return_if_fail (domain != NULL);
-  end = gfs_clock_elapsed (domain->timer);
   g_return_if_fail (name != NULL);
 
   t = g_hash_table_lookup (domain->timers, name);
   g_return_if_fail (t != NULL);
-  g_return_if_fail (t->start >= 0.);
 
-  gts_range_add_value (&t->r, end - t->start);
-  gts_range_update (&t->r);
-  gfs_debug ("stopping %s: elapsed: %g", name, end - t->start);
-  t->start = -1.;
+  gfs_timer_stop (domain, t);
+}
+
+/**
+ * gfs_domain_timer_add_items:
+ * @domain: a #GfsDomain.
+ * @n: a number of items.
+ *
+ * Adds @n items (cells, faces...) to the number of items processed
+ * by the innermost running timer of @domain (if any). This is used
+ * to compute the throughput of each timer.
+ */
+void gfs_domain_timer_add_items (GfsDomain * domain, gdouble n)
+{
+  g_return_if_fail (domain != NULL);
+
+  if (domain->running)
+    domain->running->items += n;
+}
+
+/**
+ * gfs_domain_timer_add_leaves:
+ * @domain: a #GfsDomain.
+ *
+ * Adds the number of leaf cells of @domain to the number of items
+ * processed by the innermost running timer of @domain (if any).
+ *
+ * The number of leaf cells is taken from the cached traversal of the
+ * leaf cells (see gfs_domain_cell_traverse_borrow()): the cells are
+ * only counted again when the mesh changes.
+ */
+void gfs_domain_timer_add_leaves (GfsDomain * domain)
+{
+  g_return_if_fail (domain != NULL);
+
+  if (domain->running)
+    domain->running->items += 
+      cached_traversal (domain, FTT_PRE_ORDER, FTT_TRAVERSE_LEAFS, -1)->n;
 }
 
 static void cell_combine_traverse (FttCell * cell,
@@ -47,17 +47,57 @@ typedef struct _GfsDiffusion       GfsDiffusion;
 typedef struct _GfsSourceDiffusion GfsSourceDiffusion;
 typedef struct _GfsTimer           GfsTimer;
 
+typedef enum {
+  GFS_COUNTER_CYCLES,
+  GFS_COUNTER_INSTRUCTIONS,
+  GFS_COUNTER_CACHE_MISSES,
+  GFS_COUNTER_BRANCH_MISSES,
+  GFS_COUNTER_NUMBER
+} GfsCounter;
+
 struct _GfsTimer {
   GtsRange r;
   gdouble start;
+
+  gchar * name;     /**< the name of the timer (owned by the timers hash table) */
+  GfsTimer * parent; /**< the timer enclosing the first call of this timer or %NULL */
+  guint depth;      /**< the nesting depth of the first call */
+  gdouble self;     /**< total CPU time spent outside of nested timers */
+  gdouble wall;     /**< total wall-clock time */
+  gdouble items;    /**< number of items (cells, faces...) processed */
+  gdouble counters[GFS_COUNTER_NUMBER]; /**< hardware counter totals (see
+					   gfs_domain_timer_counters()) */
+  gdouble enabled, running; /**< total times (in ns) during which the
+			       counters were enabled and actually counting */
+
+  /*< private >*/
+  GfsTimer * caller;
+  gdouble nested, wstart;
+  guint64 cstart[GFS_COUNTER_NUMBER + 2]; /* counters, time enabled, time running */
 };
 
+typedef struct {
+  GfsTimer * t;
+  gdouble start, duration; /**< wall-clock start time and duration */
+} GfsTimerRecord;
+
+typedef struct {
+  guint domain;  /**< the serial number of the domain of @t or zero */
+  GfsTimer * t;
+} GfsTimerCache;
+
 struct _GfsDomain {
   GtsWGraph parent;
 
   int pid;
   GfsClock * timer;
   GHashTable * timers;
+  guint serial;       /**< a number unique to each domain (see gfs_domain_timer_cached()) */
+  GfsTimer * running; /**< the innermost running timer */
+  GArray * trace;     /**< if not %NULL, the #GfsTimerRecord of each call are
+			 appended to this array */
+  gint counters[GFS_COUNTER_NUMBER]; /**< file descriptors of the hardware
+					counters or -1 */
 
   GtsRange timestep;
   GtsRange size;
@@ -120,6 +160,11 @@ struct _GfsDomain {
 
   GPtrArray * sorted; /**< array of sorted boxes */
   gboolean dirty;     /**< whether the sorted array needs updating */
+  guint morton;       /**< if non-zero, boxes are sorted in Morton order and cell data
+			 are relocated every @morton reshapes */
+  guint nreshape;     /**< number of reshapes since the last relocation */
+  GSList * traversals;      /**< cached traversals (see gfs_domain_cell_traverse_borrow()) */
+  guint traversals_version; /**< topology version of the cached traversals */
 
   GSList * projections; /**< list of GfsDomainProjection associated with this domain */
 
@@ -160,6 +205,11 @@ FttCellTraverse * gfs_domain_cell_traverse_new (GfsDomain * domain,
 						FttTraverseType order,
 						FttTraverseFlags flags,
 						gint max_depth);
+void         gfs_domain_cell_traverse_borrow  (GfsDomain * domain,
+					       FttTraverseType order,
+					       FttTraverseFlags flags,
+					       gint max_depth,
+					       FttCellTraverse * t);
 void         gfs_domain_traverse_layers       (GfsDomain * domain,
 					       FttCellTraverseFunc func,
 					       gpointer data);
@@ -213,6 +263,11 @@ void         gfs_domain_bc                    (GfsDomain * domain,
 					       FttTraverseFlags flags,
 					       gint max_depth,
 					       GfsVariable * v);
+void         gfs_domain_bc_bundle             (GfsDomain * domain,
+					       FttTraverseFlags flags,
+					       gint max_depth,
+					       GfsVariable ** v,
+					       guint n);
 void         gfs_domain_copy_bc               (GfsDomain * domain,
 					       FttTraverseFlags flags,
 					       gint max_depth,
@@ -291,6 +346,10 @@ FttCell *    gfs_domain_locate                (GfsDomain * domain,
 					       FttVector target,
 					       gint max_depth,
 					       GfsBox ** where);
+FttCell *    gfs_domain_locate_hint           (GfsDomain * domain,
+					       FttVector target,
+					       gint max_depth,
+					       FttCell * hint);
 FttCell *    gfs_domain_boundary_locate       (GfsDomain * domain,
 					       FttVector target,
 					       gint max_depth,
@@ -315,6 +374,7 @@ void         gfs_cell_init                    (FttCell * cell,
 					       GfsDomain * domain);
 void         gfs_cell_reinit                  (FttCell * cell, 
 					       GfsDomain * domain);
+void         gfs_domain_relocate_data         (GfsDomain * domain);
 void         gfs_cell_fine_init               (FttCell * cell,
 					       GfsDomain * domain);
 void         gfs_cell_copy                    (const FttCell * from, 
@@ -364,6 +424,19 @@ void         gfs_domain_timer_start           (GfsDomain * domain,
 					       const gchar * name);
 void         gfs_domain_timer_stop            (GfsDomain * domain, 
 					       const gchar * name);
+GfsTimer *   gfs_domain_timer                 (GfsDomain * domain, 
+					       const gchar * name);
+GfsTimer *   gfs_domain_timer_cached          (GfsDomain * domain, 
+					       const gchar * name,
+					       GfsTimerCache * cache);
+void         gfs_timer_start                  (GfsDomain * domain,
+					       GfsTimer * t);
+void         gfs_timer_stop                   (GfsDomain * domain,
+					       GfsTimer * t);
+void         gfs_domain_timer_add_items       (GfsDomain * domain,
+					       gdouble n);
+void         gfs_domain_timer_add_leaves      (GfsDomain * domain);
+gboolean     gfs_domain_timer_counters        (GfsDomain * domain);
 typedef
 void      (* FttCellCombineTraverseFunc)      (FttCell * cell1, 
 					       FttCell * cell2, 
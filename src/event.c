@@ -30,6 +30,8 @@
 #include "solid.h"
 #include "output.h"
 #include "init.h"
+#include "particle.h"
+#include "vof.h"
 
 /**
  * Any action to be performed at a given time.
@@ -166,6 +168,7 @@ static void event_init (GfsEvent * object)
 
   object->n         = 0;
   object->end_event = FALSE;
+  object->timer     = NULL;
 }
 
 static void gfs_event_read (GtsObject ** o, GtsFile * fp)
@@ -447,15 +450,21 @@ void gfs_event_do (GfsEvent * event, GfsSimulation * sim)
   g_return_if_fail (event != NULL);
   g_return_if_fail (sim != NULL);
   
-  gchar * name = GTS_OBJECT (event)->klass->info.name;
-  gfs_domain_timer_start (GFS_DOMAIN (sim), name);
+  /* the timer is only looked up once for the simulation of @event */
+  GfsTimer * t = event->timer;
+  if (t == NULL || sim != gfs_object_simulation (event)) {
+    t = gfs_domain_timer (GFS_DOMAIN (sim), GTS_OBJECT (event)->klass->info.name);
+    if (sim == gfs_object_simulation (event))
+      event->timer = t;
+  }
+  gfs_timer_start (GFS_DOMAIN (sim), t);
 
   klass = GFS_EVENT_CLASS (GTS_OBJECT (event)->klass);
   g_assert (klass->event);
   if ((* klass->event) (event, sim) && klass->post_event)
     (* klass->post_event) (event, sim);
 
-  gfs_domain_timer_stop (GFS_DOMAIN (sim), name);
+  gfs_timer_stop (GFS_DOMAIN (sim), t);
 }
 
 /**
@@ -726,6 +735,7 @@ static gboolean gfs_init_event (GfsEvent * event, GfsSimulation * sim)
 	gfs_domain_traverse_leaves (GFS_DOMAIN (sim), (FttCellTraverseFunc) 
 				    (vf->n == 1 ? init_scalar : init_vector), vf);
       gfs_restore_fpe_for_function (vf->f[0]);
+      gfs_vof_interface_invalidate (vf->v[0]);
       if (vf->v[0]->component == FTT_DIMENSION)
 	gfs_domain_bc (GFS_DOMAIN (sim), FTT_TRAVERSE_LEAFS, -1, vf->v[0]);
       i = i->next;
@@ -2075,6 +2085,7 @@ static gboolean gfs_init_fraction_event (GfsEvent * event, GfsSimulation * sim)
     gfs_domain_init_fraction (GFS_DOMAIN (sim), 
 			      GFS_INIT_FRACTION (event)->surface,
 			      GFS_INIT_FRACTION (event)->c);
+    gfs_vof_interface_invalidate (GFS_INIT_FRACTION (event)->c);
     return TRUE;
   }
   return FALSE;
@@ -2152,6 +2163,7 @@ static gboolean gfs_remove_droplets_event (GfsEvent * event, GfsSimulation * sim
       gfs_domain_remove_droplets (domain, d->v, d->c, d->min, d->val);
       gts_object_destroy (GTS_OBJECT (d->v));
     }
+    gfs_vof_interface_invalidate (d->c);
     return TRUE;
   }
   return FALSE;
@@ -2352,6 +2364,7 @@ static gboolean gfs_event_filter_event (GfsEvent * event, GfsSimulation * sim)
     gfs_traverse_and_bc (GFS_DOMAIN (sim), FTT_PRE_ORDER, FTT_TRAVERSE_LEAFS, -1,
 			 (FttCellTraverseFunc) filtered, f,
 			 f->v, f->v);
+    gfs_vof_interface_invalidate (f->v);
     gts_object_destroy (GTS_OBJECT (f->tmp));
     return TRUE;
   }
@@ -2432,12 +2445,34 @@ GfsEventClass * gfs_event_filter_class (void)
  * \beginobject{GfsEventList}
  */
 
+static gboolean only_particles (GSList * i)
+{
+  while (i) {
+    if (GTS_OBJECT (i->data)->klass != GTS_OBJECT_CLASS (gfs_particle_class ()))
+      return FALSE;
+    i = i->next;
+  }
+  return TRUE;
+}
+
 static gboolean gfs_event_list_event (GfsEvent * event, GfsSimulation * sim)
 {
   if ((* GFS_EVENT_CLASS (GTS_OBJECT_CLASS (gfs_event_list_class ())->parent_class)->event) 
       (event, sim)) {
-    gts_container_foreach (GTS_CONTAINER (GFS_EVENT_LIST (event)->list), 
-			   (GtsFunc) gfs_event_do, sim);
+    GfsEventList * l = GFS_EVENT_LIST (event);
+    /* the events of the list share its timing: plain particles are
+       advected together rather than one event at a time. Once
+       distributed, the list of a process can be empty but it must
+       still take part in the migration */
+    if (l->distributed || (l->list->items && only_particles (l->list->items))) {
+      if (!l->distributed) /* each process keeps only its own particles */
+	gfs_particles_migrate (sim, l);
+      gfs_particles_advect (sim, l->list->items, sim->advection_params.dt);
+      gfs_particles_migrate (sim, l);
+    }
+    else
+      gts_container_foreach (GTS_CONTAINER (l->list), 
+			     (GtsFunc) gfs_event_do, sim);
     return TRUE;
   }
   return FALSE;
@@ -2546,6 +2581,7 @@ static void gfs_event_list_class_init (GfsEventClass * klass)
 
 static void gfs_event_list_init (GfsEventList * l)
 {
+  l->distributed = FALSE;
   l->list = 
     GTS_SLIST_CONTAINER (gts_container_new (GTS_CONTAINER_CLASS (gts_slist_container_class ())));
 }
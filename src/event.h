@@ -38,6 +38,9 @@ struct _GfsEvent {
   guint n;
   gboolean end_event, realised, redo;
   gchar * name;
+
+  /*< private >*/
+  gpointer timer; /* the GfsTimer of the class of the event (see gfs_event_do()) */
 };
 
 typedef struct _GfsSimulation           GfsSimulation;
@@ -373,6 +376,7 @@ typedef struct _GfsEventList         GfsEventList;
 struct _GfsEventList {
   /*< private >*/
   GfsEvent parent;
+  gboolean distributed;
 
   /*< public >*/
   GtsObjectClass * klass;
@@ -310,24 +310,24 @@ static Gradient gradient_fine_coarse (const FttCellFace * face, guint v)
 
 #define REFINE_CORNER(cell) {if (cell && FTT_CELL_IS_LEAF (cell) && \
                               ftt_cell_level (cell) < level - 1) \
-	                    ftt_cell_refine_single (cell, init, data);}
+	                    (* refine) (cell, data);}
 
-void ftt_cell_refine_corners (FttCell * cell,
-			      FttCellInitFunc init,
-			      gpointer data)
+/* Calls @refine for each "corner" neighbor of @cell which must be
+   refined before @cell can be refined */
+static void corners_foreach (FttCell * cell,
+			     void (* refine) (FttCell *, gpointer),
+			     gpointer data)
 {
   FttDirection d;
   FttCellNeighbors neighbor;
   guint level;
 
-  g_return_if_fail (cell != NULL);
-
   level = ftt_cell_level (cell);
   ftt_cell_neighbors (cell, &neighbor);
   for (d = 0; d < FTT_NEIGHBORS; d++)
     if (neighbor.c[d] && ftt_cell_level (neighbor.c[d]) < level) {
       if (GFS_CELL_IS_BOUNDARY (neighbor.c[d]))
-	ftt_cell_refine_single (neighbor.c[d], init, data);
+	(* refine) (neighbor.c[d], data);
       else {
 	FttCell * n;
 #if FTT_2D
@@ -352,6 +352,48 @@ void ftt_cell_refine_corners (FttCell * cell,
     }
 }
 
+static void refine_corner (FttCell * cell, gpointer * data)
+{
+  ftt_cell_refine_single (cell, data[0], data[1]);
+}
+
+void ftt_cell_refine_corners (FttCell * cell,
+			      FttCellInitFunc init,
+			      gpointer data)
+{
+  gpointer d[2];
+
+  g_return_if_fail (cell != NULL);
+
+  d[0] = init;
+  d[1] = data;
+  corners_foreach (cell, (void (*) (FttCell *, gpointer)) refine_corner, d);
+}
+
+static void add_corner (FttCell * cell, GPtrArray * cells)
+{
+  g_ptr_array_add (cells, cell);
+}
+
+/**
+ * ftt_cell_refine_corners_array:
+ * @cell: a #FttCell.
+ * @cells: a #GPtrArray.
+ *
+ * Adds to @cells the "corner" neighbors of @cell which
+ * ftt_cell_refine_corners() would refine. Refining @cells with
+ * ftt_cell_refine_array() then gives the same mesh as calling
+ * ftt_cell_refine_corners() for each cell.
+ */
+void ftt_cell_refine_corners_array (FttCell * cell,
+				    GPtrArray * cells)
+{
+  g_return_if_fail (cell != NULL);
+  g_return_if_fail (cells != NULL);
+
+  corners_foreach (cell, (void (*) (FttCell *, gpointer)) add_corner, cells);
+}
+
 /**
  * gfs_neighbor_value:
  * @face: a #FttCellFace.
@@ -2614,6 +2656,59 @@ void gfs_cell_corner_values (FttCell * cell,
   f[4*(FTT_DIMENSION - 1)] = GFS_VALUE (cell, v);
 }
 
+/**
+ * gfs_cell_corner_values_array:
+ * @cell: a #FttCell.
+ * @v: an array of #GfsVariable.
+ * @n: the size of @v.
+ * @max_level: the maximum cell level to consider (-1 means no restriction).
+ * @f: an array of size @n*(4*(FTT_DIMENSION - 1) + 1).
+ *
+ * Fills @f with the values of each variable of @v interpolated at the
+ * corners of @cell, in the same order as gfs_cell_corner_values().
+ *
+ * When the variables have the same centering, the corner
+ * interpolators are only computed once for all the variables.
+ */
+void gfs_cell_corner_values_array (FttCell * cell, 
+				   GfsVariable ** v,
+				   guint n,
+				   gint max_level,
+				   gdouble * f)
+{
+  guint i, j, k, nc = 4*(FTT_DIMENSION - 1) + 1;
+
+  g_return_if_fail (cell != NULL);
+  g_return_if_fail (v != NULL);
+  g_return_if_fail (f != NULL);
+
+  for (j = 1; j < n; j++)
+    if (v[j]->centered != v[0]->centered) {
+      for (j = 0; j < n; j++)
+	gfs_cell_corner_values (cell, v[j], max_level, &f[j*nc]);
+      return;
+    }
+
+  for (i = 0; i < nc - 1; i++) {
+    GfsInterpolator inter;
+    gfs_cell_corner_interpolator (cell, corner[i], max_level, v[0]->centered, &inter);
+    for (j = 0; j < n; j++) {
+      gdouble val = 0.;
+      for (k = 0; k < inter.n; k++) {
+	gdouble v1 = GFS_VALUE (inter.c[k], v[j]);
+	if (v1 == GFS_NODATA) {
+	  val = GFS_VALUE (cell, v[j]);
+	  break;
+	}
+	val += inter.w[k]*v1;
+      }
+      f[j*nc + i] = val;
+    }
+  }
+  for (j = 0; j < n; j++)
+    f[j*nc + nc - 1] = GFS_VALUE (cell, v[j]);
+}
+
 /**
  * gfs_interpolate_from_corners:
  * @cell: a #FttCell containing location @p.
@@ -3085,6 +3180,74 @@ gdouble gfs_cell_corner_value (FttCell * cell,
   return val;
 }
 
+/**
+ * gfs_cell_corner_interpolators:
+ * @cell: a #FttCell.
+ * @max_level: the maximum cell level to consider (-1 means no restriction).
+ * @centered: %TRUE if the interpolators are for cell-centered variables.
+ * @inter: an array of 4*(FTT_DIMENSION - 1) #GfsInterpolator.
+ *
+ * Fills @inter with the interpolators for each corner of @cell, in
+ * the order used by gfs_cell_corner_values(). The interpolators can
+ * be reused for all the variables with the same centering.
+ *
+ * Cell-centered interpolators only depend on the topology of the mesh
+ * (see ftt_topology_version()). Face-centered interpolators also
+ * depend on the solid fractions and centers of mass of the mixed
+ * cells involved: they must be recomputed when the solid boundaries
+ * move.
+ */
+void gfs_cell_corner_interpolators (FttCell * cell,
+				    gint max_level,
+				    gboolean centered,
+				    GfsInterpolator * inter)
+{
+  guint i;
+
+  g_return_if_fail (cell != NULL);
+  g_return_if_fail (inter != NULL);
+
+  for (i = 0; i < 4*(FTT_DIMENSION - 1); i++)
+    gfs_cell_corner_interpolator (cell, corner[i], max_level, centered, &inter[i]);
+}
+
+/**
+ * gfs_cell_corner_values_from_interpolators:
+ * @cell: a #FttCell.
+ * @v: a #GfsVariable.
+ * @inter: the interpolators of @cell (see gfs_cell_corner_interpolators()).
+ * @f: an array of size 4*(FTT_DIMENSION - 1) + 1.
+ *
+ * Same as gfs_cell_corner_values() but using interpolators computed
+ * beforehand.
+ */
+void gfs_cell_corner_values_from_interpolators (FttCell * cell,
+						GfsVariable * v,
+						const GfsInterpolator * inter,
+						gdouble f[4*(FTT_DIMENSION - 1) + 1])
+{
+  guint i, j;
+
+  g_return_if_fail (cell != NULL);
+  g_return_if_fail (v != NULL);
+  g_return_if_fail (inter != NULL);
+  g_return_if_fail (f != NULL);
+
+  for (i = 0; i < 4*(FTT_DIMENSION - 1); i++) {
+    gdouble val = 0.;
+    for (j = 0; j < inter[i].n; j++) {
+      gdouble v1 = GFS_VALUE (inter[i].c[j], v);
+      if (v1 == GFS_NODATA) {
+	val = GFS_VALUE (cell, v);
+	break;
+      }
+      val += inter[i].w[j]*v1;
+    }
+    f[i] = val;
+  }
+  f[4*(FTT_DIMENSION - 1)] = GFS_VALUE (cell, v);
+}
+
 /* GfsStencil: Object */
 
 /* The convention is that the first element is the diagonal */
@@ -238,6 +238,11 @@ void                  gfs_cell_corner_values        (FttCell * cell,
 						     GfsVariable * v, 
 						     gint max_level,
 						     gdouble f[4*(FTT_DIMENSION - 1)]);
+void                  gfs_cell_corner_values_array  (FttCell * cell, 
+						     GfsVariable ** v,
+						     guint n,
+						     gint max_level,
+						     gdouble * f);
 gdouble               gfs_interpolate_from_corners  (FttCell * cell,
 						     FttVector p,
 						     gdouble * f);
@@ -249,6 +254,8 @@ void                  gfs_interpolate_stencil       (FttCell * cell,
 void                  ftt_cell_refine_corners       (FttCell * cell,
 						     FttCellInitFunc init,
 						     gpointer data);
+void                  ftt_cell_refine_corners_array (FttCell * cell,
+						     GPtrArray * cells);
 gdouble               gfs_center_curvature          (FttCell * cell,
 						     FttComponent c,
 						     guint v);
@@ -280,6 +287,14 @@ gdouble               gfs_cell_corner_value         (FttCell * cell,
 						     FttDirection * d,
 						     GfsVariable * v,
 						     gint max_level);
+void                  gfs_cell_corner_interpolators (FttCell * cell,
+						     gint max_level,
+						     gboolean centered,
+						     GfsInterpolator * inter);
+void      gfs_cell_corner_values_from_interpolators (FttCell * cell,
+						     GfsVariable * v,
+						     const GfsInterpolator * inter,
+						     gdouble * f);
 
 /* GfsStencil: Header */
 
@@ -42,6 +42,22 @@ gint ftt_opposite_direction[FTT_NEIGHBORS] =
 typedef struct _FttOct      FttOct;
 typedef struct _FttRootCell FttRootCell;
 
+/* incremented every time cells are created, destroyed or connected */
+static guint topology_version = 0;
+
+/**
+ * ftt_topology_version:
+ *
+ * Returns: a number which changes every time a cell is created or
+ * destroyed or the neighborhood of a cell tree is modified. Results
+ * derived from the topology of cell trees (e.g. pointers to cells)
+ * remain valid as long as this number does not change.
+ */
+guint ftt_topology_version (void)
+{
+  return topology_version;
+}
+
 static void oct_new (FttCell * parent,
 		     gboolean check_neighbors,
 		     FttCellInitFunc init,
@@ -54,6 +70,7 @@ static void oct_new (FttCell * parent,
   g_assert (parent->children == NULL);
 
   oct = g_malloc0 (sizeof (FttOct));
+  topology_version++;
   oct->level = ftt_cell_level (parent);
   oct->parent = parent;
 
@@ -95,6 +112,7 @@ FttCell * ftt_cell_new (FttCellInitFunc init,
   FttCell * cell;
 
   cell = g_malloc0 (sizeof (FttRootCell));
+  topology_version++;
   if (init)
     (* init) (cell, data);
 
@@ -191,6 +209,85 @@ void ftt_cell_refine (FttCell * root,
       ftt_cell_refine (&(oct->cell[n]), refine, refine_data, init, init_data);
 }
 
+static void refine_array_add (GPtrArray ** level, FttCell * cell)
+{
+  if ((cell->flags & FTT_FLAG_TRAVERSED) == 0) {
+    guint l = ftt_cell_level (cell);
+
+    cell->flags |= FTT_FLAG_TRAVERSED;
+    if (level[l] == NULL)
+      level[l] = g_ptr_array_new ();
+    g_ptr_array_add (level[l], cell);
+  }
+}
+
+/**
+ * ftt_cell_refine_array:
+ * @cells: an array of #FttCell.
+ * @init: a #FttCellInitFunc or %NULL.
+ * @init_data: user data to pass to @init.
+ *
+ * Refines all the leaf cells of @cells (the other cells are ignored)
+ * and eventually their neighbors to ensure that the neighborhood
+ * properties are preserved. The new refined cells created are
+ * initialized using @init (if not %NULL).
+ *
+ * The result is identical to calling ftt_cell_refine_single() for
+ * each cell of @cells but the coarser neighbors which need to be
+ * refined are first collected level by level (starting from the
+ * finest level). Each cell is then refined only once, from the
+ * coarsest to the finest level, when all its neighbors are known.
+ */
+void ftt_cell_refine_array (GPtrArray * cells,
+			    FttCellInitFunc init,
+			    gpointer init_data)
+{
+  GPtrArray ** level;
+  guint i, l, nl = 0;
+
+  g_return_if_fail (cells != NULL);
+
+  for (i = 0; i < cells->len; i++) {
+    FttCell * cell = cells->pdata[i];
+    if (FTT_CELL_IS_LEAF (cell) && ftt_cell_level (cell) + 1 > nl)
+      nl = ftt_cell_level (cell) + 1;
+  }
+  if (nl == 0)
+    return;
+
+  level = g_malloc0 (nl*sizeof (GPtrArray *));
+  for (i = 0; i < cells->len; i++) {
+    FttCell * cell = cells->pdata[i];
+    if (FTT_CELL_IS_LEAF (cell) && !FTT_CELL_IS_DESTROYED (cell))
+      refine_array_add (level, cell);
+  }
+
+  /* grading: coarser neighbors of cells to refine must be refined */
+  for (l = nl - 1; l > 0; l--)
+    if (level[l])
+      for (i = 0; i < level[l]->len; i++) {
+	FttCellNeighbors neighbor;
+	FttDirection d;
+
+	ftt_cell_neighbors (level[l]->pdata[i], &neighbor);
+	for (d = 0; d < FTT_NEIGHBORS; d++)
+	  if (neighbor.c[d] && ftt_cell_level (neighbor.c[d]) < l)
+	    refine_array_add (level, neighbor.c[d]);
+      }
+
+  for (l = 0; l < nl; l++)
+    if (level[l]) {
+      for (i = 0; i < level[l]->len; i++) {
+	FttCell * cell = level[l]->pdata[i];
+
+	cell->flags &= ~FTT_FLAG_TRAVERSED;
+	oct_new (cell, FALSE, init, init_data);
+      }
+      g_ptr_array_free (level[l], TRUE);
+    }
+  g_free (level);
+}
+
 /**
  * ftt_cell_draw:
  * @cell: a #FttCell.
@@ -584,6 +681,7 @@ void ftt_cell_set_neighbor (FttCell * root,
   g_return_if_fail (ftt_cell_level (root) == ftt_cell_level (neighbor));
 
   g_return_if_fail (FTT_ROOT_CELL (root)->neighbors.c[d] == NULL);
+  topology_version++;
   FTT_ROOT_CELL (root)->neighbors.c[d] = neighbor;
   update_neighbor (root, d, init, init_data);
 
@@ -678,6 +776,7 @@ void ftt_cell_set_neighbor_match (FttCell * root,
 
   g_return_if_fail (ftt_cell_level (root) == ftt_cell_level (neighbor));
 
+  topology_version++;
   FTT_ROOT_CELL (root)->neighbors.c[d] = neighbor;
   update_neighbor_match (root, d, init, init_data);
 
@@ -1305,6 +1404,7 @@ static void oct_destroy (FttOct * oct,
   g_return_if_fail (oct != NULL);
   g_return_if_fail (oct->parent->children == oct);
 
+  topology_version++;
   oct->parent->children = NULL;
   for (n = 0; n < FTT_CELLS; n++)
     ftt_cell_destroy (&(oct->cell[n]), cleanup, data);
@@ -1339,6 +1439,7 @@ void ftt_cell_destroy (FttCell * cell,
   if (cleanup)
     (* cleanup) (cell, data);
   cell->flags |= FTT_FLAG_DESTROYED;
+  topology_version++;
 
   /* destroy children */
   if (!FTT_CELL_IS_LEAF (cell)) {
@@ -1407,6 +1508,7 @@ void ftt_cell_destroy_root (FttCell * root,
   if (cleanup)
     (* cleanup) (root, data);
   root->flags |= FTT_FLAG_DESTROYED;
+  topology_version++;
 
   ftt_cell_neighbors (root, &neighbor);
   for (i = 0; i < FTT_NEIGHBORS; i++)
@@ -1848,6 +1950,7 @@ static gboolean oct_read (FttCell * parent,
   guint n;
 
   oct = g_malloc0 (sizeof (FttOct));
+  topology_version++;
   oct->level = ftt_cell_level (parent);
   oct->parent = parent;
   parent->children = oct;
@@ -1951,6 +2054,7 @@ static gboolean oct_read_binary (FttCell * parent,
   guint n;
 
   oct = g_malloc0 (sizeof (FttOct));
+  topology_version++;
   oct->level = ftt_cell_level (parent);
   oct->parent = parent;
   parent->children = oct;
@@ -2338,6 +2442,7 @@ gboolean ftt_cell_coarsen (FttCell * root,
 	(* cleanup) (&(root->children->cell[i]), cleanup_data);
   g_free (root->children);
   root->children = NULL;
+  topology_version++;
 
   return TRUE;
 }
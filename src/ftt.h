@@ -216,6 +216,7 @@ gint                 ftt_opposite_direction[FTT_NEIGHBORS];
 
 #endif /* !G_DISABLE_ASSERT */
 
+guint                ftt_topology_version            (void);
 FttCell *            ftt_cell_new                    (FttCellInitFunc init,
 						      gpointer data);
 #define              ftt_cell_level(c)  ((c)->parent ?\
@@ -679,6 +680,9 @@ void                 ftt_cell_refine                 (FttCell * root,
 void                 ftt_cell_refine_single          (FttCell * cell,
 						      FttCellInitFunc init,
 						      gpointer init_data);
+void                 ftt_cell_refine_array           (GPtrArray * cells,
+						      FttCellInitFunc init,
+						      gpointer init_data);
 gboolean             ftt_refine_corner               (const FttCell * cell);
 void                 ftt_cell_traverse               (FttCell * root,
 						      FttTraverseType order,
@@ -171,7 +171,7 @@ int main (int argc, char * argv[])
 	"  -b N   --bubble=N    partition the domain in N subdomains and returns\n" 
 	"                       the corresponding simulation\n"
 	"  -d     --data        when splitting or partitioning, output all data\n"
-	"  -P     --profile     profiles calls to boundary conditions\n"
+	"  -P     --profile     profiles calls to boundary conditions and MPI waits\n"
 #ifdef HAVE_M4
 	"  -m     --macros      Turn macros support on\n"
 	"  -DNAME               Defines NAME as a macro expanding to VALUE\n"
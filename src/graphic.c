@@ -29,6 +29,9 @@
 
 #include <stdlib.h>
 #include <math.h>
+#if HAVE_PTHREAD
+# include <pthread.h>
+#endif
 #include <gts.h>
 
 #include "config.h"
@@ -1876,71 +1879,136 @@ static void vorticity_vector (FttCell * cell, gpointer * data)
 }
 #endif /* 3D */
 
+#define NCORNERS (4*(FTT_DIMENSION - 1) + 1)
+
+/* Corner values of FTT_DIMENSION variables (the velocity or the
+   vorticity components) in a cell */
+typedef struct {
+  FttCell * cell;
+  gdouble f[FTT_DIMENSION*NCORNERS];
+} CellCorners;
+
+/* The two most recently used cells are kept: a streamline usually
+   takes many steps in the same cell */
+static CellCorners * cell_corners (CellCorners cache[2], FttCell * cell, GfsVariable ** v)
+{
+  if (cache[0].cell == cell)
+    return &cache[0];
+  if (cache[1].cell == cell)
+    return &cache[1];
+  cache[1] = cache[0];
+  gfs_cell_corner_values_array (cell, v, FTT_DIMENSION, -1, cache[0].f);
+  cache[0].cell = cell;
+  return &cache[0];
+}
+
+/* same as gfs_interpolate (cell, p, v[c]) */
+static gdouble corners_interpolate (CellCorners * corners, FttVector p, GfsVariable ** v,
+				    FttComponent c)
+{
+  if (GFS_VALUE (corners->cell, v[c]) == GFS_NODATA)
+    return GFS_NODATA;
+  return gfs_interpolate_from_corners (corners->cell, p, &corners->f[c*NCORNERS]);
+}
+
 static gdouble interpolated_velocity (FttCell * cell, FttVector p, GfsVariable ** U,
 				      gdouble direction,
-				      FttVector * u)
+				      FttVector * u,
+				      CellCorners cache[2])
 {
   FttComponent c;
   gdouble nu = 0.;
-  gdouble (* interpolate) (FttCell *, FttVector, GfsVariable * v) = GFS_IS_MIXED (cell) ?
-    gfs_mixed_cell_interpolate : gfs_interpolate;
-  for (c = 0; c < FTT_DIMENSION; c++) {
-    (&u->x)[c] = direction* (*interpolate) (cell, p, U[c]);
-    nu += (&u->x)[c]*(&u->x)[c];
+  if (GFS_IS_MIXED (cell))
+    for (c = 0; c < FTT_DIMENSION; c++) {
+      (&u->x)[c] = direction*gfs_mixed_cell_interpolate (cell, p, U[c]);
+      nu += (&u->x)[c]*(&u->x)[c];
+    }
+  else {
+    CellCorners * corners = cell_corners (cache, cell, U);
+    for (c = 0; c < FTT_DIMENSION; c++) {
+      (&u->x)[c] = direction*corners_interpolate (corners, p, U, c);
+      nu += (&u->x)[c]*(&u->x)[c];
+    }
   }
   return nu;
 }
 
-static GList * grow_curve (GfsDomain * domain,
-			   GfsVariable ** U,
-			   FttVector p,
-			   GfsVariable * var,
-			   gdouble min, 
-			   gdouble max,
-			   gboolean twist,
-			   GList * path,
-			   gdouble direction,
-			   gboolean (* stop) (FttCell *, GList *, gpointer),
-			   gpointer data)
-{
+/* A point of a streamline */
+typedef struct {
+  FttVector p;
+  gdouble v, theta;
+  gboolean colored;
+} CurvePoint;
+
+typedef struct {
+  GfsDomain * domain;
+  GfsVariable ** U, ** vort, * var;
+  gdouble min, max;
+  Colormap * colormap;
+  gboolean (* stop) (FttCell *, GList *, gpointer);
+  gpointer data;
+} StreamlineParams;
+
+static GtsPoint * curve_point_new (const StreamlineParams * s, const CurvePoint * q)
+{
+  GtsPoint * p = gts_point_new (s->vort ? GTS_POINT_CLASS (gfs_twisted_vertex_class ()) :
+				gfs_vertex_class (), q->p.x, q->p.y, q->p.z);
+  if (s->var)
+    GFS_VERTEX (p)->v = q->v;
+  if (s->colormap && q->colored)
+    GTS_COLORED_VERTEX (p)->c = 
+      colormap_color (s->colormap, (GFS_VERTEX (p)->v - s->min)/(s->max - s->min));
+  if (s->vort)
+    GFS_TWISTED_VERTEX (p)->theta = q->theta;
+  return p;
+}
+
+/* Adds point @p of @cell to the curve: to @points if it is not NULL,
+   otherwise as a new GtsPoint prepended to @path. Returns TRUE if
+   the integration must stop. */
+static gboolean curve_add (const StreamlineParams * s, FttCell * cell,
+			   FttVector p, gdouble theta, gboolean last,
+			   GList ** path, GArray * points)
+{
+  CurvePoint q;
+  q.p = p;
+  q.v = s->var ? gfs_interpolate (cell, p, s->var) : 0.;
+  q.theta = theta;
+  q.colored = !last;
+  if (points) {
+    g_array_append_val (points, q);
+    return FALSE;
+  }
+  *path = g_list_prepend (*path, curve_point_new (s, &q));
+  return !last && s->stop != NULL && (* s->stop) (cell, *path, s->data);
+}
+
+/* Integrates the streamline of @s starting at @p in @direction. If
+   @points is not NULL, the points are stored in @points and neither
+   GtsObjects nor the stop function of @s are used, so that this can
+   be called from several threads */
+static void grow_curve (const StreamlineParams * s,
+			FttVector p,
+			gdouble direction,
+			GList ** path,
+			GArray * points)
+{
+  GfsDomain * domain = s->domain;
+  GfsVariable ** U = s->U, ** vort = s->vort;
   FttCell * cell;
   gdouble delta = 0.2;
-  GtsPoint * oldp = NULL;
-  FttVector p1, p2;
+  gboolean started = FALSE;
+  FttVector p1, p2, last;
   gdouble cost = 0., theta = 0.;
   gdouble maxcost = 4e-9;
   guint nstep = 0, nmax = 10000;
-  GtsPointClass * path_class = gfs_vertex_class ();
-  Colormap * colormap = NULL;
+  CellCorners velocity[2], vorticity[2];
 
-  if (min < max)
-    colormap = colormap_jet ();
-
-#if (!FTT_2D)
-  GfsVariable * vort[FTT_DIMENSION];
-  if (twist) {
-    FttComponent c;
-    gpointer data[2];
-
-    path_class = GTS_POINT_CLASS (gfs_twisted_vertex_class ());
-    for (c = 0; c < FTT_DIMENSION; c++)
-      vort[c] = gfs_temporary_variable (domain);
-    gfs_variable_set_vector (vort, FTT_DIMENSION);
-    data[0] = vort;
-    data[1] = U;
-    gfs_domain_cell_traverse (domain, FTT_PRE_ORDER, FTT_TRAVERSE_LEAFS, -1,
-			      (FttCellTraverseFunc) vorticity_vector, data);
-    for (c = 0; c < FTT_DIMENSION; c++)
-      gfs_domain_cell_traverse (domain,
-				FTT_POST_ORDER, FTT_TRAVERSE_NON_LEAFS, -1,
-				(FttCellTraverseFunc) vort[c]->fine_coarse, vort[c]);
-  }
-#else /* 2D */
-  twist = FALSE;
-#endif /* 2D */  
-
-  p1 = p2 = p;
-  while ((cell = gfs_domain_locate (domain, p, -1, NULL)) != NULL &&
+  velocity[0].cell = velocity[1].cell = NULL;
+  vorticity[0].cell = vorticity[1].cell = NULL;
+  p1 = p2 = last = p;
+  cell = NULL;
+  while ((cell = gfs_domain_locate_hint (domain, p, -1, cell)) != NULL &&
 	 circumcircle_radius (p1, p2, p) > ftt_cell_size (cell) &&
 	 nmax--) {
     gdouble h = delta*ftt_cell_size (cell);
@@ -1951,23 +2019,16 @@ static GList * grow_curve (GfsDomain * domain,
     cost += triangle_area (p1, p2, p);
     p1 = p2;
     p2 = p;
-    if (oldp == NULL || cost > maxcost) {
-      oldp = gts_point_new (path_class, p.x, p.y, p.z);
-      if (var)
-	GFS_VERTEX (oldp)->v = gfs_interpolate (cell, p, var);
-      if (colormap)
-	GTS_COLORED_VERTEX (oldp)->c = 
-	  colormap_color (colormap, (GFS_VERTEX (oldp)->v - min)/(max - min));
-      if (twist)
-	GFS_TWISTED_VERTEX (oldp)->theta = theta;
-      path = g_list_prepend (path, oldp);
-      if (stop != NULL && (* stop) (cell, path, data))
+    if (!started || cost > maxcost) {
+      started = TRUE;
+      last = p;
+      if (curve_add (s, cell, p, theta, FALSE, path, points))
 	break;
       cost = 0.;
       nstep = 0;
     }
 
-    nu = interpolated_velocity (cell, p, U, direction, &u);
+    nu = interpolated_velocity (cell, p, U, direction, &u, velocity);
     if (nu > 0) {
       FttVector p1 = p;
       FttCell * cell1;
@@ -1975,10 +2036,10 @@ static GList * grow_curve (GfsDomain * domain,
       nu = 2.*sqrt (nu);
       for (c = 0; c < FTT_DIMENSION; c++)
 	(&p1.x)[c] += h*(&u.x)[c]/nu;
-      cell1 = gfs_domain_locate (domain, p1, -1, NULL);
+      cell1 = gfs_domain_locate_hint (domain, p1, -1, cell);
       if (!cell1)
 	break;
-      nu = interpolated_velocity (cell1, p1, U, direction, &u);
+      nu = interpolated_velocity (cell1, p1, U, direction, &u, velocity);
     }
     else
       break;
@@ -1990,13 +2051,14 @@ static GList * grow_curve (GfsDomain * domain,
       for (c = 0; c < FTT_DIMENSION; c++)
 	((gdouble *) &p)[c] += h*((gdouble *) &u)[c]/nu;
 #if (!FTT_2D)
-      if (twist) {
+      if (vort) {
 	GtsVector rot;
 	GtsVector dx;
+	CellCorners * corners = cell_corners (vorticity, cell, vort);
 
 	dx[0] = p1.x - p.x; dx[1] = p1.y - p.y; dx[2] = p1.z - p.z;
 	for (c = 0; c < FTT_DIMENSION; c++)
-	  rot[c] = gfs_interpolate (cell, p1, vort[c]);
+	  rot[c] = corners_interpolate (corners, p1, vort, c);
 	theta += gts_vector_scalar (rot, dx)/nu;
       }
 #endif /* 3D */
@@ -2004,31 +2066,153 @@ static GList * grow_curve (GfsDomain * domain,
     else
       break;
   }
-  if (oldp && (p2.x != oldp->x || p2.y != oldp->y || p2.z != oldp->z)) {
+  if (started && (p2.x != last.x || p2.y != last.y || p2.z != last.z)) {
     cell = gfs_domain_locate (domain, p2, -1, NULL);
-    if (cell) {
-      oldp = gts_point_new (path_class, p2.x, p2.y, p2.z);
-      if (var)
-	GFS_VERTEX (oldp)->v = gfs_interpolate (cell, p2, var);
-      if (twist)
-	GFS_TWISTED_VERTEX (oldp)->theta = theta;
-      path = g_list_prepend (path, oldp);
-    }
+    if (cell)
+      curve_add (s, cell, p2, theta, TRUE, path, points);
   }
 
-  if (colormap)
-    colormap_destroy (colormap);
+  if (direction > 0. && points == NULL)
+    *path = g_list_reverse (*path);
+}
 
+/* Returns the vorticity vector used to compute the twist of
+   streamlines or NULL in 2D */
+static GfsVariable ** streamline_vorticity_new (GfsDomain * domain, GfsVariable ** U)
+{
 #if (!FTT_2D)
-  if (twist) {
+  GfsVariable ** vort = g_malloc (FTT_DIMENSION*sizeof (GfsVariable *));
+  FttComponent c;
+  gpointer data[2];
+
+  for (c = 0; c < FTT_DIMENSION; c++)
+    vort[c] = gfs_temporary_variable (domain);
+  gfs_variable_set_vector (vort, FTT_DIMENSION);
+  data[0] = vort;
+  data[1] = U;
+  gfs_domain_cell_traverse (domain, FTT_PRE_ORDER, FTT_TRAVERSE_LEAFS, -1,
+			    (FttCellTraverseFunc) vorticity_vector, data);
+  for (c = 0; c < FTT_DIMENSION; c++)
+    gfs_domain_cell_traverse (domain,
+			      FTT_POST_ORDER, FTT_TRAVERSE_NON_LEAFS, -1,
+			      (FttCellTraverseFunc) vort[c]->fine_coarse, vort[c]);
+  return vort;
+#else /* 2D */
+  return NULL;
+#endif /* 2D */  
+}
+
+static void streamline_vorticity_destroy (GfsVariable ** vort)
+{
+  if (vort) {
     FttComponent c;
     for (c = 0; c < FTT_DIMENSION; c++)
       gts_object_destroy (GTS_OBJECT (vort[c]));
+    g_free (vort);
   }
-#endif /* 3D */
-  return direction > 0. ? g_list_reverse (path) : path;
 }
 
+static GList * streamline_new (const StreamlineParams * s, FttVector p)
+{
+  GList * i = NULL, * path;
+
+  grow_curve (s, p, 1., &i, NULL);
+  path = g_list_remove_link (i, i);
+  if (i != NULL)
+    gts_object_destroy (i->data);
+  g_list_free_1 (i);
+  grow_curve (s, p, -1., &path, NULL);
+  return path;
+}
+
+/* Returns the streamline made of the points of grow_curve() in both
+   directions, in the same order as streamline_new() */
+static GList * streamline_from_points (const StreamlineParams * s,
+				       GArray * forward, GArray * backward)
+{
+  GList * path = NULL;
+  guint i;
+
+  /* the seed is the first forward point */
+  for (i = forward->len; i > 1; i--)
+    path = g_list_prepend (path, curve_point_new (s, &g_array_index (forward, CurvePoint, i - 1)));
+  for (i = 0; i < backward->len; i++)
+    path = g_list_prepend (path, curve_point_new (s, &g_array_index (backward, CurvePoint, i)));
+  return path;
+}
+
+#if HAVE_PTHREAD
+typedef struct {
+  const StreamlineParams * s;
+  FttVector * p;
+  GArray ** forward, ** backward;
+  guint start, step, n;
+} StreamlineThread;
+
+static void * streamlines_thread (void * data)
+{
+  StreamlineThread * t = data;
+  guint i;
+
+  for (i = t->start; i < t->n; i += t->step) {
+    grow_curve (t->s, t->p[i], 1., NULL, t->forward[i]);
+    grow_curve (t->s, t->p[i], -1., NULL, t->backward[i]);
+  }
+  return NULL;
+}
+
+/* Integrates the streamlines of the seeds @p using @nthreads threads.
+   The GtsPoints are created once all the threads have joined. */
+static void streamlines_threads (const StreamlineParams * s,
+				 FttVector * p, guint n, guint nthreads,
+				 GList ** path)
+{
+  guint nt = MIN (nthreads, n), i;
+  GArray ** forward = g_malloc (2*n*sizeof (GArray *)), ** backward = forward + n;
+  StreamlineThread * t = g_malloc (nt*sizeof (StreamlineThread));
+  pthread_t * thread = g_malloc (nt*sizeof (pthread_t));
+  gboolean * running = g_malloc0 (nt*sizeof (gboolean));
+
+  /* the arrays are created before the threads start: only g_realloc()
+     is called by the threads */
+  for (i = 0; i < n; i++) {
+    forward[i] = g_array_new (FALSE, FALSE, sizeof (CurvePoint));
+    backward[i] = g_array_new (FALSE, FALSE, sizeof (CurvePoint));
+  }
+  for (i = 0; i < nt; i++) {
+    t[i].s = s;
+    t[i].p = p;
+    t[i].forward = forward;
+    t[i].backward = backward;
+    t[i].start = i;
+    t[i].step = nt;
+    t[i].n = n;
+    if (i > 0)
+      running[i] = !pthread_create (&thread[i], NULL, streamlines_thread, &t[i]);
+  }
+  /* the calling thread takes the first share and those of the
+     threads which could not be created */
+  for (i = 0; i < nt; i++)
+    if (!running[i])
+      streamlines_thread (&t[i]);
+  for (i = 1; i < nt; i++)
+    if (running[i]) {
+      int ret = pthread_join (thread[i], NULL);
+      g_assert (ret == 0);
+    }
+
+  for (i = 0; i < n; i++) {
+    path[i] = streamline_from_points (s, forward[i], backward[i]);
+    g_array_free (forward[i], TRUE);
+    g_array_free (backward[i], TRUE);
+  }
+  g_free (forward);
+  g_free (t);
+  g_free (thread);
+  g_free (running);
+}
+#endif /* HAVE_PTHREAD */
+
 GList * gfs_streamline_new (GfsDomain * domain,
 			    GfsVariable ** U,
 			    FttVector p,
@@ -2041,17 +2225,81 @@ GList * gfs_streamline_new (GfsDomain * domain,
 					       gpointer),
 			    gpointer data)
 {
-  GList * i, * path;
+  g_return_val_if_fail (domain != NULL, NULL);
+  g_return_val_if_fail (U != NULL, NULL);
+
+  StreamlineParams s = { domain, U, NULL, var, min, max, NULL, stop, data };
+  s.colormap = min < max ? colormap_jet () : NULL;
+  s.vort = twist ? streamline_vorticity_new (domain, U) : NULL;
+  GList * path = streamline_new (&s, p);
+  streamline_vorticity_destroy (s.vort);
+  if (s.colormap)
+    colormap_destroy (s.colormap);
+  return path;
+}
 
+/**
+ * gfs_streamlines_new:
+ * @domain: a #GfsDomain.
+ * @U: the velocity components.
+ * @p: an array of @n seeds.
+ * @n: the number of seeds.
+ * @var: a #GfsVariable to interpolate along the streamlines or %NULL.
+ * @min: the minimum of the colormap.
+ * @max: the maximum of the colormap.
+ * @twist: whether to compute the twist of the streamlines.
+ * @nthreads: the number of threads to use.
+ * @stop: a function to stop the integration or %NULL.
+ * @data: user data to pass to @stop.
+ *
+ * Same as calling gfs_streamline_new() for each seed of @p, but the
+ * colormap and the vorticity field needed to compute the twist are
+ * only computed once for all the streamlines.
+ *
+ * If @nthreads is larger than one, the streamlines are integrated
+ * by @nthreads POSIX threads (if available) and the resulting
+ * streamlines are identical. This is only done if @stop is %NULL
+ * and if @domain has no solid boundaries: the boundary conditions
+ * evaluated in mixed cells and the @stop function are not
+ * thread-safe.
+ *
+ * Returns: an array of @n streamlines, to be freed with g_free()
+ * after calling gfs_streamline_destroy() on each streamline.
+ */
+GList ** gfs_streamlines_new (GfsDomain * domain,
+			      GfsVariable ** U,
+			      FttVector * p,
+			      guint n,
+			      GfsVariable * var,
+			      gdouble min,
+			      gdouble max,
+			      gboolean twist,
+			      guint nthreads,
+			      gboolean (* stop) (FttCell *, 
+						 GList *,
+						 gpointer),
+			      gpointer data)
+{
   g_return_val_if_fail (domain != NULL, NULL);
   g_return_val_if_fail (U != NULL, NULL);
+  g_return_val_if_fail (p != NULL || n == 0, NULL);
 
-  i = grow_curve (domain, U, p, var, min, max, twist, NULL, 1., stop, data);
-  path = g_list_remove_link (i, i);
-  if (i != NULL)
-    gts_object_destroy (i->data);
-  g_list_free_1 (i);
-  path = grow_curve (domain, U, p, var, min, max, twist, path, -1., stop, data);
+  StreamlineParams s = { domain, U, NULL, var, min, max, NULL, stop, data };
+  s.colormap = min < max ? colormap_jet () : NULL;
+  s.vort = twist ? streamline_vorticity_new (domain, U) : NULL;
+  GList ** path = g_malloc (n*sizeof (GList *));
+  guint i;
+#if HAVE_PTHREAD
+  if (nthreads > 1 && n > 1 && stop == NULL &&
+      !(GFS_IS_SIMULATION (domain) && GFS_SIMULATION (domain)->solids->items))
+    streamlines_threads (&s, p, n, nthreads, path);
+  else
+#endif /* HAVE_PTHREAD */
+    for (i = 0; i < n; i++)
+      path[i] = streamline_new (&s, p[i]);
+  streamline_vorticity_destroy (s.vort);
+  if (s.colormap)
+    colormap_destroy (s.colormap);
   return path;
 }
 
@@ -109,6 +109,19 @@ GList *            gfs_streamline_new          (GfsDomain * domain,
 								   GList *, 
 								   gpointer),
 						gpointer data);
+GList **           gfs_streamlines_new         (GfsDomain * domain,
+						GfsVariable ** U,
+						FttVector * p,
+						guint n,
+						GfsVariable * var,
+						gdouble min,
+						gdouble max,
+						gboolean twist,
+						guint nthreads,
+						gboolean (* stop) (FttCell *, 
+								   GList *, 
+								   gpointer),
+						gpointer data);
 void               gfs_streamline_write        (GList * stream, 
 						FILE * fp);
 GList *            gfs_streamline_read         (GtsFile * fp);
@@ -260,6 +260,7 @@ GtsObjectClass ** gfs_classes (void)
       gfs_output_solid_stats_class (),
       gfs_output_adapt_stats_class (),
       gfs_output_timing_class (),
+      gfs_output_profile_class (),
       gfs_output_balance_class (),
       gfs_output_solid_force_class (),
       gfs_output_location_class (),
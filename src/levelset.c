@@ -56,11 +56,19 @@ static void variable_distance_read (GtsObject ** o, GtsFile * fp)
 
   if (fp->type == '{') {
     GtsFileVariable var[] = {
-      {GTS_INT, "stencil", TRUE},
+      {GTS_INT,    "stencil", TRUE},
+      {GTS_DOUBLE, "band",    TRUE},
       {GTS_NONE}
     };
     var[0].data = &GFS_VARIABLE_DISTANCE (*o)->stencil; 
+    var[1].data = &GFS_VARIABLE_DISTANCE (*o)->band; 
     gts_file_assign_variables (fp, var);
+    if (fp->type == GTS_ERROR)
+      return;
+    if (var[1].set && GFS_VARIABLE_DISTANCE (*o)->band <= 0.) {
+      gts_file_variable_error (fp, var, "band", "band must be strictly positive");
+      return;
+    }
   }
 }
 
@@ -69,8 +77,14 @@ static void variable_distance_write (GtsObject * o, FILE * fp)
   (* GTS_OBJECT_CLASS (gfs_variable_distance_class ())->parent_class->write) (o, fp);
 
   fprintf (fp, " %s", GFS_VARIABLE_DISTANCE (o)->v->name);
-  if (GFS_VARIABLE_DISTANCE (o)->stencil)
-    fputs (" { stencil = 1 }", fp);
+  if (GFS_VARIABLE_DISTANCE (o)->stencil || GFS_VARIABLE_DISTANCE (o)->band > 0.) {
+    fputs (" {", fp);
+    if (GFS_VARIABLE_DISTANCE (o)->stencil)
+      fputs (" stencil = 1", fp);
+    if (GFS_VARIABLE_DISTANCE (o)->band > 0.)
+      fprintf (fp, " band = %g", GFS_VARIABLE_DISTANCE (o)->band);
+    fputs (" }", fp);
+  }
 }
 
 static gdouble vof_distance2 (FttCell * cell, GtsPoint * t, gpointer v)
@@ -85,33 +99,71 @@ static gdouble vof_distance2 (FttCell * cell, GtsPoint * t, gpointer v)
     return gfs_vof_facet_distance2 (cell, v, t);
 }
 
-static void distance_for_stencil (FttCell * cell, gpointer * data)
+typedef struct {
+  GfsVariableDistance * v;
+  GPtrArray * boxes;
+  gdouble dmax2;
+  FttCell * hint;
+  GfsVariable * s2;
+} DistanceParams;
+
+static void add_box (GfsBox * box, GPtrArray * boxes)
 {
-  GfsVariable * v = data[0];
-  GfsVariable * s2 = data[2];
+  g_ptr_array_add (boxes, box);
+}
+
+static void distance_params_init (DistanceParams * p, GfsVariableDistance * v)
+{
+  p->v = v;
+  p->boxes = g_ptr_array_new ();
+  gts_container_foreach (GTS_CONTAINER (GFS_VARIABLE (v)->domain), (GtsFunc) add_box, p->boxes);
+  p->dmax2 = v->band > 0. ? v->band*v->band : G_MAXDOUBLE;
+  p->hint = NULL;
+  p->s2 = NULL;
+}
+
+static void distance_params_free (DistanceParams * p)
+{
+  g_ptr_array_free (p->boxes, TRUE);
+}
 
-  if (GFS_VALUE (cell, s2)) {
-    GfsVariableDistance * l = GFS_VARIABLE_DISTANCE (v);
-    GtsPoint p;
-    gdouble d2;
-    
-    ftt_cell_pos (cell, (FttVector *) &p.x);
-    d2 = gfs_domain_cell_point_distance2 (v->domain, &p, vof_distance2, l->v, NULL);
-    GFS_VALUE (cell, v) = GFS_VALUE (cell, l->v) > 0.5 ? sqrt (d2) : -sqrt (d2);
+/* The closest interfacial cell of the previous cell visited is used
+   as a first guess: as consecutive leaf cells are usually neighbours,
+   this gives a tight upper bound which prunes most of the tree
+   search. The search is also bounded by the width of the band. */
+static void distance (FttCell * cell, DistanceParams * p)
+{
+  GfsVariableDistance * l = p->v;
+  gdouble dmin = p->dmax2;
+  FttCell * closest = NULL;
+  GtsPoint q;
+  guint i;
+
+  ftt_cell_pos (cell, (FttVector *) &q.x);
+  if (p->hint) {
+    gdouble d = gfs_vof_facet_distance2 (p->hint, GFS_VARIABLE_TRACER_VOF (l->v), &q);
+    if (d < dmin) {
+      dmin = d;
+      closest = p->hint;
+    }
   }
-  else
-    GFS_VALUE (cell, v) = GFS_NODATA;
+  for (i = 0; i < p->boxes->len; i++) {
+    FttCell * root = GFS_BOX (p->boxes->pdata[i])->root;
+    gdouble d = vof_distance2 (root, &q, l->v);
+    if (d < dmin)
+      ftt_cell_point_distance2_internal (root, &q, d, vof_distance2, l->v, &closest, &dmin);
+  }
+  if (closest)
+    p->hint = closest;
+  GFS_VALUE (cell, GFS_VARIABLE (l)) = GFS_VALUE (cell, l->v) > 0.5 ? sqrt (dmin) : -sqrt (dmin);
 }
 
-static void distance (FttCell * cell, GfsVariable * v)
+static void distance_for_stencil (FttCell * cell, DistanceParams * p)
 {
-  GfsVariableDistance * l = GFS_VARIABLE_DISTANCE (v);
-  GtsPoint p;
-  gdouble d2;
-    
-  ftt_cell_pos (cell, (FttVector *) &p.x);
-  d2 = gfs_domain_cell_point_distance2 (v->domain, &p, vof_distance2, l->v, NULL);
-  GFS_VALUE (cell, v) = GFS_VALUE (cell, l->v) > 0.5 ? sqrt (d2) : -sqrt (d2);
+  if (GFS_VALUE (cell, p->s2))
+    distance (cell, p);
+  else
+    GFS_VALUE (cell, GFS_VARIABLE (p->v)) = GFS_NODATA;
 }
 
 static void stencil_interpolate (FttCell * cell, gpointer * data)
@@ -138,9 +190,12 @@ static void variable_distance_event_half (GfsEvent * event, GfsSimulation * sim)
 {
   GfsDomain * domain = GFS_DOMAIN (sim);
   GfsVariableDistance * v = GFS_VARIABLE_DISTANCE (event);
+  DistanceParams p;
 
   gfs_domain_timer_start (domain, "distance");
 
+  distance_params_init (&p, v);
+
   if (v->stencil) { /* fixme: this "acceleration technique"
 		       i.e. computing distance only in a band around
 		       the interface seems to be slower than computing
@@ -163,17 +218,19 @@ static void variable_distance_event_half (GfsEvent * event, GfsSimulation * sim)
 
     gfs_domain_cell_traverse (domain, FTT_POST_ORDER, FTT_TRAVERSE_NON_LEAFS, -1,
 			      (FttCellTraverseFunc) v->v->fine_coarse, v->v);
+    p.s2 = data[2];
     gfs_traverse_and_bc (domain, FTT_PRE_ORDER, FTT_TRAVERSE_LEAFS, -1,
-			 (FttCellTraverseFunc) distance_for_stencil, data,
+			 (FttCellTraverseFunc) distance_for_stencil, &p,
 			 GFS_VARIABLE (event),GFS_VARIABLE (event));
     gts_object_destroy (data[1]);
     gts_object_destroy (data[2]);
   }
   else
     gfs_traverse_and_bc (domain, FTT_PRE_ORDER, FTT_TRAVERSE_LEAFS, -1,
-			 (FttCellTraverseFunc) distance, v,
+			 (FttCellTraverseFunc) distance, &p,
 			 GFS_VARIABLE (event),GFS_VARIABLE (event));
 
+  distance_params_free (&p);
   gfs_domain_timer_stop (domain, "distance");
 }
 
@@ -38,6 +38,8 @@ struct _GfsVariableDistance {
   /*< public >*/
   GfsVariable * v;
   gboolean stencil;
+  gdouble band; /**< if positive, the distance is only computed up to
+		   @band from the interface and is +/- @band further away */
 };
 
 #define GFS_VARIABLE_DISTANCE(obj)            GTS_OBJECT_CAST (obj,\
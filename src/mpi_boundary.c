@@ -138,10 +138,14 @@ static void receive (GfsBoundary * bb,
   GfsDomain * domain = gfs_box_domain (bb->box);
   MPI_Status status;
   gint count;
+  static GfsTimerCache cache = { 0, NULL };
 
   if (domain->pid < 0)
     return;
 
+  if (domain->profile_bc)
+    gfs_timer_start (domain, gfs_domain_timer_cached (domain, "mpi_wait", &cache));
+
 #ifdef PROFILE_MPI
   gdouble start, end;
 
@@ -213,24 +217,32 @@ fflush (DEBUG);
   gts_range_add_value (&domain->mpi_wait, end - start);
 #endif /* PROFILE_MPI */
 
+  if (domain->profile_bc)
+    gfs_timer_stop (domain, cache.t);
+
   (* gfs_boundary_periodic_class ()->receive) (bb, flags, max_depth);
 }
 
 static void synchronize (GfsBoundary * bb)
 {
   GfsBoundaryMpi * boundary = GFS_BOUNDARY_MPI (bb);
+  GfsDomain * domain = gfs_box_domain (bb->box);
   MPI_Status status;
   guint i;
+  static GfsTimerCache cache = { 0, NULL };
 #ifdef PROFILE_MPI
-  GfsDomain * domain = gfs_box_domain (bb->box);
   gdouble start, end;
 
   start = MPI_Wtime ();
 #endif /* PROFILE_MPI */
 
   /* wait for completion of non-blocking send(s) */
+  if (domain->profile_bc)
+    gfs_timer_start (domain, gfs_domain_timer_cached (domain, "mpi_wait", &cache));
   for (i = 0; i < boundary->nrequest; i++)
     MPI_Wait (&(boundary->request[i]), &status);
+  if (domain->profile_bc)
+    gfs_timer_stop (domain, cache.t);
 #ifdef PROFILE_MPI
   end = MPI_Wtime ();
   gts_range_add_value (&domain->mpi_wait, end - start);
@@ -324,7 +324,9 @@ static void ocean_run (GfsSimulation * sim)
     sim->time.t = sim->tnext;
     sim->time.i++;
 
-    gfs_domain_timer_start (domain, "free_surface_pressure");
+    static GfsTimerCache cache = { 0, NULL };
+    GfsTimer * timer = gfs_domain_timer_cached (domain, "free_surface_pressure", &cache);
+    gfs_timer_start (domain, timer);
     GfsVariable * divn = gfs_temporary_variable (domain);
     normal_velocities (domain, gfs_domain_velocity (domain));
     gfs_domain_traverse_leaves (domain, (FttCellTraverseFunc) gfs_normal_divergence_2D, divn);
@@ -337,7 +339,7 @@ static void ocean_run (GfsSimulation * sim)
     gfs_correct_centered_velocities (domain, 2, g, sim->advection_params.dt/2.);
     gts_object_destroy (GTS_OBJECT (g[0]));
     gts_object_destroy (GTS_OBJECT (g[1]));
-    gfs_domain_timer_stop (domain, "free_surface_pressure");
+    gfs_timer_stop (domain, timer);
 
     gfs_domain_cell_traverse (domain,
 			      FTT_POST_ORDER, FTT_TRAVERSE_NON_LEAFS, -1,
@@ -722,7 +724,9 @@ static void ocean_run (GfsSimulation * sim)
 #if !MAC
     gfs_predicted_face_velocities (domain, 2, &sim->advection_params);
 
-    gfs_domain_timer_start (domain, "correct_normal_velocities");
+    static GfsTimerCache cache = { 0, NULL };
+    GfsTimer * timer = gfs_domain_timer_cached (domain, "correct_normal_velocities", &cache);
+    gfs_timer_start (domain, timer);
     gfs_poisson_coefficients (domain, NULL, TRUE, TRUE, TRUE);
     gfs_correct_normal_velocities_weighted (domain, 2, p, g, sim->advection_params.dt/2.,
 					    sim->approx_projection_params.weighted);
@@ -730,7 +734,7 @@ static void ocean_run (GfsSimulation * sim)
 				       FTT_PRE_ORDER, FTT_TRAVERSE_LEAFS, -1,
 				       (FttCellTraverseFunc) compute_w, 
 				       gfs_variable_from_name (domain->variables, "W"));
-    gfs_domain_timer_stop (domain, "correct_normal_velocities");
+    gfs_timer_stop (domain, timer);
 
     i = domain->variables;
     while (i) {
@@ -770,7 +774,9 @@ static void ocean_run (GfsSimulation * sim)
     sim->time.t = sim->tnext;
     sim->time.i++;
 
-    gfs_domain_timer_start (domain, "free_surface_pressure");
+    static GfsTimerCache cache = { 0, NULL };
+    GfsTimer * timer = gfs_domain_timer_cached (domain, "free_surface_pressure", &cache);
+    gfs_timer_start (domain, timer);
     GfsVariable * divn = gfs_temporary_variable (domain);
     depth_integrated_divergence (domain, divn);
     depth_integrated_coefficients (domain);
@@ -786,7 +792,7 @@ static void ocean_run (GfsSimulation * sim)
     gts_object_destroy (GTS_OBJECT (g[0]));
     gts_object_destroy (GTS_OBJECT (g[1]));
     
-    gfs_domain_timer_stop (domain, "free_surface_pressure");
+    gfs_timer_stop (domain, timer);
 
     gfs_domain_cell_traverse (domain,
 			      FTT_POST_ORDER, FTT_TRAVERSE_NON_LEAFS, -1,
@@ -756,7 +756,7 @@ static void print_timing (GHashTable * timers, GfsDomain * domain, FILE * fp)
   g_hash_table_foreach (domain->timers, (GHFunc) get_timer, data);
   qsort (timing, count, sizeof (Timer), compare_timer);
   while (--count >= 0)
-    if (timing[count].t->r.sum > 0.)
+    if (timing[count].t->r.sum > 0.) {
       fprintf (fp, 
 	       "  %s:\n"
 	       "      min: %9.3f avg: %9.3f (%4.1f%%) | %7.3f max: %9.3f\n",
@@ -766,6 +766,14 @@ static void print_timing (GHashTable * timers, GfsDomain * domain, FILE * fp)
 	       domain->timestep.sum > 0. ? 100.*timing[count].t->r.sum/domain->timestep.sum : 0.,
 	       timing[count].t->r.stddev, 
 	       timing[count].t->r.max);
+      gdouble * c = timing[count].t->counters;
+      if (c[GFS_COUNTER_CYCLES] > 0. && c[GFS_COUNTER_INSTRUCTIONS] > 0.)
+	fprintf (fp,
+		 "      IPC: %5.2f cache misses: %7.3f branch misses: %7.3f (per 1000 instructions)\n",
+		 c[GFS_COUNTER_INSTRUCTIONS]/c[GFS_COUNTER_CYCLES],
+		 1000.*c[GFS_COUNTER_CACHE_MISSES]/c[GFS_COUNTER_INSTRUCTIONS],
+		 1000.*c[GFS_COUNTER_BRANCH_MISSES]/c[GFS_COUNTER_INSTRUCTIONS]);
+    }
   g_free (timing);
 }
 
@@ -835,6 +843,319 @@ GfsOutputClass * gfs_output_timing_class (void)
 
 /** \endobject{GfsOutputTiming} */
 
+/**
+ * Writing detailed timer statistics.
+ *
+ * With the option format = CSV (the default), one line is written
+ * per timer, with its parent, depth, number of calls, total and self
+ * CPU times, wall time, items processed and throughput. With format =
+ * JSON, the same fields are written as one JSON object per call. With
+ * format = trace, each timer interval is written as a "complete"
+ * event of the Chrome trace format.
+ *
+ * With the option counters = 1, the cycles, instructions, cache misses
+ * and branch misses measured by the hardware performance counters
+ * (Linux only) are added to each timer. When the counters are shared
+ * with other processes, they only count for part of the time and
+ * their values are scaled accordingly: the "scheduled" column gives
+ * this fraction of the time (1 when the counts are exact, 0 when
+ * the counters are not available).
+ * \beginobject{GfsOutputProfile}
+ */
+
+static void profile_write (GtsObject * o, FILE * fp)
+{
+  GfsOutputProfile * output = GFS_OUTPUT_PROFILE (o);
+
+  (* GTS_OBJECT_CLASS (gfs_output_profile_class ())->parent_class->write) (o, fp);
+
+  fputs (" {", fp);
+  switch (output->format) {
+  case GFS_PROFILE_JSON:  fputs (" format = JSON", fp);  break;
+  case GFS_PROFILE_TRACE: fputs (" format = trace", fp); break;
+  default: break;
+  }
+  if (output->counters)
+    fputs (" counters = 1", fp);
+  fputs (" }", fp);
+}
+
+static void profile_read (GtsObject ** o, GtsFile * fp)
+{
+  (* GTS_OBJECT_CLASS (gfs_output_profile_class ())->parent_class->read) (o, fp);
+  if (fp->type == GTS_ERROR)
+    return;
+
+  GfsOutputProfile * output = GFS_OUTPUT_PROFILE (*o);
+
+  if (fp->type == '{') {
+    GtsFileVariable var[] = {
+      {GTS_STRING, "format",   TRUE},
+      {GTS_INT,    "counters", TRUE},
+      {GTS_NONE}
+    };
+    gchar * format = NULL;
+
+    var[0].data = &format;
+    var[1].data = &output->counters;
+    gts_file_assign_variables (fp, var);
+    if (fp->type == GTS_ERROR) {
+      g_free (format);
+      return;
+    }
+
+    if (format != NULL) {
+      if (!strcmp (format, "CSV"))
+	output->format = GFS_PROFILE_CSV;
+      else if (!strcmp (format, "JSON"))
+	output->format = GFS_PROFILE_JSON;
+      else if (!strcmp (format, "trace"))
+	output->format = GFS_PROFILE_TRACE;
+      else {
+	gts_file_variable_error (fp, var, "format",
+				 "unknown format `%s'", format);
+	g_free (format);
+	return;
+      }
+      g_free (format);
+    }
+  }
+
+  GfsDomain * domain = GFS_DOMAIN (gfs_object_simulation (output));
+  if (output->format == GFS_PROFILE_TRACE && !domain->trace)
+    domain->trace = g_array_new (FALSE, FALSE, sizeof (GfsTimerRecord));
+  if (output->counters && !gfs_domain_timer_counters (domain))
+    g_warning ("GfsOutputProfile: hardware performance counters are not available");
+}
+
+#ifdef HAVE_MPI
+static void append_timer_sum (gchar * name, GfsTimer * t, GString * s)
+{
+  g_string_append_printf (s, "%s %.17g\n", name, t->r.sum);
+}
+
+static void update_rank_range (gchar * name, GtsRange * r)
+{
+  gts_range_update (r);
+}
+#endif /* HAVE_MPI */
+
+static void add_local_range (gchar * name, GfsTimer * t, GHashTable * ranks)
+{
+  GtsRange * r = g_malloc (sizeof (GtsRange));
+  gts_range_init (r);
+  gts_range_add_value (r, t->r.sum);
+  gts_range_update (r);
+  g_hash_table_insert (ranks, g_strdup (name), r);
+}
+
+/* Returns a table of the distribution (across processes) of the
+   total CPU time of each timer, indexed by timer name */
+static GHashTable * profile_ranks (GfsDomain * domain)
+{
+  GHashTable * ranks = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+#ifdef HAVE_MPI
+  if (domain->pid >= 0) {
+    GString * s = g_string_new ("");
+    g_hash_table_foreach (domain->timers, (GHFunc) append_timer_sum, s);
+
+    int n = s->len, * count = NULL, * displ = NULL, total = 0, i;
+    gchar * all = NULL;
+    if (domain->pid == 0)
+      count = g_malloc (domain->np*sizeof (int));
+    MPI_Gather (&n, 1, MPI_INT, count, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (domain->pid == 0) {
+      displ = g_malloc (domain->np*sizeof (int));
+      for (i = 0; i < domain->np; i++) {
+	displ[i] = total;
+	total += count[i];
+      }
+      all = g_malloc (total + 1);
+    }
+    MPI_Gatherv (s->str, n, MPI_CHAR, all, count, displ, MPI_CHAR, 0, MPI_COMM_WORLD);
+    g_string_free (s, TRUE);
+    if (domain->pid == 0) {
+      all[total] = '\0';
+      gchar ** lines = g_strsplit (all, "\n", 0), ** l;
+      for (l = lines; *l; l++) {
+	gchar * sep = strrchr (*l, ' ');
+	if (sep) {
+	  *sep = '\0';
+	  GtsRange * r = g_hash_table_lookup (ranks, *l);
+	  if (r == NULL) {
+	    r = g_malloc (sizeof (GtsRange));
+	    gts_range_init (r);
+	    g_hash_table_insert (ranks, g_strdup (*l), r);
+	  }
+	  gts_range_add_value (r, strtod (sep + 1, NULL));
+	}
+      }
+      g_strfreev (lines);
+      g_hash_table_foreach (ranks, (GHFunc) update_rank_range, NULL);
+      g_free (count);
+      g_free (displ);
+      g_free (all);
+    }
+    return ranks;
+  }
+#endif /* HAVE_MPI */
+  g_hash_table_foreach (domain->timers, (GHFunc) add_local_range, ranks);
+  return ranks;
+}
+
+/* Writes @s to @fp as a quoted JSON string */
+static void json_string_write (const gchar * s, FILE * fp)
+{
+  fputc ('"', fp);
+  for (; *s; s++)
+    switch (*s) {
+    case '"':  fputs ("\\\"", fp); break;
+    case '\\': fputs ("\\\\", fp); break;
+    case '\n': fputs ("\\n", fp); break;
+    case '\t': fputs ("\\t", fp); break;
+    default:
+      if ((guchar) *s < 0x20)
+	fprintf (fp, "\\u%04x", (guchar) *s);
+      else
+	fputc (*s, fp);
+    }
+  fputc ('"', fp);
+}
+
+static void profile_write_timer (GfsOutputProfile * p, FILE * fp, GfsSimulation * sim,
+				 GfsTimer * t, GtsRange * r, gboolean first)
+{
+  gdouble throughput = t->wall > 0. ? t->items/t->wall : 0.;
+
+  gdouble * c = t->counters;
+  gdouble ipc = c[GFS_COUNTER_CYCLES] > 0. ? 
+    c[GFS_COUNTER_INSTRUCTIONS]/c[GFS_COUNTER_CYCLES] : 0.;
+  gdouble scheduled = t->enabled > 0. ? t->running/t->enabled : 0.;
+
+  if (p->format == GFS_PROFILE_CSV)
+    fprintf (fp, "%g,%u,%s,%s,%u,%u,%g,%g,%g,%g,%g,%g,%g,%g,%.0f,%.0f,%.0f,%.0f,%g,%g\n",
+	     sim->time.t, sim->time.i,
+	     t->name, t->parent ? t->parent->name : "", t->depth,
+	     t->r.n, t->r.sum, t->self, t->wall, t->items, throughput,
+	     r ? r->min : t->r.sum, r ? r->mean : t->r.sum, r ? r->max : t->r.sum,
+	     c[GFS_COUNTER_CYCLES], c[GFS_COUNTER_INSTRUCTIONS],
+	     c[GFS_COUNTER_CACHE_MISSES], c[GFS_COUNTER_BRANCH_MISSES], ipc, scheduled);
+  else {
+    fprintf (fp, "%s\n    {\"name\": ", first ? "" : ",");
+    json_string_write (t->name, fp);
+    if (t->parent) {
+      fputs (", \"parent\": ", fp);
+      json_string_write (t->parent->name, fp);
+      fputs (", ", fp);
+    }
+    else
+      fputs (", \"parent\": null, ", fp);
+    fprintf (fp, "\"depth\": %u, \"calls\": %u, \"cpu\": %g, \"self\": %g, \"wall\": %g, "
+	     "\"items\": %g, \"throughput\": %g, "
+	     "\"cpu_min\": %g, \"cpu_avg\": %g, \"cpu_max\": %g, "
+	     "\"cycles\": %.0f, \"instructions\": %.0f, "
+	     "\"cache_misses\": %.0f, \"branch_misses\": %.0f, \"ipc\": %g, "
+	     "\"scheduled\": %g}",
+	     t->depth, t->r.n, t->r.sum, t->self, t->wall, t->items, throughput,
+	     r ? r->min : t->r.sum, r ? r->mean : t->r.sum, r ? r->max : t->r.sum,
+	     c[GFS_COUNTER_CYCLES], c[GFS_COUNTER_INSTRUCTIONS],
+	     c[GFS_COUNTER_CACHE_MISSES], c[GFS_COUNTER_BRANCH_MISSES], ipc, scheduled);
+  }
+}
+
+static void profile_write_trace (GfsDomain * domain, FILE * fp)
+{
+  guint i;
+
+  for (i = 0; i < domain->trace->len; i++) {
+    GfsTimerRecord * r = &g_array_index (domain->trace, GfsTimerRecord, i);
+    fputs ("{\"name\": ", fp);
+    json_string_write (r->t->name, fp);
+    fprintf (fp, ", \"cat\": \"gerris\", \"ph\": \"X\", "
+	     "\"pid\": %d, \"tid\": 0, \"ts\": %.0f, \"dur\": %.0f},\n",
+	     MAX (domain->pid, 0), 1e6*r->start, 1e6*r->duration);
+  }
+  g_array_set_size (domain->trace, 0);
+}
+
+static gboolean profile_event (GfsEvent * event, GfsSimulation * sim)
+{
+  if ((* GFS_EVENT_CLASS (gfs_output_class())->event) (event, sim)) {
+    GfsOutputProfile * p = GFS_OUTPUT_PROFILE (event);
+    GfsDomain * domain = GFS_DOMAIN (sim);
+    FILE * fp = GFS_OUTPUT (event)->file->fp;
+
+    if (p->format == GFS_PROFILE_TRACE) {
+      /* Chrome trace "JSON array" format: the closing bracket is optional */
+      if (GFS_OUTPUT (event)->first_call)
+	fputs ("[\n", fp);
+      profile_write_trace (domain, fp);
+      return TRUE;
+    }
+
+    Timer * timing = g_malloc (sizeof (Timer)*g_hash_table_size (domain->timers));
+    gint count = 0;
+    gpointer data[2];
+    data[0] = timing;
+    data[1] = &count;  
+    g_hash_table_foreach (domain->timers, (GHFunc) get_timer, data);
+    qsort (timing, count, sizeof (Timer), compare_timer);
+
+    GHashTable * ranks = profile_ranks (domain);
+    if (p->format == GFS_PROFILE_CSV) {
+      if (GFS_OUTPUT (event)->first_call)
+	fputs ("t,i,name,parent,depth,calls,cpu,self,wall,items,throughput,"
+	       "cpu_min,cpu_avg,cpu_max,"
+	       "cycles,instructions,cache_misses,branch_misses,ipc,scheduled\n", fp);
+    }
+    else
+      fprintf (fp, "{\"t\": %g, \"i\": %u, \"np\": %d, \"timers\": [", 
+	       sim->time.t, sim->time.i, MAX (domain->np, 1));
+    gboolean first = TRUE;
+    while (--count >= 0) {
+      profile_write_timer (p, fp, sim, timing[count].t, 
+			   g_hash_table_lookup (ranks, timing[count].name), first);
+      first = FALSE;
+    }
+    if (p->format == GFS_PROFILE_JSON)
+      fputs ("\n  ]\n}\n", fp);
+    g_hash_table_destroy (ranks);
+    g_free (timing);
+    return TRUE;
+  }
+  return FALSE;
+}
+
+static void gfs_output_profile_class_init (GfsEventClass * klass)
+{
+  klass->event = profile_event;
+  GTS_OBJECT_CLASS (klass)->read = profile_read;
+  GTS_OBJECT_CLASS (klass)->write = profile_write;
+}
+
+GfsOutputClass * gfs_output_profile_class (void)
+{
+  static GfsOutputClass * klass = NULL;
+
+  if (klass == NULL) {
+    GtsObjectClassInfo gfs_output_profile_info = {
+      "GfsOutputProfile",
+      sizeof (GfsOutputProfile),
+      sizeof (GfsOutputClass),
+      (GtsObjectClassInitFunc) gfs_output_profile_class_init,
+      (GtsObjectInitFunc) NULL,
+      (GtsArgSetFunc) NULL,
+      (GtsArgGetFunc) NULL
+    };
+    klass = gts_object_class_new (GTS_OBJECT_CLASS (gfs_output_class ()),
+				  &gfs_output_profile_info);
+  }
+
+  return klass;
+}
+
+/** \endobject{GfsOutputProfile} */
+
 /**
  * Writing simulation size statistics.
  * \beginobject{GfsOutputBalance}
@@ -993,15 +1314,103 @@ GfsOutputClass * gfs_output_solid_force_class (void)
 
 /**
  * Writing the values of variables at specified locations.
+ *
+ * With the option binary = 1, each row (time, coordinates and
+ * values) is written as native doubles, without the header.
  * \beginobject{GfsOutputLocation}
  */
 
 static gchar default_precision[] = "%g";
 
+/* The host cell of a location and the interpolators at the corners
+   of this cell are kept from one output to the next, as long as the
+   topology of the mesh does not change. The interpolators of
+   face-centered variables also depend on the solid fractions (see
+   gfs_cell_corner_interpolators()): they are not kept when the
+   simulation contains solids */
+typedef struct {
+  FttVector p, pm;             /* location and mapped location */
+  FttCell * cell;              /* host cell or NULL */
+  GfsInterpolator * inter[2];  /* corner interpolators for face-centered 
+				  and cell-centered variables */
+} Probe;
+
+static void probe_reset (Probe * q)
+{
+  g_free (q->inter[0]);
+  g_free (q->inter[1]);
+  q->inter[0] = q->inter[1] = NULL;
+}
+
+static void probes_update (GfsOutputLocation * l, GfsSimulation * sim)
+{
+  guint version = ftt_topology_version (), i;
+  gboolean changed = (version != l->version);
+
+  if (l->probe->len != l->p->len) {
+    for (i = 0; i < l->probe->len; i++)
+      probe_reset (&g_array_index (l->probe, Probe, i));
+    g_array_set_size (l->probe, l->p->len);
+    memset (l->probe->data, 0, l->probe->len*sizeof (Probe));
+    changed = TRUE;
+  }
+
+  FttCell * hint = NULL;
+  for (i = 0; i < l->p->len; i++) {
+    Probe * q = &g_array_index (l->probe, Probe, i);
+    FttVector p = g_array_index (l->p, FttVector, i);
+    if (changed || p.x != q->p.x || p.y != q->p.y || p.z != q->p.z) {
+      q->p = q->pm = p;
+      gfs_simulation_map (sim, &q->pm);
+      /* consecutive locations are often close to one another */
+      q->cell = gfs_domain_locate_hint (GFS_DOMAIN (sim), q->pm, -1, hint);
+      probe_reset (q);
+    }
+    else if (sim->solids->items) {
+      g_free (q->inter[0]);
+      q->inter[0] = NULL;
+    }
+    if (q->cell)
+      hint = q->cell;
+  }
+  l->version = version;
+}
+
+static gdouble probe_value (Probe * q, GfsVariable * v)
+{
+  gdouble val = GFS_VALUE (q->cell, v);
+  if (val == GFS_NODATA)
+    return val;
+
+  guint c = v->centered ? 1 : 0;
+  if (q->inter[c] == NULL) {
+    q->inter[c] = g_malloc (4*(FTT_DIMENSION - 1)*sizeof (GfsInterpolator));
+    gfs_cell_corner_interpolators (q->cell, -1, c, q->inter[c]);
+  }
+  gdouble f[4*(FTT_DIMENSION - 1) + 1];
+  gfs_cell_corner_values_from_interpolators (q->cell, v, q->inter[c], f);
+  return gfs_interpolate_from_corners (q->cell, q->pm, f);
+}
+
+static void location_formats (GfsOutputLocation * l)
+{
+  g_free (l->pformat);
+  g_free (l->vformat);
+  l->pformat = g_strdup_printf ("%s %s %s %s", 
+				l->precision, l->precision, l->precision, l->precision);
+  l->vformat = g_strdup_printf (" %s", l->precision);
+}
+
 static void gfs_output_location_destroy (GtsObject * object)
 {
   GfsOutputLocation * l = GFS_OUTPUT_LOCATION (object);
+  guint i;
   g_array_free (l->p, TRUE);
+  for (i = 0; i < l->probe->len; i++)
+    probe_reset (&g_array_index (l->probe, Probe, i));
+  g_array_free (l->probe, TRUE);
+  g_free (l->pformat);
+  g_free (l->vformat);
   g_free (l->label);
   if (l->precision != default_precision)
     g_free (l->precision);
@@ -1034,32 +1443,26 @@ static gboolean vector_read (GtsFile * fp, FttVector * p)
   return TRUE;
 }
 
-static void gfs_output_location_read (GtsObject ** o, GtsFile * fp)
+/* Reads a single location, a list of locations within braces or
+   the name of a file containing the locations */
+static gboolean locations_read (GtsFile * fp, GArray * p)
 {
-  GfsOutputLocation * l = GFS_OUTPUT_LOCATION (*o);
-
-  if (GTS_OBJECT_CLASS (gfs_output_location_class ())->parent_class->read)
-    (* GTS_OBJECT_CLASS (gfs_output_location_class ())->parent_class->read) 
-      (o, fp);
-  if (fp->type == GTS_ERROR)
-    return;
-
   if (fp->type == GTS_STRING) {
     FILE * fptr = fopen (fp->token->str, "r");
     GtsFile * fp1;
 
     if (fptr == NULL) {
       gts_file_error (fp, "cannot open file `%s'", fp->token->str);
-      return;
+      return FALSE;
     }
     fp1 = gts_file_new (fptr);
     while (fp1->type != GTS_NONE) {
-      FttVector p;
-      if (!vector_read (fp1, &p)) {
+      FttVector v;
+      if (!vector_read (fp1, &v)) {
 	gts_file_error (fp, "%s:%d:%d: %s", fp->token->str, fp1->line, fp1->pos, fp1->error);
-	return;
+	return FALSE;
       }
-      g_array_append_val (l->p, p);
+      g_array_append_val (p, v);
       while (fp1->type == '\n')
 	gts_file_next_token (fp1);
     }
@@ -1073,26 +1476,54 @@ static void gfs_output_location_read (GtsObject ** o, GtsFile * fp)
       gts_file_next_token (fp);
     while (fp->type == '\n');
     while (fp->type != GTS_NONE && fp->type != '}') {
-      FttVector p;
-      if (!vector_read (fp, &p))
-	return;
-      g_array_append_val (l->p, p);
+      FttVector v;
+      if (!vector_read (fp, &v))
+	return FALSE;
+      g_array_append_val (p, v);
       while (fp->type == '\n')
 	gts_file_next_token (fp);
     }
     if (fp->type != '}') {
       gts_file_error (fp, "expecting a closing brace");
-      return;
+      return FALSE;
     }
     fp->scope_max--;
     gts_file_next_token (fp);
   }
   else {
-    FttVector p;
-    if (!vector_read (fp, &p))
-      return;
-    g_array_append_val (l->p, p);
+    FttVector v;
+    if (!vector_read (fp, &v))
+      return FALSE;
+    g_array_append_val (p, v);
   }
+  return TRUE;
+}
+
+static void locations_write (GArray * p, const gchar * precision, FILE * fp)
+{
+  guint i;
+  fputs (" {\n", fp);
+  gchar * format = g_strdup_printf ("%s %s %s\n", precision, precision, precision);
+  for (i = 0; i < p->len; i++) {
+    FttVector v = g_array_index (p, FttVector, i);
+    fprintf (fp, format, v.x, v.y, v.z);
+  }
+  g_free (format);
+  fputc ('}', fp);
+}
+
+static void gfs_output_location_read (GtsObject ** o, GtsFile * fp)
+{
+  GfsOutputLocation * l = GFS_OUTPUT_LOCATION (*o);
+
+  if (GTS_OBJECT_CLASS (gfs_output_location_class ())->parent_class->read)
+    (* GTS_OBJECT_CLASS (gfs_output_location_class ())->parent_class->read) 
+      (o, fp);
+  if (fp->type == GTS_ERROR)
+    return;
+
+  if (!locations_read (fp, l->p))
+    return;
 
   if (fp->type == '{') {
     gchar * label = NULL, * precision = NULL;
@@ -1100,6 +1531,7 @@ static void gfs_output_location_read (GtsObject ** o, GtsFile * fp)
       {GTS_STRING, "label", TRUE, &label},
       {GTS_STRING, "precision", TRUE, &precision},
       {GTS_INT,    "interpolate", TRUE, &l->interpolate},
+      {GTS_INT,    "binary", TRUE, &l->binary},
       {GTS_NONE}
     };
     gts_file_assign_variables (fp, var);
@@ -1113,6 +1545,7 @@ static void gfs_output_location_read (GtsObject ** o, GtsFile * fp)
       if (l->precision != default_precision)
 	g_free (l->precision);
       l->precision = precision;
+      location_formats (l);
     }
 
     if (label != NULL) {
@@ -1125,20 +1558,12 @@ static void gfs_output_location_read (GtsObject ** o, GtsFile * fp)
 static void gfs_output_location_write (GtsObject * o, FILE * fp)
 {
   GfsOutputLocation * l = GFS_OUTPUT_LOCATION (o);
-  guint i;
 
   (* GTS_OBJECT_CLASS (gfs_output_location_class ())->parent_class->write) (o, fp);
 
-  fputs (" {\n", fp);
-  gchar * format = g_strdup_printf ("%s %s %s\n", l->precision, l->precision, l->precision);
-  for (i = 0; i < l->p->len; i++) {
-    FttVector p = g_array_index (l->p, FttVector, i);
-    fprintf (fp, format, p.x, p.y, p.z);
-  }
-  g_free (format);
-  fputc ('}', fp);
+  locations_write (l->p, l->precision, fp);
 
-  if (l->precision != default_precision || l->label) {
+  if (l->precision != default_precision || l->label || !l->interpolate || l->binary) {
     fputs (" {\n", fp);
     if (l->precision != default_precision)
       fprintf (fp, "  precision = %s\n", l->precision);
@@ -1146,10 +1571,107 @@ static void gfs_output_location_write (GtsObject * o, FILE * fp)
       fprintf (fp, "  label = \"%s\"\n", l->label);
     if (!l->interpolate)
       fputs ("  interpolate = 0\n", fp);
+    if (l->binary)
+      fputs ("  binary = 1\n", fp);
     fputc ('}', fp);
   }
 }
 
+/* Each row is the index of the probe followed by t, x, y, z and the
+   values of the variables */
+static void location_write_rows (GfsOutputLocation * l, FILE * fp,
+				 const gdouble * rows, guint nrows, guint size)
+{
+  guint i, j;
+  for (i = 0; i < nrows; i++, rows += size) {
+    /* a location on the boundary between two processes is only
+       written once */
+    if (i > 0 && rows[0] == rows[- (gint) size])
+      continue;
+    if (l->binary)
+      fwrite (&rows[1], sizeof (gdouble), size - 1, fp);
+    else {
+      fprintf (fp, l->pformat, rows[1], rows[2], rows[3], rows[4]);
+      for (j = 5; j < size; j++)
+	fprintf (fp, l->vformat, rows[j]);
+      fputc ('\n', fp);
+    }
+  }
+}
+
+#ifdef HAVE_MPI
+typedef struct {
+  gdouble index;  /* probe index */
+  gint rank;      /* process which computed the row */
+  gdouble * row;
+} RowKey;
+
+static int compare_row_keys (const void * a, const void * b)
+{
+  const RowKey * i = a, * j = b;
+  if (i->index != j->index)
+    return i->index < j->index ? -1 : 1;
+  return i->rank < j->rank ? -1 : i->rank > j->rank;
+}
+
+/* The rows of all the processes are gathered on the master process
+   which writes them sorted by probe index. A location on the boundary
+   between two processes is written by the process of lowest rank */
+static void location_gather_rows (GfsOutputLocation * l, GfsDomain * domain, FILE * fp,
+				  GArray * rows, guint size)
+{
+  /* rows are sent as a whole so that counts are numbers of rows */
+  MPI_Datatype row_type;
+  MPI_Type_contiguous (size, MPI_DOUBLE, &row_type);
+  MPI_Type_commit (&row_type);
+
+  int n = rows->len/size, * count = NULL, * displ = NULL, total = 0, i, j;
+  gdouble * all = NULL;
+
+  if (domain->pid == 0)
+    count = g_malloc (domain->np*sizeof (int));
+  MPI_Gather (&n, 1, MPI_INT, count, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  if (domain->pid == 0) {
+    displ = g_malloc (domain->np*sizeof (int));
+    guint64 sum = 0;
+    for (i = 0; i < domain->np; i++) {
+      displ[i] = sum;
+      sum += count[i];
+    }
+    g_assert (sum <= G_MAXINT);
+    total = sum;
+    all = g_malloc (MAX (total, 1)*size*sizeof (gdouble));
+  }
+  MPI_Gatherv (rows->data, n, row_type, all, count, displ, row_type, 0, MPI_COMM_WORLD);
+  MPI_Type_free (&row_type);
+
+  if (domain->pid == 0) {
+    RowKey * key = g_malloc (MAX (total, 1)*sizeof (RowKey));
+    for (i = 0; i < domain->np; i++)
+      for (j = displ[i]; j < displ[i] + count[i]; j++) {
+	key[j].row = &all[(gsize) j*size];
+	key[j].index = key[j].row[0];
+	key[j].rank = i;
+      }
+    qsort (key, total, sizeof (RowKey), compare_row_keys);
+    /* each location belongs to the box (and process) given by the
+       locate array, but the row of the lowest rank is kept should two
+       processes find the same location */
+    gdouble * sorted = g_malloc (MAX (total, 1)*size*sizeof (gdouble));
+    gint nsorted = 0;
+    for (j = 0; j < total; j++)
+      if (j == 0 || key[j].index != key[j - 1].index)
+	memcpy (&sorted[(gsize) (nsorted++)*size], key[j].row, size*sizeof (gdouble));
+    location_write_rows (l, fp, sorted, nsorted, size);
+    g_free (sorted);
+    g_free (key);
+    g_free (count);
+    g_free (displ);
+    g_free (all);
+  }
+}
+#endif /* HAVE_MPI */
+
 static gboolean gfs_output_location_event (GfsEvent * event, 
 					   GfsSimulation * sim)
 {
@@ -1158,54 +1680,52 @@ static gboolean gfs_output_location_event (GfsEvent * event,
     GfsDomain * domain = GFS_DOMAIN (sim);
     GfsOutputLocation * location = GFS_OUTPUT_LOCATION (event);
     FILE * fp = GFS_OUTPUT (event)->file->fp;
-    GfsUnionFile uf;
-    FILE * fpp = ((domain->pid < 0 || GFS_OUTPUT (event)->parallel) ? fp:
-		  gfs_union_open (GFS_OUTPUT (event)->file->fp, domain->pid, &uf));
-    guint i;
+    guint i, j, nv = 0;
 
-    if (GFS_OUTPUT (event)->first_call) {
-      GSList * i = domain->variables;
-      guint nv = 5;
+    /* named variables */
+    GfsVariable ** v = g_malloc (g_slist_length (domain->variables)*sizeof (GfsVariable *));
+    GSList * k = domain->variables;
+    while (k) {
+      if (GFS_VARIABLE (k->data)->name)
+	v[nv++] = k->data;
+      k = k->next;
+    }
 
+    if (GFS_OUTPUT (event)->first_call && !location->binary) {
       fputs ("# 1:t 2:x 3:y 4:z", fp);
-      while (i) {
-	if (GFS_VARIABLE (i->data)->name)
-	  fprintf (fp, " %d:%s", nv++, GFS_VARIABLE (i->data)->name);
-	i = i->next;
-      }
+      for (j = 0; j < nv; j++)
+	fprintf (fp, " %d:%s", j + 5, v[j]->name);
       fputc ('\n', fp);
     }
-    gchar * pformat = g_strdup_printf ("%s %s %s %s", 
-				       location->precision, location->precision, 
-				       location->precision, location->precision);
-    gchar * vformat = g_strdup_printf (" %s", location->precision);
-    for (i = 0; i < location->p->len; i++) {
-      FttVector p = g_array_index (location->p, FttVector, i), pm = p;
-      gfs_simulation_map (sim, &pm);
-      FttCell * cell = gfs_domain_locate (domain, pm, -1, NULL);
-      
-      if (cell != NULL) {
-	GSList * i = domain->variables;
-	
-	fprintf (fpp, pformat, sim->time.t, p.x, p.y, p.z);
-	while (i) {
-	  GfsVariable * v = i->data;
-	  if (v->name)
-	    fprintf (fpp, vformat, gfs_dimensional_value (v, 
-							  location->interpolate ? 
-							  gfs_interpolate (cell, pm, v) :
-							  GFS_VALUE (cell, v)));
-	  i = i->next;
-	}
-	fputc ('\n', fpp);
+
+    probes_update (location, sim);
+    guint size = 5 + nv;
+    GArray * rows = g_array_new (FALSE, FALSE, sizeof (gdouble));
+    for (i = 0; i < location->probe->len; i++) {
+      Probe * q = &g_array_index (location->probe, Probe, i);
+      if (q->cell != NULL) {
+	g_array_set_size (rows, rows->len + size);
+	gdouble * row = &g_array_index (rows, gdouble, rows->len - size);
+	row[0] = i;
+	row[1] = sim->time.t;
+	row[2] = q->p.x; row[3] = q->p.y; row[4] = q->p.z;
+	for (j = 0; j < nv; j++)
+	  row[5 + j] = gfs_dimensional_value (v[j], location->interpolate ? 
+					      probe_value (q, v[j]) :
+					      GFS_VALUE (q->cell, v[j]));
       }
     }
+    g_free (v);
+
+    if (domain->pid < 0 || GFS_OUTPUT (event)->parallel)
+      location_write_rows (location, fp, (gdouble *) rows->data, rows->len/size, size);
+#ifdef HAVE_MPI
+    else
+      location_gather_rows (location, domain, fp, rows, size);
+#endif /* HAVE_MPI */
+    g_array_free (rows, TRUE);
 
-    g_free (pformat);
-    g_free (vformat);
     fflush (fp);
-    if (!(domain->pid < 0 || GFS_OUTPUT (event)->parallel))
-      gfs_union_close (GFS_OUTPUT (event)->file->fp, domain->pid, &uf);
     return TRUE;
   }
   return FALSE;
@@ -1224,6 +1744,10 @@ static void gfs_output_location_init (GfsOutputLocation * object)
   object->p = g_array_new (FALSE, FALSE, sizeof (FttVector));
   object->precision = default_precision;
   object->interpolate = TRUE;
+  object->binary = FALSE;
+  object->probe = g_array_new (FALSE, FALSE, sizeof (Probe));
+  object->pformat = object->vformat = NULL;
+  location_formats (object);
 }
 
 GfsOutputClass * gfs_output_location_class (void)
@@ -3109,10 +3633,52 @@ GfsOutputClass * gfs_output_squares_class (void)
 /** \endobject{GfsOutputSquares} */
 
 /**
+ * Writing streamlines.
  *
+ * The seeds are a single location, a list of locations within braces
+ * or a file of locations. With the option n = N, two seeds define a
+ * rake of N seeds and three seeds (an origin and two corners) a grid
+ * of N x N seeds. With the option nthreads = N, the streamlines are
+ * integrated by N threads when there are no solid boundaries.
  * \beginobject{GfsOutputStreamline}
  */
 
+static void gfs_output_streamline_destroy (GtsObject * object)
+{
+  GfsOutputStreamline * l = GFS_OUTPUT_STREAMLINE (object);
+  g_array_free (l->p, TRUE);
+  g_array_free (l->seeds, TRUE);
+
+  (* GTS_OBJECT_CLASS (gfs_output_streamline_class ())->parent_class->destroy) (object);
+}
+
+/* With n points, two locations define a rake and three locations
+   (the origin and two corners) define a grid of seeds */
+static void streamline_seeds (GfsOutputStreamline * l)
+{
+  g_array_set_size (l->seeds, 0);
+  if (l->n < 2) {
+    g_array_append_vals (l->seeds, l->p->data, l->p->len);
+    return;
+  }
+  FttVector * p = (FttVector *) l->p->data;
+  guint i, j, nj = l->p->len == 3 ? l->n : 1;
+  for (j = 0; j < nj; j++)
+    for (i = 0; i < l->n; i++) {
+      gdouble a = i/(gdouble) (l->n - 1), b = nj > 1 ? j/(gdouble) (nj - 1) : 0.;
+      FttVector s;
+      s.x = p[0].x + a*(p[1].x - p[0].x);
+      s.y = p[0].y + a*(p[1].y - p[0].y);
+      s.z = p[0].z + a*(p[1].z - p[0].z);
+      if (nj > 1) {
+	s.x += b*(p[2].x - p[0].x);
+	s.y += b*(p[2].y - p[0].y);
+	s.z += b*(p[2].z - p[0].z);
+      }
+      g_array_append_val (l->seeds, s);
+    }
+}
+
 static void gfs_output_streamline_read (GtsObject ** o, GtsFile * fp)
 {
   GfsOutputStreamline * l = GFS_OUTPUT_STREAMLINE (*o);
@@ -3123,26 +3689,25 @@ static void gfs_output_streamline_read (GtsObject ** o, GtsFile * fp)
   if (fp->type == GTS_ERROR)
     return;
 
-  if (fp->type != GTS_INT && fp->type != GTS_FLOAT) {
-    gts_file_error (fp, "expecting a number (p.x)");
+  g_array_set_size (l->p, 0);
+  if (!locations_read (fp, l->p))
     return;
-  }
-  l->p.x = atof (fp->token->str);
-  gts_file_next_token (fp);
 
-  if (fp->type != GTS_INT && fp->type != GTS_FLOAT) {
-    gts_file_error (fp, "expecting a number (p.y)");
-    return;
-  }
-  l->p.y = atof (fp->token->str);
-  gts_file_next_token (fp);
-
-  if (fp->type != GTS_INT && fp->type != GTS_FLOAT) {
-    gts_file_error (fp, "expecting a number (p.z)");
-    return;
+  if (fp->type == '{') {
+    GtsFileVariable var[] = {
+      {GTS_UINT, "n",        TRUE, &l->n},
+      {GTS_UINT, "nthreads", TRUE, &l->nthreads},
+      {GTS_NONE}
+    };
+    gts_file_assign_variables (fp, var);
+    if (fp->type == GTS_ERROR)
+      return;
+    if (l->n >= 2 && l->p->len != 2 && l->p->len != 3) {
+      gts_file_error (fp, "a rake needs two locations and a grid three locations");
+      return;
+    }
   }
-  l->p.z = atof (fp->token->str);
-  gts_file_next_token (fp);
+  streamline_seeds (l);
 }
 
 static void gfs_output_streamline_write (GtsObject * o, FILE * fp)
@@ -3152,7 +3717,21 @@ static void gfs_output_streamline_write (GtsObject * o, FILE * fp)
   if (GTS_OBJECT_CLASS (gfs_output_streamline_class ())->parent_class->write)
     (* GTS_OBJECT_CLASS (gfs_output_streamline_class ())->parent_class->write) 
       (o, fp);
-  fprintf (fp, " %g %g %g", l->p.x, l->p.y, l->p.z);
+  /* seeds are written exactly so that restarts give the same streamlines */
+  if (l->p->len == 1) {
+    FttVector p = g_array_index (l->p, FttVector, 0);
+    fprintf (fp, " %.17g %.17g %.17g", p.x, p.y, p.z);
+  }
+  else
+    locations_write (l->p, "%.17g", fp);
+  if (l->n >= 2 || l->nthreads > 1) {
+    fputs (" {", fp);
+    if (l->n >= 2)
+      fprintf (fp, " n = %u", l->n);
+    if (l->nthreads > 1)
+      fprintf (fp, " nthreads = %u", l->nthreads);
+    fputs (" }", fp);
+  }
 }
 
 static gboolean gfs_output_streamline_event (GfsEvent * event, 
@@ -3160,18 +3739,26 @@ static gboolean gfs_output_streamline_event (GfsEvent * event,
 {
   if ((* GFS_EVENT_CLASS (GTS_OBJECT_CLASS (gfs_output_streamline_class ())->parent_class)->event)
       (event,sim)) {
-    FttVector p = GFS_OUTPUT_STREAMLINE (event)->p;
-    gfs_simulation_map (sim, &p);
-    GList * stream = gfs_streamline_new (GFS_DOMAIN (sim),
-					 gfs_domain_velocity (GFS_DOMAIN (sim)),
-					 p,
-					 GFS_OUTPUT_SCALAR (event)->v,
-					 0., 0.,
-					 TRUE,
-					 NULL, NULL);
+    GfsOutputStreamline * l = GFS_OUTPUT_STREAMLINE (event);
+    FttVector * p = g_memdup (l->seeds->data, l->seeds->len*sizeof (FttVector));
+    guint i;
+    for (i = 0; i < l->seeds->len; i++)
+      gfs_simulation_map (sim, &p[i]);
+    GList ** stream = gfs_streamlines_new (GFS_DOMAIN (sim),
+					   gfs_domain_velocity (GFS_DOMAIN (sim)),
+					   p, l->seeds->len,
+					   GFS_OUTPUT_SCALAR (event)->v,
+					   0., 0.,
+					   TRUE,
+					   l->nthreads,
+					   NULL, NULL);
     /* fixme: mapping is not taken into account */
-    gfs_streamline_write (stream, GFS_OUTPUT (event)->file->fp);
-    gfs_streamline_destroy (stream);
+    for (i = 0; i < l->seeds->len; i++) {
+      gfs_streamline_write (stream[i], GFS_OUTPUT (event)->file->fp);
+      gfs_streamline_destroy (stream[i]);
+    }
+    g_free (stream);
+    g_free (p);
     return TRUE;
   }
   return FALSE;
@@ -3180,10 +3767,19 @@ static gboolean gfs_output_streamline_event (GfsEvent * event,
 static void gfs_output_streamline_class_init (GfsOutputClass * klass)
 {
   GFS_EVENT_CLASS (klass)->event = gfs_output_streamline_event;
+  GTS_OBJECT_CLASS (klass)->destroy = gfs_output_streamline_destroy;
   GTS_OBJECT_CLASS (klass)->read = gfs_output_streamline_read;
   GTS_OBJECT_CLASS (klass)->write = gfs_output_streamline_write;
 }
 
+static void gfs_output_streamline_init (GfsOutputStreamline * l)
+{
+  l->p = g_array_new (FALSE, FALSE, sizeof (FttVector));
+  l->seeds = g_array_new (FALSE, FALSE, sizeof (FttVector));
+  l->n = 0;
+  l->nthreads = 1;
+}
+
 GfsOutputClass * gfs_output_streamline_class (void)
 {
   static GfsOutputClass * klass = NULL;
@@ -3194,7 +3790,7 @@ GfsOutputClass * gfs_output_streamline_class (void)
       sizeof (GfsOutputStreamline),
       sizeof (GfsOutputClass),
       (GtsObjectClassInitFunc) gfs_output_streamline_class_init,
-      (GtsObjectInitFunc) NULL,
+      (GtsObjectInitFunc) gfs_output_streamline_init,
       (GtsArgSetFunc) NULL,
       (GtsArgGetFunc) NULL
     };
@@ -97,6 +97,28 @@ GfsOutputClass * gfs_output_adapt_stats_class  (void);
 
 GfsOutputClass * gfs_output_timing_class (void);
 
+/* GfsOutputProfile: Header */
+
+typedef struct _GfsOutputProfile         GfsOutputProfile;
+typedef enum   { GFS_PROFILE_CSV,
+		 GFS_PROFILE_JSON,
+		 GFS_PROFILE_TRACE }     GfsOutputProfileFormat;
+
+struct _GfsOutputProfile {
+  /*< private >*/
+  GfsOutput parent;
+
+  /*< public >*/
+  GfsOutputProfileFormat format;
+  gboolean counters;
+};
+
+#define GFS_OUTPUT_PROFILE(obj)            GTS_OBJECT_CAST (obj,\
+					     GfsOutputProfile,\
+					     gfs_output_profile_class ())
+
+GfsOutputClass * gfs_output_profile_class (void);
+
 /* GfsOutputBalance: Header */
 
 GfsOutputClass * gfs_output_balance_class  (void);
@@ -130,7 +152,12 @@ struct _GfsOutputLocation {
   /*< public >*/
   GArray * p;
   gchar * precision, * label;
-  gboolean interpolate;
+  gboolean interpolate, binary;
+
+  /*< private >*/
+  GArray * probe;
+  guint version;
+  gchar * pformat, * vformat;
 };
 
 #define GFS_OUTPUT_LOCATION(obj)            GTS_OBJECT_CAST (obj,\
@@ -321,7 +348,11 @@ struct _GfsOutputStreamline {
   GfsOutputScalar parent;
 
   /*< public >*/
-  FttVector p;
+  GArray * p;
+  guint n, nthreads;
+
+  /*< private >*/
+  GArray * seeds;
 };
 
 #define GFS_OUTPUT_STREAMLINE(obj)         GTS_OBJECT_CAST (obj,\
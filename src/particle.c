@@ -22,6 +22,7 @@
 
 #include <stdlib.h>
 #include "particle.h"
+#include "mpi_boundary.h"
 
 /**
  * Lagrangian particules.
@@ -110,3 +111,497 @@ GfsEventClass * gfs_particle_class (void)
 }
 
 /** \endobject{GfsParticle} */
+
+/* Batched advection of particles */
+
+typedef struct {
+  FttCell * cell;
+  guint i;
+} HostCell;
+
+static int compare_host (const void * a, const void * b)
+{
+  const FttCell * c1 = ((const HostCell *) a)->cell, * c2 = ((const HostCell *) b)->cell;
+  return c1 < c2 ? -1 : c1 > c2 ? 1 : 0;
+}
+
+/* TRUE if @p is (strictly) inside @cell i.e. gfs_domain_locate()
+   would return @cell */
+static gboolean cell_contains (FttCell * cell, const FttVector * p)
+{
+  FttVector o;
+  ftt_cell_pos (cell, &o);
+  gdouble h = ftt_cell_size (cell)*(1. - 1e-6)/2.;
+  return (fabs (p->x - o.x) < h && fabs (p->y - o.y) < h
+#if !FTT_2D
+	  && fabs (p->z - o.z) < h
+#endif
+	  );
+}
+
+#define NCORNERS (4*(FTT_DIMENSION - 1) + 1)
+
+/* Corner values of the velocity components of a cell */
+typedef struct {
+  FttCell * cell;
+  gdouble f[FTT_DIMENSION*NCORNERS];
+} CellVelocity;
+
+static void cell_velocity (FttCell * cell, GfsVariable ** u, CellVelocity * v)
+{
+  if (cell != v->cell) {
+    gfs_cell_corner_values_array (cell, u, FTT_DIMENSION, -1, v->f);
+    v->cell = cell;
+  }
+}
+
+/* same as gfs_interpolate (v->cell, p, u[c]) */
+static gdouble interpolate_velocity (CellVelocity * v, FttVector p, GfsVariable ** u,
+				     FttComponent c)
+{
+  if (GFS_VALUE (v->cell, u[c]) == GFS_NODATA)
+    return GFS_NODATA;
+  return gfs_interpolate_from_corners (v->cell, p, &v->f[c*NCORNERS]);
+}
+
+/**
+ * gfs_particles_advect:
+ * @sim: a #GfsSimulation.
+ * @particles: a list of #GfsParticle.
+ * @dt: the time step.
+ *
+ * Advects the positions of @particles using the velocity field of
+ * @sim. The result is the same as calling gfs_domain_advect_point()
+ * for each particle.
+ *
+ * The particles are processed in the order of their host cells: the
+ * velocity interpolated at the corners of a cell is computed only
+ * once for all the particles it contains, and the host cell of the
+ * midpoint is only searched for if the midpoint leaves the cell. The
+ * host cells are located using the previous host cell as hint.
+ */
+void gfs_particles_advect (GfsSimulation * sim, GSList * particles, gdouble dt)
+{
+  g_return_if_fail (sim != NULL);
+
+  guint n = g_slist_length (particles), nh = 0, i;
+  if (n == 0)
+    return;
+
+  GfsDomain * domain = GFS_DOMAIN (sim);
+  GfsParticle ** p = g_malloc (n*sizeof (GfsParticle *));
+  FttVector * pos = g_malloc (n*sizeof (FttVector));
+  HostCell * host = g_malloc (n*sizeof (HostCell));
+  FttCell * hint = NULL;
+  for (i = 0; i < n; i++, particles = particles->next) {
+    p[i] = particles->data;
+    pos[i] = p[i]->pos;
+    gfs_simulation_map (sim, &pos[i]);
+    FttCell * cell = gfs_domain_locate_hint (domain, pos[i], -1, hint);
+    if (cell) {
+      host[nh].cell = hint = cell;
+      host[nh++].i = i;
+    }
+  }
+  qsort (host, nh, sizeof (HostCell), compare_host);
+
+  GfsVariable ** u = gfs_domain_velocity (domain);
+  CellVelocity v0, v1;
+  v0.cell = v1.cell = NULL;
+  for (i = 0; i < nh; i++) {
+    FttVector p0 = pos[host[i].i], p1 = p0;
+    FttComponent c;
+
+    cell_velocity (host[i].cell, u, &v0);
+    for (c = 0; c < FTT_DIMENSION; c++)
+      (&p1.x)[c] += dt*interpolate_velocity (&v0, p0, u, c)/2.;
+    FttCell * cell = cell_contains (v0.cell, &p1) ? v0.cell :
+      gfs_domain_locate_hint (domain, p1, -1, v0.cell);
+    if (cell) {
+      CellVelocity * v = cell == v0.cell ? &v0 : &v1;
+      cell_velocity (cell, u, v);
+      for (c = 0; c < FTT_DIMENSION; c++)
+	(&pos[host[i].i].x)[c] += dt*interpolate_velocity (v, p1, u, c);
+    }
+  }
+
+  for (i = 0; i < n; i++) {
+    gfs_simulation_map_inverse (sim, &pos[i]);
+    p[i]->pos = pos[i];
+  }
+
+  g_free (p);
+  g_free (pos);
+  g_free (host);
+}
+
+/* Migration of particles between processes */
+
+#ifdef HAVE_MPI
+
+/* id and (unmapped) coordinates of a particle */
+#define PARTICLE_SIZE 4
+/* the tags of the boundary exchanges span the whole tag range (see
+   mpi_boundary.c): particles use their own communicator, in which all
+   the messages of a migration are complete before the next one starts */
+#define PARTICLE_TAG  0
+
+static MPI_Comm particle_comm (void)
+{
+  static MPI_Comm comm = MPI_COMM_NULL;
+  if (comm == MPI_COMM_NULL)
+    MPI_Comm_dup (MPI_COMM_WORLD, &comm);
+  return comm;
+}
+
+typedef struct {
+  gint pid;
+  GArray * snd;
+} Neighbor;
+
+static void add_neighbors (GfsBox * box, GArray * neighbors)
+{
+  FttDirection d;
+  for (d = 0; d < FTT_NEIGHBORS; d++)
+    if (GFS_IS_BOUNDARY_MPI (box->neighbor[d])) {
+      gint pid = GFS_BOUNDARY_MPI (box->neighbor[d])->process, i;
+      for (i = 0; i < neighbors->len; i++)
+	if (g_array_index (neighbors, Neighbor, i).pid == pid)
+	  break;
+      if (i == neighbors->len) {
+	Neighbor n = { pid, g_array_new (FALSE, FALSE, sizeof (gdouble)) };
+	g_array_append_val (neighbors, n);
+      }
+    }
+}
+
+#define OWNER_UNKNOWN -1
+
+/* Returns the pid of the process owning @p, @domain->pid if @p is
+   either in a local box or on the other side of a physical boundary,
+   or OWNER_UNKNOWN if @p is not in the neighborhood of any local box */
+static gint particle_owner (GfsDomain * domain, GfsParticle * p)
+{
+  FttVector pos = p->pos;
+  gfs_simulation_map (GFS_SIMULATION (domain), &pos);
+  GSList * b = gfs_locate_array_locate (domain->array, &pos);
+  if (b == NULL)
+    return OWNER_UNKNOWN;
+  if (GFS_IS_BOUNDARY_MPI (b->data))
+    return GFS_BOUNDARY_MPI (b->data)->process;
+  return domain->pid;
+}
+
+static gboolean particle_is_local (GfsDomain * domain, const gdouble * v)
+{
+  FttVector pos;
+  pos.x = v[1]; pos.y = v[2]; pos.z = v[3];
+  gfs_simulation_map (GFS_SIMULATION (domain), &pos);
+  GSList * b = gfs_locate_array_locate (domain->array, &pos);
+  return b && GFS_IS_BOX (b->data);
+}
+
+static void particle_pack (GfsParticle * p, GArray * a)
+{
+  gdouble v[PARTICLE_SIZE];
+  v[0] = p->id;
+  v[1] = p->pos.x; v[2] = p->pos.y; v[3] = p->pos.z;
+  g_array_append_vals (a, v, PARTICLE_SIZE);
+}
+
+static GfsParticle * particle_unpack (GfsEventList * l, GfsSimulation * sim, const gdouble * v)
+{
+  GfsParticle * p = GFS_PARTICLE (gts_object_new (GTS_OBJECT_CLASS (gfs_particle_class ())));
+  GfsEvent * e = GFS_EVENT (l);
+  gfs_object_simulation_set (p, sim);
+  gfs_event_set (GFS_EVENT (p), e->start, e->end, e->step, e->istart, e->iend, e->istep);
+  p->id = v[0];
+  p->pos.x = v[1]; p->pos.y = v[2]; p->pos.z = v[3];
+  gts_container_add (GTS_CONTAINER (l->list), GTS_CONTAINEE (p));
+  return p;
+}
+
+/* Each process keeps the particles contained in its boxes. Particles
+   outside all the boxes are kept by process zero. All the processes
+   must have the same list of particles. */
+static void particles_distribute (GfsDomain * domain, GfsEventList * l)
+{
+  guint n = g_slist_length (l->list->items), i;
+  if (n == 0)
+    return;
+  gint * owner = g_malloc (n*sizeof (gint)), * global = g_malloc (n*sizeof (gint));
+  GSList * j;
+  for (j = l->list->items, i = 0; j; j = j->next, i++) {
+    FttVector pos = GFS_PARTICLE (j->data)->pos;
+    gfs_simulation_map (GFS_SIMULATION (domain), &pos);
+    GSList * b = gfs_locate_array_locate (domain->array, &pos);
+    owner[i] = b && GFS_IS_BOX (b->data) ? domain->pid : OWNER_UNKNOWN;
+  }
+  MPI_Allreduce (owner, global, n, MPI_INT, MPI_MAX, particle_comm ());
+  GSList * gone = NULL;
+  for (j = l->list->items, i = 0; j; j = j->next, i++)
+    if (global[i] != domain->pid && (global[i] != OWNER_UNKNOWN || domain->pid != 0))
+      gone = g_slist_prepend (gone, j->data);
+  g_slist_foreach (gone, (GFunc) gts_object_destroy, NULL);
+  g_slist_free (gone);
+  g_free (owner);
+  g_free (global);
+}
+
+/* Particles which are not in the neighborhood of any local box (they
+   moved more than one box or the boxes were redistributed) are
+   gathered by all processes: the process containing a particle adopts
+   it, otherwise the particle stays where it was */
+static void particles_adopt (GfsDomain * domain, GfsEventList * l, GSList * orphans)
+{
+  GArray * snd = g_array_new (FALSE, FALSE, sizeof (gdouble));
+  g_slist_foreach (orphans, (GFunc) particle_pack, snd);
+
+  int * count = g_malloc (domain->np*sizeof (int)), * displ = g_malloc (domain->np*sizeof (int));
+  int n = snd->len, i, total = 0;
+  MPI_Allgather (&n, 1, MPI_INT, count, 1, MPI_INT, particle_comm ());
+  for (i = 0; i < domain->np; i++) {
+    displ[i] = total;
+    total += count[i];
+  }
+  gdouble * rcv = g_malloc (total*sizeof (gdouble));
+  MPI_Allgatherv (snd->data, n, MPI_DOUBLE, rcv, count, displ, MPI_DOUBLE, particle_comm ());
+  g_array_free (snd, TRUE);
+
+  int np = total/PARTICLE_SIZE;
+  gint * owner = g_malloc (np*sizeof (gint)), * global = g_malloc (np*sizeof (gint));
+  for (i = 0; i < np; i++)
+    owner[i] = particle_is_local (domain, &rcv[i*PARTICLE_SIZE]) ? domain->pid : OWNER_UNKNOWN;
+  MPI_Allreduce (owner, global, np, MPI_INT, MPI_MAX, particle_comm ());
+
+  int k = 0;
+  for (i = 0; i < domain->np; i++) {
+    int end = (displ[i] + count[i])/PARTICLE_SIZE;
+    for (; k < end; k++)
+      if (global[k] == domain->pid && i != domain->pid)
+	particle_unpack (l, GFS_SIMULATION (domain), &rcv[k*PARTICLE_SIZE]);
+  }
+  GSList * j = orphans;
+  k = displ[domain->pid]/PARTICLE_SIZE;
+  while (j) {
+    if (global[k] != OWNER_UNKNOWN && global[k] != domain->pid)
+      gts_object_destroy (j->data);
+    j = j->next; k++;
+  }
+
+  g_free (count);
+  g_free (displ);
+  g_free (rcv);
+  g_free (owner);
+  g_free (global);
+}
+
+#endif /* HAVE_MPI */
+
+/**
+ * gfs_particles_migrate:
+ * @sim: a #GfsSimulation.
+ * @l: a #GfsEventList of #GfsParticle.
+ *
+ * Moves the particles of @l which left the boxes of the current
+ * process to the process now containing them.
+ *
+ * The first call distributes the particles (initially all the
+ * processes have all the particles): each process then only keeps
+ * the particles it contains.
+ *
+ * Particles are exchanged with the neighboring processes in a single
+ * message per neighbor. Particles which cannot be attributed to a
+ * neighbor (i.e. after the boxes have been redistributed by
+ * #GfsEventBalance) are resolved collectively.
+ *
+ * This is a collective operation which does nothing for serial runs.
+ */
+void gfs_particles_migrate (GfsSimulation * sim, GfsEventList * l)
+{
+  g_return_if_fail (sim != NULL);
+  g_return_if_fail (l != NULL);
+
+#ifdef HAVE_MPI
+  GfsDomain * domain = GFS_DOMAIN (sim);
+  if (domain->pid < 0) {
+    l->distributed = TRUE;
+    return;
+  }
+
+  static GfsTimerCache cache = { 0, NULL };
+  GfsTimer * timer = gfs_domain_timer_cached (domain, "particles_migrate", &cache);
+  gfs_timer_start (domain, timer);
+
+  int n[2];
+  n[0] = g_slist_length (l->list->items);
+  MPI_Allreduce (&n[0], &n[1], 1, MPI_INT, MPI_SUM, particle_comm ());
+  if (!l->distributed) {
+    particles_distribute (domain, l);
+    l->distributed = TRUE;
+    n[1] /= domain->np;
+  }
+
+  GArray * neighbors = g_array_new (FALSE, FALSE, sizeof (Neighbor));
+  gts_container_foreach (GTS_CONTAINER (domain), (GtsFunc) add_neighbors, neighbors);
+
+  GSList * i = l->list->items, * gone = NULL, * orphans = NULL;
+  while (i) {
+    GfsParticle * p = i->data;
+    gint pid = particle_owner (domain, p);
+    if (pid == OWNER_UNKNOWN)
+      orphans = g_slist_prepend (orphans, p);
+    else if (pid != domain->pid) {
+      gint j;
+      for (j = 0; j < neighbors->len; j++)
+	if (g_array_index (neighbors, Neighbor, j).pid == pid) {
+	  particle_pack (p, g_array_index (neighbors, Neighbor, j).snd);
+	  gone = g_slist_prepend (gone, p);
+	  break;
+	}
+    }
+    i = i->next;
+  }
+  g_slist_foreach (gone, (GFunc) gts_object_destroy, NULL);
+  g_slist_free (gone);
+
+  /* exchange with neighbors */
+  MPI_Request * request = g_malloc (2*neighbors->len*sizeof (MPI_Request));
+  guint * count = g_malloc (neighbors->len*sizeof (guint));
+  gint j, nrequest = 0;
+  for (j = 0; j < neighbors->len; j++) {
+    Neighbor * nb = &g_array_index (neighbors, Neighbor, j);
+    count[j] = nb->snd->len;
+    MPI_Isend (&count[j], 1, MPI_UNSIGNED, nb->pid, PARTICLE_TAG, particle_comm (),
+	       &request[nrequest++]);
+    if (count[j] > 0)
+      MPI_Isend (nb->snd->data, count[j], MPI_DOUBLE, nb->pid, PARTICLE_TAG, particle_comm (),
+		 &request[nrequest++]);
+  }
+  GArray * rcv = g_array_new (FALSE, FALSE, sizeof (gdouble));
+  for (j = 0; j < neighbors->len; j++) {
+    Neighbor * nb = &g_array_index (neighbors, Neighbor, j);
+    MPI_Status status;
+    guint size, k;
+    MPI_Recv (&size, 1, MPI_UNSIGNED, nb->pid, PARTICLE_TAG, particle_comm (), &status);
+    if (size > 0) {
+      g_array_set_size (rcv, size);
+      MPI_Recv (rcv->data, size, MPI_DOUBLE, nb->pid, PARTICLE_TAG, particle_comm (), &status);
+      for (k = 0; k < size; k += PARTICLE_SIZE)
+	particle_unpack (l, sim, &g_array_index (rcv, gdouble, k));
+    }
+  }
+  for (j = 0; j < nrequest; j++) {
+    MPI_Status status;
+    MPI_Wait (&request[j], &status);
+  }
+  g_array_free (rcv, TRUE);
+  g_free (request);
+  g_free (count);
+  for (j = 0; j < neighbors->len; j++)
+    g_array_free (g_array_index (neighbors, Neighbor, j).snd, TRUE);
+  g_array_free (neighbors, TRUE);
+
+  /* particles which cannot be attributed to a neighbor */
+  int norphans = g_slist_length (orphans);
+  gfs_all_reduce (domain, norphans, MPI_INT, MPI_SUM);
+  if (norphans > 0)
+    particles_adopt (domain, l, orphans);
+  g_slist_free (orphans);
+
+  /* conservation check */
+  n[0] = g_slist_length (l->list->items);
+  gfs_all_reduce (domain, n[0], MPI_INT, MPI_SUM);
+  if (n[0] != n[1])
+    g_warning ("gfs_particles_migrate(): %d particles before, %d after", n[1], n[0]);
+
+  gfs_timer_stop (domain, timer);
+#else /* not HAVE_MPI */
+  l->distributed = TRUE;
+#endif /* not HAVE_MPI */
+}
+
+#ifdef HAVE_MPI
+static void gather_list (GfsEventList * l, gpointer * data)
+{
+  GfsDomain * domain = data[0];
+  GSList ** copies = data[1];
+  GArray * snd = g_array_new (FALSE, FALSE, sizeof (gdouble));
+  if (domain->pid > 0)
+    gts_container_foreach (GTS_CONTAINER (l->list), (GtsFunc) particle_pack, snd);
+
+  int n = snd->len, * count = NULL, * displ = NULL, total = 0, i;
+  if (domain->pid == 0) {
+    count = g_malloc (domain->np*sizeof (int));
+    displ = g_malloc (domain->np*sizeof (int));
+  }
+  MPI_Gather (&n, 1, MPI_INT, count, 1, MPI_INT, 0, particle_comm ());
+  gdouble * rcv = NULL;
+  if (domain->pid == 0) {
+    for (i = 0; i < domain->np; i++) {
+      displ[i] = total;
+      total += count[i];
+    }
+    rcv = g_malloc (MAX (total, 1)*sizeof (gdouble));
+  }
+  MPI_Gatherv (snd->data, n, MPI_DOUBLE, rcv, count, displ, MPI_DOUBLE, 0, particle_comm ());
+  g_array_free (snd, TRUE);
+
+  for (i = 0; i < total; i += PARTICLE_SIZE)
+    *copies = g_slist_prepend (*copies, particle_unpack (l, GFS_SIMULATION (domain), &rcv[i]));
+  g_free (count);
+  g_free (displ);
+  g_free (rcv);
+}
+
+static void gather_lists (GfsEvent * event, gpointer * data)
+{
+  /* only lists of particles are distributed (see gfs_event_list_event()) */
+  if (GFS_IS_EVENT_LIST (event) && GFS_EVENT_LIST (event)->distributed)
+    gather_list (GFS_EVENT_LIST (event), data);
+}
+#endif /* HAVE_MPI */
+
+/**
+ * gfs_particles_gather:
+ * @sim: a #GfsSimulation.
+ *
+ * Adds to the distributed particle lists of process zero copies of
+ * the particles owned by the other processes, so that process zero
+ * can write all the particles (see gfs_simulation_union_write()).
+ *
+ * This is a collective operation which does nothing for serial runs.
+ *
+ * Returns: the list of the copies added on process zero, to be
+ * destroyed with gfs_particles_gather_free() once written.
+ */
+GSList * gfs_particles_gather (GfsSimulation * sim)
+{
+  GSList * copies = NULL;
+
+  g_return_val_if_fail (sim != NULL, NULL);
+
+#ifdef HAVE_MPI
+  GfsDomain * domain = GFS_DOMAIN (sim);
+  if (domain->pid >= 0) {
+    gpointer data[2];
+    data[0] = domain;
+    data[1] = &copies;
+    gts_container_foreach (GTS_CONTAINER (sim->events), (GtsFunc) gather_lists, data);
+  }
+#endif /* HAVE_MPI */
+  return copies;
+}
+
+/**
+ * gfs_particles_gather_free:
+ * @copies: the list returned by gfs_particles_gather().
+ *
+ * Destroys the particles added by gfs_particles_gather() and frees
+ * @copies.
+ */
+void gfs_particles_gather_free (GSList * copies)
+{
+  g_slist_foreach (copies, (GFunc) gts_object_destroy, NULL);
+  g_slist_free (copies);
+}
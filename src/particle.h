@@ -43,6 +43,13 @@ struct _GfsParticle {
 						 gfs_particle_class ()))
 
 GfsEventClass * gfs_particle_class  (void);
+void            gfs_particles_advect (GfsSimulation * sim, 
+				      GSList * particles, 
+				      gdouble dt);
+void            gfs_particles_migrate (GfsSimulation * sim,
+				       GfsEventList * l);
+GSList *        gfs_particles_gather  (GfsSimulation * sim);
+void            gfs_particles_gather_free (GSList * copies);
 
 #ifdef __cplusplus
 }
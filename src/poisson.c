@@ -441,7 +441,9 @@ GfsLinearProblem * gfs_get_poisson_problem (GfsDomain * domain,
 					    GfsVariable * dia, gint maxlevel,
 					    GfsVariable * v)
 {
-  gfs_domain_timer_start (domain, "get_poisson_problem");
+  static GfsTimerCache cache = { 0, NULL };
+  GfsTimer * timer = gfs_domain_timer_cached (domain, "get_poisson_problem", &cache);
+  gfs_timer_start (domain, timer);
 
   GfsLinearProblem * lp = gfs_linear_problem_new (domain);
  
@@ -489,7 +491,8 @@ GfsLinearProblem * gfs_get_poisson_problem (GfsDomain * domain,
     }
   }
   
-  gfs_domain_timer_stop (domain, "get_poisson_problem");
+  gfs_domain_timer_add_items (domain, lp->rhs->len);
+  gfs_timer_stop (domain, timer);
 
   return lp;
 }
@@ -622,13 +625,18 @@ void gfs_relax (GfsDomain * domain,
   p.dia = dia->i;
   p.maxlevel = max_depth;
   p.omega = omega;
-  gfs_domain_cell_traverse (domain, FTT_PRE_ORDER, 
-			    FTT_TRAVERSE_LEVEL | FTT_TRAVERSE_LEAFS,
-			    max_depth,
-			    (FttCellTraverseFunc) (u->centered ?
-						   (d == 2 ? relax2D : relax) : 
-						   relax_dirichlet),
-			    &p);
+  /* the relaxations of a multigrid cycle traverse the same cells
+     repeatedly: the list of cells is kept by the domain */
+  FttCellTraverse t;
+  gfs_domain_cell_traverse_borrow (domain, FTT_PRE_ORDER, 
+				   FTT_TRAVERSE_LEVEL | FTT_TRAVERSE_LEAFS,
+				   max_depth, &t);
+  void (* relax_func) (FttCell *, RelaxParams *) = 
+    u->centered ? (d == 2 ? relax2D : relax) : relax_dirichlet;
+  FttCell * cell;
+  while ((cell = ftt_cell_traverse_next (&t)))
+    (* relax_func) (cell, &p);
+  gfs_domain_timer_add_items (domain, t.current - t.cells - 1);
 }
 
 static void residual_set (FttCell * cell, RelaxParams * p)
@@ -1234,7 +1242,9 @@ void gfs_poisson_solve (GfsDomain * domain,
   g_return_if_fail (res != NULL);
   g_return_if_fail (dia != NULL);
 
-  gfs_domain_timer_start (domain, "poisson_solve");
+  static GfsTimerCache cache = { 0, NULL };
+  GfsTimer * timer = gfs_domain_timer_cached (domain, "poisson_solve", &cache);
+  gfs_timer_start (domain, timer);
 
   guint minlevel = par->minlevel;
   par->depth = gfs_domain_depth (domain);
@@ -1265,7 +1275,8 @@ void gfs_poisson_solve (GfsDomain * domain,
 
   par->minlevel = minlevel;
 
-  gfs_domain_timer_stop (domain, "poisson_solve");
+  gfs_domain_timer_add_leaves (domain);
+  gfs_timer_stop (domain, timer);
 }
 
 typedef struct {
@@ -1717,7 +1728,9 @@ GfsLinearProblem * gfs_get_diffusion_problem (GfsDomain * domain,
 					      gint maxlevel,
 					      GfsVariable * v)
 {
-  gfs_domain_timer_start (domain, "get_diffusion_problem");
+  static GfsTimerCache cache = { 0, NULL };
+  GfsTimer * timer = gfs_domain_timer_cached (domain, "get_diffusion_problem", &cache);
+  gfs_timer_start (domain, timer);
 
   GfsLinearProblem * lp = gfs_linear_problem_new (domain);
  
@@ -1737,7 +1750,8 @@ GfsLinearProblem * gfs_get_diffusion_problem (GfsDomain * domain,
 				     maxlevel, lhs, v, lp);
   gfs_domain_cell_traverse (domain, FTT_PRE_ORDER, FTT_TRAVERSE_LEVEL | FTT_TRAVERSE_LEAFS,
 			    maxlevel, (FttCellTraverseFunc) diffusion_relax_stencil, &p);
-  gfs_domain_timer_stop (domain, "get_diffusion_problem");
+  gfs_domain_timer_add_items (domain, lp->rhs->len);
+  gfs_timer_stop (domain, timer);
 
   return lp;
 }
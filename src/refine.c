@@ -31,24 +31,38 @@
  * \beginobject{GfsRefine}
  */
 
-static gboolean refine_maxlevel (FttCell * cell, GfsFunction * maxlevel)
-{
-  return (ftt_cell_level (cell) < gfs_function_value (maxlevel, cell));
-}
+typedef struct {
+  GfsFunction * maxlevel;
+  GPtrArray * cells;
+} RefineParams;
 
-static void refine_box (GfsBox * box, GfsFunction * maxlevel)
+static void add_maxlevel (FttCell * cell, RefineParams * p)
 {
-  ftt_cell_refine (box->root, 
-		   (FttCellRefineFunc) refine_maxlevel, maxlevel,
-		   (FttCellInitFunc) gfs_cell_fine_init, gfs_box_domain (box));
+  if (ftt_cell_level (cell) < gfs_function_value (p->maxlevel, cell))
+    g_ptr_array_add (p->cells, cell);
 }
 
 static void gfs_refine_refine (GfsRefine * refine, GfsSimulation * sim)
 {
+  GfsDomain * domain = GFS_DOMAIN (sim);
+  RefineParams p = { refine->maxlevel, g_ptr_array_new () };
+  guint l, depth = gfs_domain_depth (domain);
+
+  /* refine level by level: all the cells of a given level are refined
+     together using ftt_cell_refine_array() */
   gfs_catch_floating_point_exceptions ();
-  gts_container_foreach (GTS_CONTAINER (sim),
-			 (GtsFunc) refine_box, refine->maxlevel);
+  for (l = 0; l <= depth; l++) {
+    gfs_domain_cell_traverse (domain, FTT_PRE_ORDER, FTT_TRAVERSE_LEVEL | FTT_TRAVERSE_LEAFS, l,
+			      (FttCellTraverseFunc) add_maxlevel, &p);
+    if (p.cells->len > 0) {
+      ftt_cell_refine_array (p.cells, (FttCellInitFunc) gfs_cell_fine_init, domain);
+      g_ptr_array_set_size (p.cells, 0);
+      if (l + 1 > depth)
+	depth = l + 1;
+    }
+  }
   gfs_restore_fpe_for_function (refine->maxlevel);
+  g_ptr_array_free (p.cells, TRUE);
 }
 
 static void gfs_refine_destroy (GtsObject * o)
@@ -229,6 +229,16 @@ static gdouble center_sweby_gradient (FttCell * cell,
 
 /**
  * Solves the Saint-Venant equations.
+ *
+ * With the option local_dt = 1, each level of refinement is advanced
+ * with its own timestep: leaf cells at level minlevel + p take steps
+ * of dt/2^p. The fluxes across fine/coarse faces remain conservative.
+ * The scheme is then first-order in time (time_order is ignored) and
+ * local timestepping is disabled when solids are present.
+ *
+ * For a single layer of constant density, the face fluxes are
+ * computed by batches of faces (the default). The option batch = 0
+ * falls back to computing the flux of each face separately.
  * \beginobject{GfsRiver}
  */
 
@@ -413,35 +423,43 @@ static double right (const GfsRiver * r, const FttCellFace * f, int i, double a)
   return GFS_VALUE (f->neighbor, r->v1[i]) - a*GFS_VALUE (f->neighbor, r->dv[f->d/2][i]);
 }
 
-static void face_fluxes (FttCellFace * face, GfsRiver * r)
-{
-  gdouble eta = GFS_VALUE (face->cell, r->v1[H]), etan = GFS_VALUE (face->neighbor, r->v1[H]);
-
-  if (eta <= r->dry && etan <= r->dry)
-    return;
+static Sym sym[4] = {
+  {U,  1., V,  1.},
+  {U, -1., V, -1.},
+  {V,  1., U, -1.},
+  {V, -1., U,  1.}
+};
 
-  gdouble a = 1., b = 1.;
+/* distances of the face to the centers of mass of the cells, in units
+   of half the cell size */
+static void face_weights (const FttCellFace * face, gdouble * a, gdouble * b)
+{
+  *a = *b = 1.;
   if (GFS_IS_MIXED (face->cell)) {
     FttVector ca, cm;
     gfs_face_ca (face, &ca);
     gfs_cell_cm (face->cell, &cm);
     FttComponent c = face->d/2;
-    a = fabs (2.*((&ca.x)[c] - (&cm.x)[c])/ftt_cell_size (face->cell));
+    *a = fabs (2.*((&ca.x)[c] - (&cm.x)[c])/ftt_cell_size (face->cell));
   }
   if (GFS_IS_MIXED (face->neighbor)) {
     FttVector ca, cm;
     gfs_face_ca (face, &ca); /* fixme?: this is not symmetric with the above for face->cell */
     gfs_cell_cm (face->neighbor, &cm);
     FttComponent c = face->d/2;
-    b = fabs (2.*((&ca.x)[c] - (&cm.x)[c])/ftt_cell_size (face->neighbor));
+    *b = fabs (2.*((&ca.x)[c] - (&cm.x)[c])/ftt_cell_size (face->neighbor));
   } 
+}
+
+static void face_fluxes (FttCellFace * face, GfsRiver * r)
+{
+  gdouble eta = GFS_VALUE (face->cell, r->v1[H]), etan = GFS_VALUE (face->neighbor, r->v1[H]);
 
-  static Sym sym[4] = {
-    {U,  1., V,  1.},
-    {U, -1., V, -1.},
-    {V,  1., U, -1.},
-    {V, -1., U,  1.}
-  };
+  if (eta <= r->dry && etan <= r->dry)
+    return;
+
+  gdouble a, b;
+  face_weights (face, &a, &b);
   Sym * s = &sym[face->d];
 
   gdouble etaL = (eta <= r->dry ? 0. : left (r, face, H, a*s->du));
@@ -601,6 +619,230 @@ static void face_fluxes (FttCellFace * face, GfsRiver * r)
   }
 }
 
+/* Batched face fluxes for a single layer of constant density: the
+   reconstructed states of FACE_BATCH faces are gathered in arrays, the
+   Riemann problems are solved in a single loop without branches (which
+   the compiler can vectorise) and the fluxes are then scattered
+   back to the cells, in the same order as face_fluxes() would. The
+   "batch = 0" option of GfsRiver reverts to face_fluxes(). */
+
+#define FACE_BATCH 256
+
+struct _GfsFaceBatch {
+  FttCellFace face[FACE_BATCH];
+  gdouble eta[FACE_BATCH], etan[FACE_BATCH];
+  gdouble etaL[FACE_BATCH], etaR[FACE_BATCH], zbL[FACE_BATCH], zbR[FACE_BATCH];
+  gdouble hL[FACE_BATCH], uL[FACE_BATCH], vL[FACE_BATCH];
+  gdouble hR[FACE_BATCH], uR[FACE_BATCH], vR[FACE_BATCH];
+  gdouble fh[FACE_BATCH], fu[FACE_BATCH], fv[FACE_BATCH];
+  gdouble * tL, * tR; /* tracers: nt*FACE_BATCH */
+  guint n;
+};
+
+static GfsFaceBatch * face_batch_new (const GfsRiver * r)
+{
+  GfsFaceBatch * b = g_malloc (sizeof (GfsFaceBatch));
+  b->tL = g_malloc (MAX (r->nt, 1)*FACE_BATCH*sizeof (gdouble));
+  b->tR = g_malloc (MAX (r->nt, 1)*FACE_BATCH*sizeof (gdouble));
+  b->n = 0;
+  return b;
+}
+
+static void face_batch_destroy (GfsFaceBatch * b)
+{
+  g_free (b->tL);
+  g_free (b->tR);
+  g_free (b);
+}
+
+static void face_batch_gather (FttCellFace * face, GfsRiver * r)
+{
+  GfsFaceBatch * batch = r->batch;
+  gdouble eta = GFS_VALUE (face->cell, r->v1[H]), etan = GFS_VALUE (face->neighbor, r->v1[H]);
+
+  if (eta <= r->dry && etan <= r->dry)
+    return;
+
+  gdouble a, b;
+  face_weights (face, &a, &b);
+  Sym * s = &sym[face->d];
+  guint n = batch->n, i;
+
+  gdouble etaL = (eta <= r->dry ? 0. : left (r, face, H, a*s->du));
+  gdouble zbL = (GFS_VALUE (face->cell, r->zb)
+		 + a*s->du*GFS_VALUE (face->cell, r->dv[face->d/2][ZB]));
+  gdouble zbR = (GFS_VALUE (face->neighbor, r->zb)
+		 - b*s->du*GFS_VALUE (face->neighbor, r->dv[face->d/2][ZB])); 
+  gdouble zbLR = MAX (zbL, zbR);
+  gdouble uL, vL, uR, vR;
+
+  if (etaL > r->dry) {
+    uL = s->du*left (r, face, s->u, a*s->du)/etaL;
+    vL = s->dv*left (r, face, s->v, a*s->du)/etaL;
+    for (i = 0; i < r->nt; i++)
+      batch->tL[i*FACE_BATCH + n] = left (r, face, T(i,0), a*s->du)/etaL;
+  }
+  else {
+    uL = vL = 0.;
+    for (i = 0; i < r->nt; i++)
+      batch->tL[i*FACE_BATCH + n] = 0.;
+  }
+
+  gdouble etaR = (etan <= r->dry ? 0. : right (r, face, H, b*s->du));
+  if (etaR > r->dry) {
+    uR = s->du*right (r, face, s->u, b*s->du)/etaR;
+    vR = s->dv*right (r, face, s->v, b*s->du)/etaR;
+    for (i = 0; i < r->nt; i++)
+      batch->tR[i*FACE_BATCH + n] = right (r, face, T(i,0), a*s->du)/etaR;
+  }
+  else {
+    uR = vR = 0.;
+    for (i = 0; i < r->nt; i++)
+      batch->tR[i*FACE_BATCH + n] = 0.;
+  }
+
+  gdouble umax = GFS_SIMULATION (r)->advection_params.cfl*ftt_cell_size (face->cell)/r->dt;
+  batch->face[n] = *face;
+  batch->eta[n] = eta;
+  batch->etan[n] = etan;
+  batch->etaL[n] = etaL;
+  batch->etaR[n] = etaR;
+  batch->zbL[n] = zbL;
+  batch->zbR[n] = zbR;
+  batch->hL[n] = MAX (0., etaL + zbL - zbLR);
+  batch->hR[n] = MAX (0., etaR + zbR - zbLR);
+  batch->uL[n] = CFL_CLAMP (uL, umax);
+  batch->uR[n] = CFL_CLAMP (uR, umax);
+  batch->vL[n] = CFL_CLAMP (vL, umax);
+  batch->vR[n] = CFL_CLAMP (vR, umax);
+  batch->n++;
+}
+
+static void kinetic_batch (const GfsRiver * r, GfsFaceBatch * b)
+{
+  const gdouble g = r->g, dry = r->dry, dz = r->dz[0];
+  const gdouble * hL = b->hL, * uL = b->uL, * vL = b->vL;
+  const gdouble * hR = b->hR, * uR = b->uR, * vR = b->vR;
+  gdouble * fh = b->fh, * fu = b->fu, * fv = b->fv;
+  guint i, n = b->n;
+
+  /* same operations as riemann_kinetic() but without branches */
+  for (i = 0; i < n; i++) {
+    gdouble ci = sqrt (g*hL[i]/2.);
+    gdouble Mp = MAX (uL[i] + ci*SQRT3, 0.);
+    gdouble Mm = MAX (uL[i] - ci*SQRT3, 0.);
+    gdouble cig = dz*ci/(6.*g*SQRT3);
+    gdouble fHl = hL[i] > dry ? cig*3.*(Mp*Mp - Mm*Mm) : 0.;
+    gdouble fU = hL[i] > dry ? cig*2.*(Mp*Mp*Mp - Mm*Mm*Mm) : 0.;
+
+    ci = sqrt (g*hR[i]/2.);
+    Mp = MIN (uR[i] + ci*SQRT3, 0.);
+    Mm = MIN (uR[i] - ci*SQRT3, 0.);
+    cig = dz*ci/(6.*g*SQRT3);
+    fHl += hR[i] > dry ? cig*3.*(Mp*Mp - Mm*Mm) : 0.;
+    fU += hR[i] > dry ? cig*2.*(Mp*Mp*Mp - Mm*Mm*Mm) : 0.;
+
+    fh[i] = fHl;
+    fu[i] = fU;
+    fv[i] = (fHl > 0. ? vL[i] : vR[i])*fHl;
+  }
+}
+
+static void hllc_batch (const GfsRiver * r, GfsFaceBatch * b)
+{
+  const gdouble g = r->g;
+  const gdouble * hL = b->hL, * uL = b->uL, * vL = b->vL;
+  const gdouble * hR = b->hR, * uR = b->uR, * vR = b->vR;
+  gdouble * fh = b->fh, * fu = b->fu, * fv = b->fv;
+  guint i, n = b->n;
+
+  /* same operations as riemann_hllc() but without branches: the
+     fluxes of the three regions are computed and then selected, with
+     the denominators replaced by one where they are not used */
+  for (i = 0; i < n; i++) {
+    gdouble cL = sqrt (g*hL[i]), cR = sqrt (g*hR[i]);
+    gdouble ustar = (uL[i] + uR[i])/2. + cL - cR;
+    gdouble cstar = (cL + cR)/2. + (uL[i] - uR[i])/4.;
+    gdouble SL = hL[i] == 0. ? uR[i] - 2.*cR : MIN (uL[i] - cL, ustar - cstar);
+    gdouble SR = hR[i] == 0. ? uL[i] + 2.*cL : MAX (uR[i] + cR, ustar + cstar);
+
+    gdouble fhL = hL[i]*uL[i], fuL = hL[i]*(uL[i]*uL[i] + g*hL[i]/2.);
+    gdouble fhR = hR[i]*uR[i], fuR = hR[i]*(uR[i]*uR[i] + g*hR[i]/2.);
+
+    gdouble dS = SR > SL ? SR - SL : 1.;
+    gdouble fhs = (SR*fhL - SL*fhR + SL*SR*(hR[i] - hL[i]))/dS;
+    gdouble fus = (SR*fuL - SL*fuR + SL*SR*(hR[i]*uR[i] - hL[i]*uL[i]))/dS;
+    gdouble dM = hR[i]*(uR[i] - SR) - hL[i]*(uL[i] - SL);
+    gdouble SM = (SL*hR[i]*(uR[i] - SR) - SR*hL[i]*(uL[i] - SL))/(dM != 0. ? dM : 1.);
+
+    fh[i] = 0. <= SL ? fhL : 0. >= SR ? fhR : fhs;
+    fu[i] = 0. <= SL ? fuL : 0. >= SR ? fuR : fus;
+    fv[i] = 0. <= SL ? vL[i]*fhL : 0. >= SR ? vR[i]*fhR : (SM >= 0. ? vL[i] : vR[i])*fhs;
+  }
+}
+
+static void face_batch_scatter (GfsRiver * r, GfsFaceBatch * b)
+{
+  GfsDomain * domain = GFS_DOMAIN (r);
+  guint n, i;
+
+  for (n = 0; n < b->n; n++) {
+    FttCellFace * face = &b->face[n];
+    Sym * s = &sym[face->d];
+    gdouble h = ftt_cell_size (face->cell);
+    gdouble dt = gfs_domain_face_fraction (domain, face)*r->dt/h;
+    gdouble nn = (ftt_face_type (face) == FTT_FINE_COARSE ? FTT_CELLS : 1.);
+    gdouble fh = b->fh[n];
+    GFS_VALUE (face->cell, r->flux[H]) -= dt*fh;
+    GFS_VALUE (face->neighbor, r->flux[H]) += dt*fh/nn;
+
+    gdouble zb = GFS_VALUE (face->cell, r->zb);
+    gdouble zbn = GFS_VALUE (face->neighbor, r->zb);
+    gdouble eta = b->eta[n] <= r->dry ? 0. : b->eta[n];
+    gdouble etan = b->etan[n] <= r->dry ? 0. : b->etan[n];
+    gdouble etaL = b->etaL[n], etaR = b->etaR[n];
+    gdouble SbL = r->g/2.*(b->hL[n]*b->hL[n] - etaL*etaL - (etaL + eta)*(b->zbL[n] - zb));
+    gdouble SbR = r->g/2.*(b->hR[n]*b->hR[n] - etaR*etaR - (etaR + etan)*(b->zbR[n] - zbn));
+    gdouble dz = r->dz[0];
+    GFS_VALUE (face->cell, r->flux[s->u]) -= s->du*dt*(b->fu[n] - dz*SbL);
+    GFS_VALUE (face->neighbor, r->flux[s->u]) += s->du*dt*(b->fu[n] - dz*SbR)/nn;
+    GFS_VALUE (face->cell, r->flux[s->v]) -= s->dv*dt*b->fv[n];
+    GFS_VALUE (face->neighbor, r->flux[s->v]) += s->dv*dt*b->fv[n]/nn;
+    for (i = 0; i < r->nt; i++) {
+      double flux = dt*fh;
+      flux *= flux > 0. ? b->tL[i*FACE_BATCH + n] : b->tR[i*FACE_BATCH + n];
+      GFS_VALUE (face->cell, r->flux[T(i,0)]) -= flux;
+      GFS_VALUE (face->neighbor, r->flux[T(i,0)]) += flux/nn;
+    }
+  }
+}
+
+static void face_batch_flush (GfsRiver * r)
+{
+  GfsFaceBatch * b = r->batch;
+  if (b && b->n > 0) {
+    if (r->scheme == riemann_kinetic)
+      kinetic_batch (r, b);
+    else
+      hllc_batch (r, b);
+    face_batch_scatter (r, b);
+    b->n = 0;
+  }
+}
+
+/* same as face_fluxes() but fluxes are only added by face_batch_flush() */
+static void face_fluxes_batched (FttCellFace * face, GfsRiver * r)
+{
+  r->nfaces++;
+  if (r->batch) {
+    face_batch_gather (face, r);
+    if (r->batch->n == FACE_BATCH)
+      face_batch_flush (r);
+  }
+  else
+    face_fluxes (face, r);
+}
+
 static gdouble limited_gradient (const FttCell * cell, const GfsRiver * r, 
 				 int i0, int i1, int i2, 
 				 int l,
@@ -714,6 +956,7 @@ typedef struct {
   double * b; /* diagonal (destroyed) */
   double * c; /* sup-diagonal indexed from 0..n-2 */
   double * v; /* rhs (destroyed) */
+  double * w; /* second rhs (destroyed) */
   int n;
 } Tridiagonal;
 
@@ -723,21 +966,28 @@ static void tridiagonal_init (Tridiagonal * t, int n)
   t->b = g_malloc (sizeof (double)*n);
   t->c = g_malloc (sizeof (double)*(n - 1));
   t->v = g_malloc (sizeof (double)*n);
+  t->w = g_malloc (sizeof (double)*n);
   t->n = n;
 }
 
-static void tridiagonal_solve (Tridiagonal * t, double * x)
+/* solves the system for the two right-hand sides v and w, which share
+   the same elimination */
+static void tridiagonal_solve (Tridiagonal * t, double * x, double * y)
 {
   int n = t->n;
-  double * a = t->a, * b = t->b, * c = t->c, * v = t->v;
+  double * a = t->a, * b = t->b, * c = t->c, * v = t->v, * w = t->w;
   for (int i = 1; i < n; i++) {
     double m = a[i]/b[i-1];
     b[i] -= m*c[i-1];
     v[i] -= m*v[i-1];
+    w[i] -= m*w[i-1];
   }
   x[n-1] = v[n-1]/b[n-1];  
-  for (int i = n - 2; i >= 0; i--)
+  y[n-1] = w[n-1]/b[n-1];  
+  for (int i = n - 2; i >= 0; i--) {
     x[i] = (v[i] - c[i]*x[i+1])/b[i];  
+    y[i] = (w[i] - c[i]*y[i+1])/b[i];  
+  }
 }
 
 static void tridiagonal_free (Tridiagonal * t)
@@ -746,10 +996,13 @@ static void tridiagonal_free (Tridiagonal * t)
   g_free (t->b);
   g_free (t->c);
   g_free (t->v);
+  g_free (t->w);
 }
 
-/* see doc/figures/diffusion.tm */
-static void vertical_diffusion (double * u, 
+/* see doc/figures/diffusion.tm 
+   The two velocity components u and v are diffused together (they
+   share the same matrix), the top stress dut only applies to u. */
+static void vertical_diffusion (double * u, double * v,
 				const double * mu, const double * dz,
 				int N, double dt,
 				double dut, 
@@ -769,16 +1022,19 @@ static void vertical_diffusion (double * u,
   t->b[0] = 1. + a[0] + (1. - (2.*lambdab - dz[0])/(2.*lambdab + dz[0]))*am;
   t->c[0] = - a[0];
   t->v[0] = u[0] + 2.*dz[0]/(2.*lambdab + dz[0])*ub*am;
+  t->w[0] = v[0] + 2.*dz[0]/(2.*lambdab + dz[0])*ub*am;
   for (int l = 1; l < N - 1; l++) {
     t->a[l] = - a[l-1];
     t->b[l] = 1. + a[l] + a[l-1];
     t->c[l] = - a[l];
     t->v[l] = u[l];
+    t->w[l] = v[l];
   }
   t->a[N-1] = - a[N-2];
   t->b[N-1] = 1. + a[N-2];
   t->v[N-1] = u[N-1] + dut*dz[N-1]*a[N-1];
-  tridiagonal_solve (t, u);
+  t->w[N-1] = v[N-1];
+  tridiagonal_solve (t, u, v);
 }
 
 /* bottom friction for a single layer. For more than one layer, bottom
@@ -802,13 +1058,14 @@ static void domain_vertical_diffusion (GfsRiver * r, double dt)
   tridiagonal_init (&tri, n);
   double * a = g_malloc (n*sizeof (double));
   double * u = g_malloc (n*sizeof (double));
+  double * v = g_malloc (n*sizeof (double));
   double * mu = g_malloc (n*sizeof (double));
   double * dz = g_malloc (n*sizeof (double));
 
-  FttCellTraverse * t = gfs_domain_cell_traverse_new (GFS_DOMAIN (r), 
-						      FTT_PRE_ORDER, FTT_TRAVERSE_LEAFS, -1);
+  FttCellTraverse t;
+  gfs_domain_cell_traverse_borrow (GFS_DOMAIN (r), FTT_PRE_ORDER, FTT_TRAVERSE_LEAFS, -1, &t);
   FttCell * cell;
-  while ((cell = ftt_cell_traverse_next (t))) {
+  while ((cell = ftt_cell_traverse_next (&t))) {
     double h = GFS_VALUE (cell, r->v[H]);
     if (h > r->dry) {
       double nu = gfs_function_value (r->nu, cell);
@@ -816,18 +1073,15 @@ static void domain_vertical_diffusion (GfsRiver * r, double dt)
 	mu[l] = nu;
 	dz[l] = r->dz[l]*h;
 	u[l] = GFS_VALUE (cell, r->v[U + 2*l])/dz[l];
+	v[l] = GFS_VALUE (cell, r->v[V + 2*l])/dz[l];
       }
       double lambdab = 0., ub = 0., dut = r->dut ? gfs_function_value (r->dut, cell) : 0.;
       double k = r->k ? gfs_function_value (r->k, cell) : 0.;
-      vertical_diffusion (u, mu, dz, n, dt, dut, lambdab, ub, k, &tri, a);
+      vertical_diffusion (u, v, mu, dz, n, dt, dut, lambdab, ub, k, &tri, a);
       for (int l = 0; l < n; l++) {
 	GFS_VALUE (cell, r->v[U + 2*l]) = u[l]*dz[l];
-	u[l] = GFS_VALUE (cell, r->v[V + 2*l])/dz[l];
+	GFS_VALUE (cell, r->v[V + 2*l]) = v[l]*dz[l];
       }
-      dut = 0.;
-      vertical_diffusion (u, mu, dz, n, dt, dut, lambdab, ub, k, &tri, a);
-      for (int l = 0; l < n; l++)
-	GFS_VALUE (cell, r->v[V + 2*l]) = u[l]*dz[l];
     }
     else
       for (int l = 0; l < n; l++) {
@@ -835,40 +1089,124 @@ static void domain_vertical_diffusion (GfsRiver * r, double dt)
 	GFS_VALUE (cell, r->v[V + 2*l]) = 0.;
       }
   }
-  ftt_cell_traverse_destroy (t);
 
   g_free (a);
   g_free (u);
+  g_free (v);
   g_free (mu);
   g_free (dz);
   tridiagonal_free (&tri);
 }
 
-static void advance (GfsRiver * r, gdouble dt)
+/* Active set: the wet cells and the dry cells of the wet/dry front
+   (i.e. with at least one wet neighbor). Faces between two dry cells
+   carry no flux so that only the active cells need to be considered
+   for fluxes and gradients. The set is built once per timestep: the
+   front cells which become wet during the predictor step can then
+   have inactive neighbors and the corresponding faces must be
+   computed from the active side. */
+
+#define INACTIVE (1 << GFS_FLAG_USER)
+
+static void active_set_traverse (GfsRiver * r, FttCellTraverseFunc func, gpointer data)
 {
-  GfsDomain * domain = GFS_DOMAIN (r);
   guint i;
+  for (i = 0; i < r->active->len; i++)
+    (* func) (g_ptr_array_index (r->active, i), data);
+}
+
+static void inactive_children_fluxes (FttCell * cell, FttDirection d, GfsRiver * r)
+{
+  FttCellChildren child;
+  FttCellFace face;
+  face.d = FTT_OPPOSITE_DIRECTION (d);
+  face.neighbor = cell;
+  guint i, n = ftt_cell_children_direction (ftt_cell_neighbor (cell, d), face.d, &child);
+  for (i = 0; i < n; i++)
+    if ((face.cell = child.c[i]) && (face.cell->flags & INACTIVE))
+      face_fluxes_batched (&face, r);
+}
+
+static void leaf_face_fluxes (FttCell * cell, GfsRiver * r)
+{
+  FttCellFace face;
+  face.cell = cell;
+  for (face.d = 0; face.d < FTT_NEIGHBORS; face.d++) {
+    face.neighbor = ftt_cell_neighbor (cell, face.d);
+    if (!face.neighbor)
+      continue;
+    /* finer neighbors own their faces, same-level faces are computed once */
+    if (FTT_CELL_IS_LEAF (face.neighbor)) {
+      if (ftt_cell_level (face.neighbor) < ftt_cell_level (cell) ||
+	  face.d % 2 == 0 || GFS_CELL_IS_BOUNDARY (face.neighbor) ||
+	  (face.neighbor->flags & INACTIVE))
+	face_fluxes_batched (&face, r);
+    }
+    else if (!GFS_CELL_IS_BOUNDARY (face.neighbor))
+      inactive_children_fluxes (cell, face.d, r);
+  }
+}
 
-  gfs_domain_traverse_leaves (domain, (FttCellTraverseFunc) reset_fluxes, r);
-  r->dt = dt;
-  gfs_domain_face_traverse (domain, FTT_XYZ,
-			    FTT_PRE_ORDER, FTT_TRAVERSE_LEAFS, -1,
-			    (FttFaceTraverseFunc) face_fluxes, r);
-  if (r->nlayers > 1)
-    gfs_domain_traverse_leaves (domain, (FttCellTraverseFunc) vertical_advection, r);
-  gfs_domain_traverse_mixed (domain,
-  			     FTT_PRE_ORDER, FTT_TRAVERSE_LEAFS,
-  			     (FttCellTraverseFunc) solid_boundary_fluxes, domain);
-  if (domain->cell_metric)
-    gfs_domain_traverse_leaves (domain, (FttCellTraverseFunc) metric_sources, r);
-  for (i = 0; i < r->nvar; i++) {
-    GfsAdvectionParams par;
-    par.v = r->v[i];
-    par.fv = r->flux[i];
-    par.average = FALSE;
-    gfs_domain_traverse_merged (domain, (GfsMergedTraverseFunc) gfs_advection_update, &par);
-    gfs_domain_variable_centered_sources (domain, par.v, par.v, dt);
+typedef struct {
+  GfsRiver * r;
+  FttDirection d;
+} BoundaryFluxes;
+
+static void coarse_boundary_fluxes (FttCell * cell, BoundaryFluxes * p)
+{
+  /* fine ghost cells facing a coarse leaf (e.g. parallel boundaries) */
+  FttCell * neighbor = ftt_cell_neighbor (cell, p->d);
+  /* interior non-leaf neighbors own these faces (see leaf_face_fluxes()):
+     only ghost neighbors need to be considered */
+  if (FTT_CELL_IS_LEAF (cell) && neighbor && 
+      !FTT_CELL_IS_LEAF (neighbor) && GFS_CELL_IS_BOUNDARY (neighbor)) {
+    FttCellChildren child;
+    FttCellFace face;
+    face.d = FTT_OPPOSITE_DIRECTION (p->d);
+    face.neighbor = cell;
+    guint i, n = ftt_cell_children_direction (neighbor, face.d, &child);
+    for (i = 0; i < n; i++)
+      if ((face.cell = child.c[i]))
+	face_fluxes_batched (&face, p->r);
   }
+}
+
+static void active_face_fluxes (FttCell * cell, GfsRiver * r)
+{
+  BoundaryFluxes b = { r };
+  leaf_face_fluxes (cell, r);
+  for (b.d = 0; b.d < FTT_NEIGHBORS; b.d++)
+    coarse_boundary_fluxes (cell, &b);
+}
+
+static void active_solid_boundary_fluxes (FttCell * cell, GfsRiver * r)
+{
+  if (GFS_IS_MIXED (cell))
+    solid_boundary_fluxes (cell, r);
+}
+
+/* boundary conditions on all the state variables at once */
+static void state_bc (GfsRiver * r)
+{
+  gfs_domain_bc_bundle (GFS_DOMAIN (r), FTT_TRAVERSE_LEAFS, -1, r->v, r->nvar);
+  r->nbc++;
+}
+
+/* boundary conditions on all the gradients at once */
+static void gradients_bc (GfsRiver * r)
+{
+  gfs_domain_bc_bundle (GFS_DOMAIN (r), FTT_TRAVERSE_LEAFS, -1, 
+			r->dvbundle, FTT_DIMENSION*(r->nvar + 1));
+  r->nbc++;
+}
+
+/* centered sources, Coriolis, vertical diffusion and bottom friction,
+   applied once the fluxes have been added */
+static void advance_sources (GfsRiver * r, gdouble dt)
+{
+  GfsDomain * domain = GFS_DOMAIN (r);
+  guint i;
+
   if (r->nlayers > 1) {
     /* also add "global" sources specified through U,V to momentum on each layer */
     GfsVariable ** u = gfs_domain_velocity (domain);
@@ -889,8 +1227,38 @@ static void advance (GfsRiver * r, gdouble dt)
     g_assert (r->nlayers == 1);
     gfs_domain_traverse_leaves (domain, (FttCellTraverseFunc) bottom_friction, r);
   }
-  for (i = 0; i < r->nvar; i++)
-    gfs_domain_bc (domain, FTT_TRAVERSE_LEAFS, -1, r->v[i]);
+  state_bc (r);
+}
+
+static void advance (GfsRiver * r, gdouble dt)
+{
+  GfsDomain * domain = GFS_DOMAIN (r);
+  guint i;
+
+  /* the fluxes of inactive cells are reset by active_set_update() */
+  active_set_traverse (r, (FttCellTraverseFunc) reset_fluxes, r);
+  r->dt = dt;
+  static GfsTimerCache fluxes = { 0, NULL };
+  gfs_timer_start (domain, gfs_domain_timer_cached (domain, "fluxes", &fluxes));
+  active_set_traverse (r, (FttCellTraverseFunc) active_face_fluxes, r);
+  face_batch_flush (r);
+  gfs_domain_timer_add_items (domain, r->nfaces);
+  gfs_timer_stop (domain, fluxes.t);
+  r->nfaces = 0;
+  if (r->nlayers > 1)
+    active_set_traverse (r, (FttCellTraverseFunc) vertical_advection, r);
+  active_set_traverse (r, (FttCellTraverseFunc) active_solid_boundary_fluxes, r);
+  if (domain->cell_metric)
+    active_set_traverse (r, (FttCellTraverseFunc) metric_sources, r);
+  for (i = 0; i < r->nvar; i++) {
+    GfsAdvectionParams par;
+    par.v = r->v[i];
+    par.fv = r->flux[i];
+    par.average = FALSE;
+    gfs_domain_traverse_merged (domain, (GfsMergedTraverseFunc) gfs_advection_update, &par);
+    gfs_domain_variable_centered_sources (domain, par.v, par.v, dt);
+  }
+  advance_sources (r, dt);
 }
 
 static void copy (FttCell * cell, const GfsRiver * r)
@@ -951,14 +1319,13 @@ static void face_traverse (FttCell * cell, FaceTraverseData * p)
     (* p->func) (neighbor, p->data);
 }
 
-static void domain_traverse_all_leaves (GfsDomain * domain,
-					FttCellTraverseFunc func,
-					gpointer data)
+/* traverses the (ghost) boundary cells */
+static void domain_traverse_boundary_leaves (GfsDomain * domain,
+					     FttCellTraverseFunc func,
+					     gpointer data)
 {
   FaceTraverseData p;
 
-  gfs_domain_traverse_leaves (domain, func, data);
-  /* now traverses boundary cells */
   p.func = func;
   p.data = data;
   for (p.d = 0; p.d < FTT_NEIGHBORS; p.d++)
@@ -966,6 +1333,67 @@ static void domain_traverse_all_leaves (GfsDomain * domain,
 				       (FttCellTraverseFunc) face_traverse, &p);
 }
 
+static void domain_traverse_all_leaves (GfsDomain * domain,
+					FttCellTraverseFunc func,
+					gpointer data)
+{
+  gfs_domain_traverse_leaves (domain, func, data);
+  domain_traverse_boundary_leaves (domain, func, data);
+}
+
+static gboolean neighbor_is_wet (FttCell * cell, FttDirection d, const GfsRiver * r)
+{
+  FttCell * neighbor = ftt_cell_neighbor (cell, d);
+  if (!neighbor)
+    return FALSE;
+  if (FTT_CELL_IS_LEAF (neighbor))
+    return GFS_VALUE (neighbor, r->v[H]) > r->dry;
+  FttCellChildren child;
+  guint i, n = ftt_cell_children_direction (neighbor, FTT_OPPOSITE_DIRECTION (d), &child);
+  for (i = 0; i < n; i++)
+    if (child.c[i] && GFS_VALUE (child.c[i], r->v[H]) > r->dry)
+      return TRUE;
+  return FALSE;
+}
+
+typedef struct {
+  GfsRiver * r;
+  guint nleafs;
+} ActiveSet;
+
+static void active_set_add (FttCell * cell, ActiveSet * p)
+{
+  GfsRiver * r = p->r;
+  gboolean active = GFS_VALUE (cell, r->v[H]) > r->dry;
+  FttDirection d;
+  for (d = 0; d < FTT_NEIGHBORS && !active; d++)
+    active = neighbor_is_wet (cell, d, r);
+  cell_H (cell, r);
+  reset_fluxes (cell, r);
+  copy (cell, r);
+  if (active) {
+    cell->flags &= ~INACTIVE;
+    g_ptr_array_add (r->active, cell);
+  }
+  else { /* dry cell away from the front: zero gradients */
+    cell->flags |= INACTIVE;
+    cell_gradients (cell, r);
+  }
+  p->nleafs++;
+}
+
+static void active_set_update (GfsRiver * r)
+{
+  GfsDomain * domain = GFS_DOMAIN (r);
+  ActiveSet p = { r, 0 };
+
+  g_ptr_array_set_size (r->active, 0);
+  gfs_domain_traverse_leaves (domain, (FttCellTraverseFunc) active_set_add, &p);
+  domain_traverse_boundary_leaves (domain, (FttCellTraverseFunc) cell_H, r);
+  gfs_debug ("active cells: %d/%d (%.1f%%)", r->active->len, p.nleafs,
+	     p.nleafs > 0 ? 100.*r->active->len/p.nleafs : 0.);
+}
+
 static void dirichlet_p (FttCellFace * f, GfsBc * b)
 {
   GFS_VALUE (f->cell, b->v) = gfs_function_face_value (GFS_BC_VALUE (b)->val, f);
@@ -995,6 +1423,164 @@ static void fix_box_bc (GfsBox * box, GfsRiver * r)
     }
 }
 
+/* Local time stepping: each level of refinement advances with its
+   own timestep. Leaf cells of level lmin + p advance with dt/2^p where
+   dt is the global timestep. Each face is computed with the timestep
+   of its finest side and its fluxes are accumulated in the flux
+   registers of both cells, which are only emptied at the end of each
+   (local) step of the cell: this guarantees conservation across
+   fine/coarse boundaries.
+
+   The ratio between the coarsest and finest timesteps is limited to
+   2^LOCAL_DT_MAX_LEVELS: levels coarser than lbase = lmax -
+   LOCAL_DT_MAX_LEVELS all advance with the timestep of lbase. The
+   leaf cells (and ghost boundary cells) are sorted by level once per
+   step so that each substep only visits the levels active in it. */
+
+#define LOCAL_DT_MAX_LEVELS 6
+
+typedef struct {
+  GfsRiver * r;
+  gdouble dt;
+  guint n, nglobal;
+} LocalStep;
+
+static guint level_substeps (const GfsRiver * r, guint level)
+{
+  /* number of substeps of the finest level in one step of @level */
+  return 1 << (r->lmax - CLAMP (level, r->lbase, r->lmax));
+}
+
+/* the coarsest level starting (or ending, for @k + 1) a step at substep @k */
+static guint substep_level (const GfsRiver * r, guint k)
+{
+  guint l = r->lmin;
+  while (k % level_substeps (r, l))
+    l++;
+  return l;
+}
+
+static void level_leaves_traverse (GPtrArray * leaves, FttCellTraverseFunc func, gpointer data)
+{
+  guint i;
+  for (i = 0; i < leaves->len; i++)
+    (* func) (g_ptr_array_index (leaves, i), data);
+}
+
+static void add_level_leaf (FttCell * cell, GPtrArray ** leaves)
+{
+  g_ptr_array_add (leaves[ftt_cell_level (cell)], cell);
+}
+
+static void level_leaves_update (GfsRiver * r)
+{
+  guint l;
+  if (r->nlevels < r->lmax + 1) {
+    r->leaves = g_realloc (r->leaves, (r->lmax + 1)*sizeof (GPtrArray *));
+    r->ghosts = g_realloc (r->ghosts, (r->lmax + 1)*sizeof (GPtrArray *));
+    for (l = r->nlevels; l <= r->lmax; l++) {
+      r->leaves[l] = g_ptr_array_new ();
+      r->ghosts[l] = g_ptr_array_new ();
+    }
+    r->nlevels = r->lmax + 1;
+  }
+  for (l = 0; l < r->nlevels; l++) {
+    g_ptr_array_set_size (r->leaves[l], 0);
+    g_ptr_array_set_size (r->ghosts[l], 0);
+  }
+  GfsDomain * domain = GFS_DOMAIN (r);
+  gfs_domain_traverse_leaves (domain, (FttCellTraverseFunc) add_level_leaf, r->leaves);
+  domain_traverse_boundary_leaves (domain, (FttCellTraverseFunc) add_level_leaf, r->ghosts);
+}
+
+/* boundary conditions on the levels finer than or equal to @lstart */
+static void levels_bc (GfsRiver * r, guint lstart, GfsVariable ** v, guint n)
+{
+  guint l;
+  for (l = lstart; l <= r->lmax; l++)
+    gfs_domain_bc_bundle (GFS_DOMAIN (r), FTT_TRAVERSE_LEVEL, l, v, n);
+  r->nbc++;
+}
+
+static void level_update (FttCell * cell, LocalStep * p)
+{
+  GfsRiver * r = p->r;
+  GfsDomain * domain = GFS_DOMAIN (r);
+  if (r->nlayers > 1)
+    vertical_advection (cell, r);
+  if (domain->cell_metric)
+    metric_sources (cell, r);
+  gdouble a = gfs_domain_cell_fraction (domain, cell);
+  guint i;
+  for (i = 0; i < r->nvar; i++)
+    GFS_VALUE (cell, r->v[i]) += GFS_VALUE (cell, r->flux[i])/a;
+  reset_fluxes (cell, r);
+  copy (cell, r);
+  cell_H (cell, r);
+  p->n++;
+  p->nglobal += level_substeps (r, ftt_cell_level (cell));
+}
+
+static void level_boundary_update (FttCell * cell, GfsRiver * r)
+{
+  copy (cell, r);
+  cell_H (cell, r);
+}
+
+static void advance_local (GfsRiver * r, gdouble dt)
+{
+  GfsDomain * domain = GFS_DOMAIN (r);
+  guint nsub = level_substeps (r, r->lmin), k, l, v;
+  LocalStep p = { r, dt/nsub, 0, 0 };
+
+  level_leaves_update (r);
+  domain_traverse_all_leaves (domain, (FttCellTraverseFunc) reset_fluxes, r);
+  domain_traverse_all_leaves (domain, (FttCellTraverseFunc) copy, r);
+  for (k = 0; k < nsub; k++) {
+    /* gradients of the levels starting a step */
+    guint lstart = substep_level (r, k);
+    for (l = lstart; l <= r->lmax; l++)
+      level_leaves_traverse (r->leaves[l], (FttCellTraverseFunc) cell_gradients, r);
+    levels_bc (r, lstart, r->dvbundle, FTT_DIMENSION*(r->nvar + 1));
+
+    /* fluxes of the faces owned by these levels */
+    for (l = lstart; l <= r->lmax; l++) {
+      r->dt = p.dt*level_substeps (r, l);
+      level_leaves_traverse (r->leaves[l], (FttCellTraverseFunc) leaf_face_fluxes, r);
+      if (l > r->lmin) {
+	BoundaryFluxes b = { r };
+	for (b.d = 0; b.d < FTT_NEIGHBORS; b.d++)
+	  gfs_domain_cell_traverse_boundary (domain, b.d, 
+					     FTT_PRE_ORDER, FTT_TRAVERSE_LEVEL, l - 1,
+					     (FttCellTraverseFunc) coarse_boundary_fluxes, &b);
+      }
+      face_batch_flush (r);
+    }
+
+    /* update the levels ending a step */
+    guint lend = substep_level (r, k + 1);
+    for (l = lend; l <= r->lmax; l++) {
+      r->dt = p.dt*level_substeps (r, l);
+      level_leaves_traverse (r->leaves[l], (FttCellTraverseFunc) level_update, &p);
+    }
+    levels_bc (r, lend, r->v, r->nvar);
+    for (l = lend; l <= r->lmax; l++)
+      level_leaves_traverse (r->ghosts[l], (FttCellTraverseFunc) level_boundary_update, r);
+  }
+
+  /* sources are split from the (sub-cycled) fluxes and use the global timestep */
+  r->dt = dt;
+  for (v = 0; v < r->nvar; v++)
+    gfs_domain_variable_centered_sources (domain, r->v[v], r->v[v], dt);
+  advance_sources (r, dt);
+
+  /* items are cell updates rather than faces */
+  gfs_domain_timer_add_items (domain, p.n);
+  r->nfaces = 0;
+  gfs_debug ("levels %d-%d: %d substeps, %d cell updates (%d with global timestepping)",
+	     r->lmin, r->lmax, nsub, p.n, p.nglobal);
+}
+
 static void river_run (GfsSimulation * sim)
 {
   GfsDomain * domain = GFS_DOMAIN (sim);
@@ -1017,6 +1603,21 @@ static void river_run (GfsSimulation * sim)
   gfs_simulation_refine (sim);
   gfs_simulation_init (sim);
 
+  if (r->batched && r->nlayers == 1 && !r->variable_density && !r->batch)
+    r->batch = face_batch_new (r);
+
+  /* gradients are exchanged as a single bundle */
+  r->dvbundle = g_realloc (r->dvbundle, FTT_DIMENSION*(r->nvar + 1)*sizeof (GfsVariable *));
+  for (FttComponent c = 0; c < FTT_DIMENSION; c++)
+    for (guint v = 0; v < r->nvar + 1; v++)
+      r->dvbundle[c*(r->nvar + 1) + v] = r->dv[c][v];
+
+  if (r->local_dt && sim->solids->items) {
+    /* small cells are merged with neighbors which may belong to other levels */
+    g_warning ("local timestepping cannot be used with solid boundaries");
+    r->local_dt = FALSE;
+  }
+
   gfs_simulation_set_timestep (sim);
 
   domain_traverse_all_leaves (domain, (FttCellTraverseFunc) cell_H, r);
@@ -1028,34 +1629,49 @@ static void river_run (GfsSimulation * sim)
     /* events */
     gts_container_foreach (GTS_CONTAINER (sim->events), (GtsFunc) gfs_event_do, sim);
 
-    /* update H */
-    domain_traverse_all_leaves (domain, (FttCellTraverseFunc) cell_H, r);
-    
-    /* gradients */
-    gfs_domain_timer_start (domain, "gradients");
-    gfs_domain_traverse_leaves (domain, (FttCellTraverseFunc) cell_gradients, r);
-    FttComponent c;
-    guint v;
-    for (c = 0; c < FTT_DIMENSION; c++)
-      for (v = 0; v < r->nvar + 1; v++)
-	gfs_domain_bc (domain, FTT_TRAVERSE_LEAFS, -1, r->dv[c][v]);
-    gfs_domain_timer_stop (domain, "gradients");
-
-    /* predictor */
-    domain_traverse_all_leaves (domain, (FttCellTraverseFunc) copy, r);
-    if (r->time_order == 2) {
-      gfs_domain_timer_start (domain, "predictor");
-      for (v = 0; v < r->nvar; v++)
-	gfs_variables_swap (r->v[v], r->v1[v]);
-      advance (r, sim->advection_params.dt/2.);
-      for (v = 0; v < r->nvar; v++)
-	gfs_variables_swap (r->v[v], r->v1[v]);
-      gfs_domain_timer_stop (domain, "predictor");
+    if (r->local_dt) {
+      /* update H */
+      domain_traverse_all_leaves (domain, (FttCellTraverseFunc) cell_H, r);
+
+      static GfsTimerCache local = { 0, NULL };
+      gfs_timer_start (domain,
+		       gfs_domain_timer_cached (domain, "local_timestepping", &local));
+      advance_local (r, sim->advection_params.dt);
+      gfs_timer_stop (domain, local.t);
+    }
+    else {
+      /* update H and the active set */
+      active_set_update (r);
+
+      /* gradients */
+      static GfsTimerCache gradients = { 0, NULL };
+      gfs_timer_start (domain, gfs_domain_timer_cached (domain, "gradients", &gradients));
+      active_set_traverse (r, (FttCellTraverseFunc) cell_gradients, r);
+      gradients_bc (r);
+      gfs_domain_timer_add_items (domain, r->active->len);
+      gfs_timer_stop (domain, gradients.t);
+
+      /* predictor */
+      domain_traverse_boundary_leaves (domain, (FttCellTraverseFunc) copy, r);
+      guint v;
+      if (r->time_order == 2) {
+	static GfsTimerCache predictor = { 0, NULL };
+	gfs_timer_start (domain, gfs_domain_timer_cached (domain, "predictor", &predictor));
+	for (v = 0; v < r->nvar; v++)
+	  gfs_variables_swap (r->v[v], r->v1[v]);
+	advance (r, sim->advection_params.dt/2.);
+	for (v = 0; v < r->nvar; v++)
+	  gfs_variables_swap (r->v[v], r->v1[v]);
+	gfs_timer_stop (domain, predictor.t);
+      }
+      /* corrector */
+      static GfsTimerCache corrector = { 0, NULL };
+      gfs_timer_start (domain, gfs_domain_timer_cached (domain, "corrector", &corrector));
+      advance (r, sim->advection_params.dt);
+      gfs_timer_stop (domain, corrector.t);
     }
-    /* corrector */
-    gfs_domain_timer_start (domain, "corrector");
-    advance (r, sim->advection_params.dt);
-    gfs_domain_timer_stop (domain, "corrector");
+    gfs_debug ("%d boundary condition passes", r->nbc);
+    r->nbc = 0;
 
     /* update H */
     domain_traverse_all_leaves (domain, (FttCellTraverseFunc) cell_H, r);
@@ -1093,9 +1709,9 @@ static gdouble maximum_face_metric (FttCell * cell, GfsDomain * domain, FttCompo
     return 1.;
 }
 
-static void minimum_cfl (FttCell * cell, GfsRiver * r)
+static gdouble cell_cfl (FttCell * cell, GfsRiver * r)
 {
-  gdouble h = GFS_VALUE (cell, r->v[H]);
+  gdouble h = GFS_VALUE (cell, r->v[H]), cflmin = G_MAXDOUBLE;
   if (h > r->dry) {
     GfsDomain * domain = GFS_DOMAIN (r);
     gdouble vol = ftt_cell_size (cell);
@@ -1109,19 +1725,60 @@ static void minimum_cfl (FttCell * cell, GfsRiver * r)
       for (l = 0; l < r->nlayers; l++) {
 	gdouble uh = fabs (GFS_VALUE (cell, r->v[c + 1 + 2*l]));
 	gdouble cfl = vol/(fm*(uh/(r->dz[l]*h) + cg));
-	if (cfl < r->cfl)
-	  r->cfl = cfl;
+	if (cfl < cflmin)
+	  cflmin = cfl;
       }
     }
   }
+  return cflmin;
+}
+
+static void minimum_cfl (FttCell * cell, GfsRiver * r)
+{
+  gdouble cfl = cell_cfl (cell, r);
+  if (cfl < r->cfl)
+    r->cfl = cfl;
+}
+
+static void level_cfl (FttCell * cell, GfsRiver * r)
+{
+  guint level = ftt_cell_level (cell);
+  gdouble cfl = cell_cfl (cell, r);
+  if (cfl < r->lcfl[level])
+    r->lcfl[level] = cfl;
+  if (level < r->lmin)
+    r->lmin = level;
+  if (level > r->lmax)
+    r->lmax = level;
 }
 
 static gdouble river_cfl (GfsSimulation * sim)
 {
   GfsRiver * r = GFS_RIVER (sim);
+  GfsDomain * domain = GFS_DOMAIN (sim);
+  if (r->local_dt) {
+    guint depth = gfs_domain_depth (domain), l;
+    r->lcfl = g_realloc (r->lcfl, (depth + 1)*sizeof (gdouble));
+    for (l = 0; l <= depth; l++)
+      r->lcfl[l] = G_MAXDOUBLE;
+    r->lmin = depth; r->lmax = 0;
+    gfs_domain_traverse_leaves (domain, (FttCellTraverseFunc) level_cfl, r);
+    gfs_all_reduce (domain, r->lmin, MPI_UNSIGNED, MPI_MIN);
+    gfs_all_reduce (domain, r->lmax, MPI_UNSIGNED, MPI_MAX);
+    r->lbase = r->lmax > r->lmin + LOCAL_DT_MAX_LEVELS ? r->lmax - LOCAL_DT_MAX_LEVELS : r->lmin;
+    /* level lbase + p advances with dt/2^p */
+    r->cfl = G_MAXDOUBLE;
+    for (l = r->lmin; l <= r->lmax; l++) {
+      gfs_all_reduce (domain, r->lcfl[l], MPI_DOUBLE, MPI_MIN);
+      gdouble cfl = r->lcfl[l]*(1 << (MAX (l, r->lbase) - r->lbase));
+      if (r->lcfl[l] < G_MAXDOUBLE && cfl < r->cfl)
+	r->cfl = cfl;
+    }
+    return r->cfl;
+  }
   r->cfl = G_MAXDOUBLE;
-  gfs_domain_traverse_leaves (GFS_DOMAIN (sim), (FttCellTraverseFunc) minimum_cfl, r);
-  gfs_all_reduce (GFS_DOMAIN (sim), r->cfl, MPI_DOUBLE, MPI_MIN);
+  gfs_domain_traverse_leaves (domain, (FttCellTraverseFunc) minimum_cfl, r);
+  gfs_all_reduce (domain, r->cfl, MPI_DOUBLE, MPI_MIN);
   return r->cfl;
 }
 
@@ -1206,6 +1863,8 @@ static void river_read (GtsObject ** o, GtsFile * fp)
       {GTS_OBJ,    "nu",         TRUE, &river->nu},
       {GTS_OBJ,    "dut",        TRUE, &river->dut},
       {GTS_OBJ,    "k",          TRUE, &river->k},
+      {GTS_INT,    "local_dt",   TRUE, &river->local_dt},
+      {GTS_INT,    "batch",      TRUE, &river->batched},
       {GTS_NONE}
     };
     gts_file_assign_variables (fp, var);
@@ -1263,6 +1922,10 @@ static void river_write (GtsObject * o, FILE * fp)
 	   river->time_order,
 	   river->dry*GFS_SIMULATION (river)->physical_params.L,
 	   river->scheme == riemann_hllc ? "hllc" : "kinetic");
+  if (river->local_dt)
+    fputs ("  local_dt = 1\n", fp);
+  if (!river->batched)
+    fputs ("  batch = 0\n", fp);
   if (river->nu) {
     fputs ("  nu =", fp);
     gfs_function_write (river->nu, fp);
@@ -1289,7 +1952,18 @@ static void river_destroy (GtsObject * o)
   g_free (r->uL);
   g_free (r->uR);
   g_free (r->f);
+  g_free (r->lcfl);
+  g_free (r->dvbundle);
+  g_ptr_array_free (r->active, TRUE);
   int i;
+  for (i = 0; i < r->nlevels; i++) {
+    g_ptr_array_free (r->leaves[i], TRUE);
+    g_ptr_array_free (r->ghosts[i], TRUE);
+  }
+  g_free (r->leaves);
+  g_free (r->ghosts);
+  if (r->batch)
+    face_batch_destroy (r->batch);
   for (i = 0; i < FTT_DIMENSION; i++)
     g_free (r->dv[i]);
   if (r->nu)
@@ -1458,7 +2132,10 @@ static void river_init (GfsRiver * r)
   gfs_domain_remove_derived_variable (domain, "Curvature");
   gfs_domain_remove_derived_variable (domain, "D2");
 
+  r->active = g_ptr_array_new ();
+
   r->time_order = 2;
+  r->batched = TRUE;
   r->dry = 1e-6;
   r->scheme = riemann_kinetic;
 
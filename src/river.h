@@ -50,11 +50,18 @@ GtsObjectClass * gfs_layers_class  (void);
 /* GfsRiver: Header */
 
 typedef struct _GfsRiver GfsRiver;
+typedef struct _GfsFaceBatch GfsFaceBatch;
 
 struct _GfsRiver {
   /*< private >*/
   GfsSimulation parent;
   gdouble * uL, * uR, * f, cfl;
+  gdouble * lcfl;
+  guint lmin, lmax, lbase, nlevels;
+  GPtrArray * active, ** leaves, ** ghosts;
+  GfsFaceBatch * batch;
+  GfsVariable ** dvbundle;
+  guint nbc, nfaces;
 
   /*< public >*/
   GfsVariable ** v, ** v1, * zb, * h, * qx, * qy;
@@ -71,6 +78,8 @@ struct _GfsRiver {
 		   gdouble * f);
   GfsFunction * nu, * dut, * k;
   gboolean variable_density;
+  gboolean local_dt;           /**< local timestepping for each level of refinement */
+  gboolean batched;            /**< batched face fluxes (single layer, constant density) */
 };
 
 #define GFS_RIVER(obj)            GTS_OBJECT_CAST (obj,\
@@ -34,6 +34,7 @@
 #include "tension.h"
 #include "map.h"
 #include "river.h"
+#include "particle.h"
 #include "version.h"
 
 /**
@@ -1096,10 +1097,10 @@ void gfs_simulation_init (GfsSimulation * sim)
     }
 }
 
-static void refine_cell_corner (FttCell * cell, GfsDomain * domain)
+static void add_corner_cell (FttCell * cell, GPtrArray * a)
 {
   if (FTT_CELL_IS_LEAF (cell) && ftt_refine_corner (cell))
-    ftt_cell_refine_single (cell, domain->cell_init, domain->cell_init_data);
+    g_ptr_array_add (a, cell);
 }
 
 static void check_face (FttCellFace * f, guint * nf)
@@ -1218,11 +1219,15 @@ void gfs_simulation_refine (GfsSimulation * sim)
   gts_container_foreach (GTS_CONTAINER (sim), (GtsFunc) refine_leaf_boxes, sim);
 
   depth = gfs_domain_depth (domain);
-  for (l = depth - 2; l >= 0; l--)
+  GPtrArray * a = g_ptr_array_new ();
+  for (l = depth - 2; l >= 0; l--) {
     gfs_domain_cell_traverse (domain,
 			      FTT_PRE_ORDER, FTT_TRAVERSE_LEVEL, l,
-			      (FttCellTraverseFunc) refine_cell_corner, 
-			      domain);
+			      (FttCellTraverseFunc) add_corner_cell, a);
+    ftt_cell_refine_array (a, domain->cell_init, domain->cell_init_data);
+    g_ptr_array_set_size (a, 0);
+  }
+  g_ptr_array_free (a, TRUE);
 
   gfs_domain_match (domain);
   gfs_domain_timer_stop (domain, "simulation_refine");
@@ -1421,6 +1426,10 @@ void gfs_simulation_union_write (GfsSimulation * sim,
     gts_graph_foreach_edge (g, (GtsFunc) count_edges, &nedge);
     gfs_all_reduce (domain, nedge, MPI_UNSIGNED, MPI_SUM);
 
+    /* the events are written by process zero only: it needs the
+       particles of the other processes */
+    GSList * particles = gfs_particles_gather (sim);
+
     if (domain->pid == 0) {
       fprintf (fp, "# Gerris Flow Solver %dD version %s (%s)\n",
 	       FTT_DIMENSION, GFS_VERSION, GFS_BUILD_VERSION);
@@ -1433,6 +1442,7 @@ void gfs_simulation_union_write (GfsSimulation * sim,
 	(* GTS_OBJECT (g)->klass->write) (GTS_OBJECT (g), fp);
       fputc ('\n', fp);
     }
+    gfs_particles_gather_free (particles);
 
     gint depth = domain->max_depth_write;
     guint i, nnode = 1;
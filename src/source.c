@@ -104,6 +104,7 @@ void gfs_domain_variable_centered_sources (GfsDomain * domain,
     gfs_domain_cell_traverse (domain, 
 			      FTT_PRE_ORDER, FTT_TRAVERSE_LEAFS, -1,
 			      (FttCellTraverseFunc) add_sources, &p);
+    gfs_vof_interface_invalidate (v);
   }
 }
 
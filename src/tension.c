@@ -492,26 +492,29 @@ static void variable_curvature_write (GtsObject * o, FILE * fp)
     fprintf (fp, " %s", v->kmax->name);
 }
 
+static void undefined_curvature (FttCell * cell, GfsVariable * v)
+{
+  GfsVariable * kmax = GFS_VARIABLE_CURVATURE (v)->kmax;
+
+  GFS_VALUE (cell, v) = GFS_NODATA;
+  if (kmax)
+    GFS_VALUE (cell, kmax) = GFS_NODATA;
+}
+
 static void height_curvature (FttCell * cell, GfsVariable * v)
 {
   GfsVariable * t = GFS_VARIABLE_CURVATURE (v)->f;
   GfsVariable * kmax = GFS_VARIABLE_CURVATURE (v)->kmax;
-  gdouble f = GFS_VALUE (cell, t);
 
-  if (GFS_IS_FULL (f)) {
-    GFS_VALUE (cell, v) = GFS_NODATA;
-    if (kmax)
-      GFS_VALUE (cell, kmax) = GFS_NODATA;
-  }
-  else {
-    if (kmax) {
-      gdouble k;
-      GFS_VALUE (cell, v) = gfs_height_curvature (cell, GFS_VARIABLE_TRACER_VOF (t), &k);
-      GFS_VALUE (cell, kmax) = k;
-    }
-    else
-      GFS_VALUE (cell, v) = gfs_height_curvature (cell, GFS_VARIABLE_TRACER_VOF (t), NULL);
+  if (!GFS_IS_INTERFACE_BAND (GFS_VALUE (cell, t)))
+    undefined_curvature (cell, v);
+  else if (kmax) {
+    gdouble k;
+    GFS_VALUE (cell, v) = gfs_height_curvature (cell, GFS_VARIABLE_TRACER_VOF (t), &k);
+    GFS_VALUE (cell, kmax) = k;
   }
+  else
+    GFS_VALUE (cell, v) = gfs_height_curvature (cell, GFS_VARIABLE_TRACER_VOF (t), NULL);
 }
 
 static void fit_curvature (FttCell * cell, GfsVariable * v)
@@ -519,7 +522,7 @@ static void fit_curvature (FttCell * cell, GfsVariable * v)
   GfsVariable * t = GFS_VARIABLE_CURVATURE (v)->f;
   gdouble f = GFS_VALUE (cell, t);
 
-  if (!GFS_IS_FULL (f) && !GFS_HAS_DATA (cell, v)) {
+  if (GFS_IS_INTERFACE_BAND (f) && !GFS_HAS_DATA (cell, v)) {
     GfsVariable * kmax = GFS_VARIABLE_CURVATURE (v)->kmax;
     if (kmax) {
       gdouble k;
@@ -611,9 +614,10 @@ static void variable_curvature_from_fraction (GfsEvent * event, GfsSimulation *
 {
   GfsDomain * domain = GFS_DOMAIN (sim);
   GfsVariable * kmax = GFS_VARIABLE_CURVATURE (event)->kmax;
+  GfsVariableTracerVOF * t = GFS_VARIABLE_TRACER_VOF (GFS_VARIABLE_CURVATURE (event)->f);
 
-  gfs_domain_cell_traverse (domain, FTT_PRE_ORDER, FTT_TRAVERSE_LEAFS, -1,
-			    (FttCellTraverseFunc) height_curvature, event);
+  gfs_domain_traverse_leaves (domain, (FttCellTraverseFunc) undefined_curvature, event);
+  gfs_vof_interface_traverse (t, (FttCellTraverseFunc) height_curvature, event);
   gfs_domain_cell_traverse (domain, FTT_POST_ORDER, FTT_TRAVERSE_NON_LEAFS, -1,
 			    (FttCellTraverseFunc) GFS_VARIABLE (event)->fine_coarse, event);
   gfs_domain_bc (domain, FTT_TRAVERSE_LEAFS, -1, GFS_VARIABLE (event));
@@ -624,8 +628,7 @@ static void variable_curvature_from_fraction (GfsEvent * event, GfsSimulation *
     variable_curvature_diffuse (kmax, GFS_VARIABLE_CURVATURE (event)->f, sim, 1);
   }
   variable_curvature_diffuse (GFS_VARIABLE (event), NULL, sim, 1);
-  gfs_domain_cell_traverse (domain, FTT_PRE_ORDER, FTT_TRAVERSE_LEAFS, -1,
-			    (FttCellTraverseFunc) fit_curvature, event);
+  gfs_vof_interface_traverse (t, (FttCellTraverseFunc) fit_curvature, event);
   gfs_domain_cell_traverse (domain, FTT_POST_ORDER, FTT_TRAVERSE_NON_LEAFS, -1,
 			    (FttCellTraverseFunc) GFS_VARIABLE (event)->fine_coarse, event);
   gfs_domain_bc (domain, FTT_TRAVERSE_LEAFS, -1, GFS_VARIABLE (event));
@@ -731,6 +734,9 @@ typedef struct {
   GfsVariable * max;
 } CurvatureData;
 
+/* stricter than GFS_IS_INTERFACE_BAND(): volume fractions outside
+   [0,1] are not interfacial, so that these cells are always part of
+   the band traversed by gfs_vof_interface_traverse() */
 static gboolean is_interfacial (FttCell * cell, gpointer data)
 {
   GfsVariable * f = data;
@@ -777,7 +783,8 @@ static void height_curvature_max (FttCell * cell, CurvatureData * p)
 {
   GfsVariableTracerVOFHeight * t = GFS_VARIABLE_TRACER_VOF_HEIGHT (p->k->f);
   gdouble kappa, kmax;
-  if (gfs_curvature_along_direction (cell, t, p->c, &kappa, &kmax)) {
+  if (is_interfacial (cell, p->k->f) &&
+      gfs_curvature_along_direction (cell, t, p->c, &kappa, &kmax)) {
     set_curvature (cell, kappa, kmax, p);
     propagate_curvature (cell, kappa, kmax, p);
   }
@@ -785,7 +792,7 @@ static void height_curvature_max (FttCell * cell, CurvatureData * p)
 
 static void remaining_curvatures (FttCell * cell, GfsVariable * v)
 {
-  if (!GFS_HAS_DATA (cell, v)) {
+  if (!GFS_HAS_DATA (cell, v) && is_interfacial (cell, GFS_VARIABLE_CURVATURE (v)->f)) {
     GfsVariableTracerVOFHeight * t = GFS_VARIABLE_TRACER_VOF_HEIGHT (GFS_VARIABLE_CURVATURE (v)->f);
     GfsVariable * kmax = GFS_VARIABLE_CURVATURE (v)->kmax;
     if (kmax) {
@@ -804,19 +811,16 @@ static gboolean variable_curvature_event (GfsEvent * event, GfsSimulation * sim)
       (event, sim)) {
     if (GFS_IS_VARIABLE_TRACER_VOF_HEIGHT (GFS_VARIABLE_CURVATURE (event)->f)) {
       GfsDomain * domain = GFS_DOMAIN (sim);
+      GfsVariableTracerVOF * t = GFS_VARIABLE_TRACER_VOF (GFS_VARIABLE_CURVATURE (event)->f);
       GfsVariable * kmax = GFS_VARIABLE_CURVATURE (event)->kmax;
       CurvatureData p;
       p.k = GFS_VARIABLE_CURVATURE (event);
       p.max = gfs_temporary_variable (domain);
       gfs_domain_traverse_leaves (domain, (FttCellTraverseFunc) set_undefined, &p);
       for (p.c = 0; p.c < FTT_DIMENSION; p.c++)
-	gfs_domain_cell_traverse_condition (domain, FTT_PRE_ORDER, FTT_TRAVERSE_LEAFS, -1,
-					    (FttCellTraverseFunc) height_curvature_max, &p,
-					    is_interfacial, GFS_VARIABLE_CURVATURE (event)->f);
+	gfs_vof_interface_traverse (t, (FttCellTraverseFunc) height_curvature_max, &p);
       gts_object_destroy (GTS_OBJECT (p.max));
-      gfs_domain_cell_traverse_condition (domain, FTT_PRE_ORDER, FTT_TRAVERSE_LEAFS, -1,
-      					  (FttCellTraverseFunc) remaining_curvatures, event,
-					  is_interfacial, GFS_VARIABLE_CURVATURE (event)->f);
+      gfs_vof_interface_traverse (t, (FttCellTraverseFunc) remaining_curvatures, event);
 
       gfs_domain_cell_traverse (domain, FTT_POST_ORDER, FTT_TRAVERSE_NON_LEAFS, -1,
 				(FttCellTraverseFunc) GFS_VARIABLE (event)->fine_coarse, event);
@@ -829,8 +833,7 @@ static gboolean variable_curvature_event (GfsEvent * event, GfsSimulation * sim)
       }
       variable_curvature_diffuse (GFS_VARIABLE (event), NULL, sim, 1);
 
-      gfs_domain_cell_traverse (domain, FTT_PRE_ORDER, FTT_TRAVERSE_LEAFS, -1,
-				(FttCellTraverseFunc) fit_curvature, event);
+      gfs_vof_interface_traverse (t, (FttCellTraverseFunc) fit_curvature, event);
       gfs_domain_cell_traverse (domain, FTT_POST_ORDER, FTT_TRAVERSE_NON_LEAFS, -1,
 				(FttCellTraverseFunc) GFS_VARIABLE (event)->fine_coarse, event);
       gfs_domain_bc (domain, FTT_TRAVERSE_LEAFS, -1, GFS_VARIABLE (event));
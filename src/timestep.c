@@ -473,11 +473,14 @@ void gfs_mac_projection (GfsDomain * domain,
   g_return_if_fail (p != NULL);
   g_return_if_fail (g != NULL);
 
-  gfs_domain_timer_start (domain, "mac_projection");
+  static GfsTimerCache cache = { 0, NULL };
+  GfsTimer * timer = gfs_domain_timer_cached (domain, "mac_projection", &cache);
+  gfs_timer_start (domain, timer);
 
   mac_projection (domain, par, dt, p, alpha, NULL, g, divergence_hook);
 
-  gfs_domain_timer_stop (domain, "mac_projection");
+  gfs_domain_timer_add_leaves (domain);
+  gfs_timer_stop (domain, timer);
 
   if (par->residual.infty > par->tolerance)
     g_warning ("MAC projection: max residual %g > %g", par->residual.infty, par->tolerance);
@@ -574,7 +577,9 @@ void gfs_approximate_projection (GfsDomain * domain,
   g_return_if_fail (p != NULL);
   g_return_if_fail (g != NULL);
 
-  gfs_domain_timer_start (domain, "approximate_projection");
+  static GfsTimerCache cache = { 0, NULL };
+  GfsTimer * timer = gfs_domain_timer_cached (domain, "approximate_projection", &cache);
+  gfs_timer_start (domain, timer);
   
   /* compute MAC velocities from centered velocities */
   gfs_domain_face_traverse (domain, FTT_XYZ,
@@ -589,7 +594,8 @@ void gfs_approximate_projection (GfsDomain * domain,
 
   gfs_correct_centered_velocities (domain, FTT_DIMENSION, g, dt);
 
-  gfs_domain_timer_stop (domain, "approximate_projection");
+  gfs_domain_timer_add_leaves (domain);
+  gfs_timer_stop (domain, timer);
 
   if (par->residual.infty > par->tolerance)
     g_warning ("approx projection: max residual %g > %g", par->residual.infty, par->tolerance);
@@ -688,7 +694,9 @@ void gfs_predicted_face_velocities (GfsDomain * domain,
   g_return_if_fail (domain != NULL);
   g_return_if_fail (par != NULL);
 
-  gfs_domain_timer_start (domain, "predicted_face_velocities");
+  static GfsTimerCache cache = { 0, NULL };
+  GfsTimer * timer = gfs_domain_timer_cached (domain, "predicted_face_velocities", &cache);
+  gfs_timer_start (domain, timer);
 
   gfs_domain_face_traverse (domain, d == 2 ? FTT_XY : FTT_XYZ,
 			    FTT_PRE_ORDER, FTT_TRAVERSE_LEAFS, -1,
@@ -713,7 +721,8 @@ void gfs_predicted_face_velocities (GfsDomain * domain,
 			      (FttFaceTraverseFunc) gfs_face_advected_normal_velocity, par);
   }
   face_values_free (par->u[0]);
-  gfs_domain_timer_stop (domain, "predicted_face_velocities");
+  gfs_domain_timer_add_leaves (domain);
+  gfs_timer_stop (domain, timer);
 }
 
 /**
@@ -977,7 +986,10 @@ void gfs_centered_velocity_advection_diffusion (GfsDomain * domain,
   g_return_if_fail (par != NULL);
   g_return_if_fail (gmac != NULL);
 
-  gfs_domain_timer_start (domain, "centered_velocity_advection_diffusion");
+  static GfsTimerCache cache = { 0, NULL };
+  GfsTimer * timer = gfs_domain_timer_cached (domain, "centered_velocity_advection_diffusion",
+					       &cache);
+  gfs_timer_start (domain, timer);
 
   par->use_centered_velocity = FALSE;
   v = gfs_domain_velocity (domain);
@@ -1003,7 +1015,8 @@ void gfs_centered_velocity_advection_diffusion (GfsDomain * domain,
     gfs_domain_bc (domain, FTT_TRAVERSE_LEAFS, -1, v[c]);
   face_values_free (par->v);
 
-  gfs_domain_timer_stop (domain, "centered_velocity_advection_diffusion");
+  gfs_domain_timer_add_leaves (domain);
+  gfs_timer_stop (domain, timer);
 }
 
 /**
@@ -1024,7 +1037,9 @@ void gfs_tracer_advection_diffusion (GfsDomain * domain,
   g_return_if_fail (domain != NULL);
   g_return_if_fail (par != NULL);
 
-  gfs_domain_timer_start (domain, "tracer_advection_diffusion");
+  static GfsTimerCache cache = { 0, NULL };
+  GfsTimer * timer = gfs_domain_timer_cached (domain, "tracer_advection_diffusion", &cache);
+  gfs_timer_start (domain, timer);
 
   if ((d = source_diffusion (par->v))) {
     GfsVariable * rhs;
@@ -1041,7 +1056,8 @@ void gfs_tracer_advection_diffusion (GfsDomain * domain,
     gfs_domain_bc (domain, FTT_TRAVERSE_LEAFS, -1, par->v);
   }
 
-  gfs_domain_timer_stop (domain, "tracer_advection_diffusion");
+  gfs_domain_timer_add_leaves (domain);
+  gfs_timer_stop (domain, timer);
 }
 
 /**
@@ -118,6 +118,75 @@ gdouble gfs_line_alpha (const FttVector * m, gdouble c)
   return alpha;
 }
 
+/**
+ * gfs_line_area_array:
+ * @m: an array of normals.
+ * @alpha: an array of line constants.
+ * @area: an array.
+ * @n: the size of the arrays.
+ *
+ * Fills @area with the areas returned by gfs_line_area() for each
+ * line (@m[i],@alpha[i]).
+ *
+ * The loop does not contain any branches (all the cases are computed
+ * and the relevant one is selected) and can be vectorised by the
+ * compiler. The results are identical to those of gfs_line_area().
+ */
+void gfs_line_area_array (const FttVector * m, const gdouble * alpha, gdouble * area, guint n)
+{
+  guint i;
+
+  g_return_if_fail (n == 0 || (m != NULL && alpha != NULL && area != NULL));
+
+  for (i = 0; i < n; i++) {
+    gdouble alpha1 = alpha[i] - (m[i].x < 0. ? m[i].x : 0.) - (m[i].y < 0. ? m[i].y : 0.);
+    gdouble nx = fabs (m[i].x), ny = fabs (m[i].y);
+    gdouble ax = alpha1 - nx, ay = alpha1 - ny;
+    gdouble v = alpha1*alpha1 - (ax > 0. ? ax*ax : 0.) - (ay > 0. ? ay*ay : 0.);
+    /* safe denominators (the corresponding cases are not selected) */
+    gdouble sx = nx > 0. ? nx : 1., sy = ny > 0. ? ny : 1.;
+    gdouble a0 = alpha1/sy, a1 = alpha1/sx, a2 = v/(2.*sx*sy);
+    gdouble a = nx == 0. ? a0 : ny == 0. ? a1 : a2;
+    a = CLAMP (a, 0., 1.);
+    area[i] = alpha1 <= 0. ? 0. : alpha1 >= nx + ny ? 1. : a;
+  }
+}
+
+/**
+ * gfs_line_alpha_array:
+ * @m: an array of normals.
+ * @c: an array of volume fractions.
+ * @alpha: an array.
+ * @n: the size of the arrays.
+ *
+ * Fills @alpha with the line constants returned by gfs_line_alpha()
+ * for each normal @m[i] and volume fraction @c[i].
+ *
+ * The loop does not contain any branches and can be vectorised by
+ * the compiler. The results are identical to those of
+ * gfs_line_alpha().
+ */
+void gfs_line_alpha_array (const FttVector * m, const gdouble * c, gdouble * alpha, guint n)
+{
+  guint i;
+
+  g_return_if_fail (n == 0 || (m != NULL && c != NULL && alpha != NULL));
+
+  for (i = 0; i < n; i++) {
+    gdouble m1 = MIN (fabs (m[i].x), fabs (m[i].y));
+    gdouble m2 = MAX (fabs (m[i].x), fabs (m[i].y));
+    gdouble v1 = m1/2., ci = c[i];
+    gdouble r = v1/(m2 > 0. ? m2 : 1.);
+    gdouble a0 = sqrt (MAX (0., 2.*ci*m1*m2));
+    gdouble a1 = ci*m2 + v1;
+    gdouble a2 = m1 + m2 - sqrt (MAX (0., 2.*m1*m2*(1. - ci)));
+    gdouble a = ci <= r ? a0 : ci <= 1. - r ? a1 : a2;
+    a += m[i].x < 0. ? m[i].x : 0.;
+    a += m[i].y < 0. ? m[i].y : 0.;
+    alpha[i] = a;
+  }
+}
+
 #define EPS 1e-4
 
 /**
@@ -334,21 +403,63 @@ gdouble gfs_plane_volume (const FttVector * m, gdouble alpha)
 }
 
 /**
- * gfs_plane_alpha:
- * @m: a #FttVector.
- * @c: a volume fraction.
+ * gfs_plane_volume_array:
+ * @m: an array of normals.
+ * @alpha: an array of plane constants.
+ * @volume: an array.
+ * @n: the size of the arrays.
  *
- * Returns: the value @alpha such that the volume of a cubic cell
- * lying under the plane defined by @m.@x = @alpha is equal to @c. 
+ * Fills @volume with the volumes returned by gfs_plane_volume() for
+ * each plane (@m[i],@alpha[i]).
+ *
+ * The loop does not contain any branches (all the cases are computed
+ * and the relevant one is selected) and can be vectorised by the
+ * compiler. The results are identical to those of gfs_plane_volume().
  */
-gdouble gfs_plane_alpha (const FttVector * m, gdouble c)
+void gfs_plane_volume_array (const FttVector * m, const gdouble * alpha, gdouble * volume, 
+			     guint n)
+{
+  guint i;
+
+  g_return_if_fail (n == 0 || (m != NULL && alpha != NULL && volume != NULL));
+
+  for (i = 0; i < n; i++) {
+    gdouble al = alpha[i] + MAX(0., -m[i].x) + MAX(0., -m[i].y) + MAX(0., -m[i].z);
+    gdouble sum = fabs(m[i].x) + fabs(m[i].y) + fabs(m[i].z);
+    /* safe denominators (the corresponding cases are not selected) */
+    gdouble s = sum > 0. ? sum : 1.;
+    gdouble n1 = fabs(m[i].x)/s;
+    gdouble n2 = fabs(m[i].y)/s;
+    gdouble n3 = fabs(m[i].z)/s;
+    gdouble al1 = MAX(0., MIN(1., al/s));
+    gdouble al0 = MIN(al1, 1. - al1);
+    gdouble c1 = MIN(n1, n2), c3 = MAX(n1, n2);
+    gdouble b1 = n3 < c1 ? n3 : c1;
+    gdouble b2 = n3 < c1 ? c1 : n3 > c3 ? c3 : n3;
+    gdouble b3 = n3 > c3 ? n3 : c3;
+    gdouble b12 = b1 + b2;
+    gdouble bm = MIN(b12, b3);
+    gdouble pr = MAX(6.*b1*b2*b3, 1e-50);
+    gdouble b23 = b2*b3 > 0. ? b2*b3 : 1.;
+    gdouble b3s = b3 > 0. ? b3 : 1.;
+    gdouble t0 = al0*al0*al0/pr;
+    gdouble t1 = 0.5*al0*(al0 - b1)/b23 +  b1*b1*b1/pr;
+    gdouble t2 = (al0*al0*(3.*b12 - al0) + b1*b1*(b1 - 3.*al0) + b2*b2*(b2 - 3.*al0))/pr;
+    gdouble t3 = (al0 - 0.5*bm)/b3s;
+    gdouble t4 = (al0*al0*(3. - 2.*al0) + b1*b1*(b1 - 3.*al0) + 
+		  b2*b2*(b2 - 3.*al0) + b3*b3*(b3 - 3.*al0))/pr;
+    gdouble t = al0 < b1 ? t0 : al0 < b2 ? t1 : al0 < bm ? t2 : b12 < b3 ? t3 : t4;
+    gdouble v = al1 <= 0.5 ? t : 1. - t;
+    v = CLAMP (v, 0., 1.);
+    volume[i] = al <= 0. ? 0. : al >= sum ? 1. : v;
+  }
+}
+
+static inline gdouble plane_alpha (const FttVector * m, gdouble c)
 {
   gdouble alpha;
   FttVector n;
 
-  g_return_val_if_fail (m != NULL, 0.);
-  g_return_val_if_fail (c >= 0. && c <= 1., 0.);
-
   n.x = fabs (m->x); n.y = fabs (m->y); n.z = fabs (m->z);
 
   gdouble m1, m2, m3;
@@ -414,6 +525,47 @@ gdouble gfs_plane_alpha (const FttVector * m, gdouble c)
   return alpha;
 }
 
+/**
+ * gfs_plane_alpha:
+ * @m: a #FttVector.
+ * @c: a volume fraction.
+ *
+ * Returns: the value @alpha such that the volume of a cubic cell
+ * lying under the plane defined by @m.@x = @alpha is equal to @c. 
+ */
+gdouble gfs_plane_alpha (const FttVector * m, gdouble c)
+{
+  g_return_val_if_fail (m != NULL, 0.);
+  g_return_val_if_fail (c >= 0. && c <= 1., 0.);
+
+  return plane_alpha (m, c);
+}
+
+/**
+ * gfs_plane_alpha_array:
+ * @m: an array of normals.
+ * @c: an array of volume fractions.
+ * @alpha: an array.
+ * @n: the size of the arrays.
+ *
+ * Fills @alpha with the plane constants returned by gfs_plane_alpha()
+ * for each normal @m[i] and volume fraction @c[i].
+ *
+ * Unlike gfs_plane_volume_array(), the different cases are not
+ * computed unconditionally since several of them require
+ * transcendental functions, but the loop avoids the overhead of
+ * calling gfs_plane_alpha() for each plane.
+ */
+void gfs_plane_alpha_array (const FttVector * m, const gdouble * c, gdouble * alpha, guint n)
+{
+  guint i;
+
+  g_return_if_fail (n == 0 || (m != NULL && c != NULL && alpha != NULL));
+
+  for (i = 0; i < n; i++)
+    alpha[i] = plane_alpha (&m[i], c[i]);
+}
+
 /**
  * gfs_plane_center:
  * @m: normal to the plane.
@@ -900,13 +1052,24 @@ static void myc_normal (FttCell * cell, GfsVariable * v, FttVector * n)
 #endif
 }
 
-static void vof_plane (FttCell * cell, GfsVariable * v)
+typedef struct {
+  GfsVariableTracerVOF * t;
+  void (* normal) (FttCell *, GfsVariable *, FttVector *);
+  GPtrArray * cells;
+  GArray * m, * f, * alpha;
+  guint nleafs;
+} VofPlanes;
+
+static void vof_plane (FttCell * cell, VofPlanes * p)
 {
   if (FTT_CELL_IS_LEAF (cell)) {
-    GfsVariableTracerVOF * t = GFS_VARIABLE_TRACER_VOF (v);
-    gdouble f = GFS_VALUE (cell, v);
+    GfsVariableTracerVOF * t = p->t;
+    gdouble f = GFS_VALUE (cell, GFS_VARIABLE (t));
     FttComponent c;
 
+    p->nleafs++;
+    if (GFS_IS_INTERFACE_BAND (f))
+      g_ptr_array_add (t->band, cell);
     THRESHOLD (f);
     if (GFS_IS_FULL (f)) {
       for (c = 1; c < FTT_DIMENSION; c++)
@@ -918,7 +1081,7 @@ static void vof_plane (FttCell * cell, GfsVariable * v)
       FttVector m;
       gdouble n = 0.;
 
-      myc_normal (cell, v, &m);
+      (* p->normal) (cell, GFS_VARIABLE (t), &m);
       for (c = 0; c < FTT_DIMENSION; c++)
 	n += fabs ((&m.x)[c]);
       if (n > 0.)
@@ -928,11 +1091,68 @@ static void vof_plane (FttCell * cell, GfsVariable * v)
 	m.x = 1.;
       for (c = 0; c < FTT_DIMENSION; c++)
 	GFS_VALUE (cell, t->m[c]) = (&m.x)[c];
-      GFS_VALUE (cell, t->alpha) = gfs_plane_alpha (&m, f);
+      /* alpha is computed for all the interfacial cells of the level
+	 by vof_planes_alpha() */
+      g_ptr_array_add (p->cells, cell);
+      g_array_append_val (p->m, m);
+      g_array_append_val (p->f, f);
     }
   }
 }
 
+static void vof_planes_alpha (VofPlanes * p)
+{
+  guint i, n = p->cells->len;
+
+  g_array_set_size (p->alpha, n);
+  gfs_plane_alpha_array ((FttVector *) p->m->data, (gdouble *) p->f->data,
+			 (gdouble *) p->alpha->data, n);
+  for (i = 0; i < n; i++)
+    GFS_VALUE ((FttCell *) p->cells->pdata[i], p->t->alpha) = 
+      g_array_index (p->alpha, gdouble, i);
+  g_ptr_array_set_size (p->cells, 0);
+  g_array_set_size (p->m, 0);
+  g_array_set_size (p->f, 0);
+}
+
+/* Updates the normals and alpha of @t, level by level, using
+   @normal to compute the normal of interfacial cells */
+static void vof_planes_update (GfsDomain * domain,
+			       GfsVariableTracerVOF * t,
+			       void (* normal) (FttCell *, GfsVariable *, FttVector *))
+{
+  VofPlanes p;
+  p.t = t;
+  p.normal = normal;
+  p.cells = g_ptr_array_new ();
+  p.m = g_array_new (FALSE, FALSE, sizeof (FttVector));
+  p.f = g_array_new (FALSE, FALSE, sizeof (gdouble));
+  p.alpha = g_array_new (FALSE, FALSE, sizeof (gdouble));
+  p.nleafs = 0;
+  g_ptr_array_set_size (t->band, 0);
+
+  guint l, depth = gfs_domain_depth (domain);
+  FttComponent c;
+  for (l = 0; l <= depth; l++) {
+    gfs_domain_cell_traverse (domain, FTT_PRE_ORDER, FTT_TRAVERSE_LEVEL, l,
+			      (FttCellTraverseFunc) vof_plane, &p);
+    vof_planes_alpha (&p);
+    for (c = 0; c < FTT_DIMENSION; c++)
+      gfs_domain_bc (domain, FTT_TRAVERSE_LEVEL, l, t->m[c]);
+    gfs_domain_bc (domain, FTT_TRAVERSE_LEVEL, l, t->alpha);
+  }
+
+  g_ptr_array_free (p.cells, TRUE);
+  g_array_free (p.m, TRUE);
+  g_array_free (p.f, TRUE);
+  g_array_free (p.alpha, TRUE);
+
+  t->band_topology = ftt_topology_version ();
+  t->band_writes = t->writes;
+  gfs_debug ("%s: %d interfacial cells out of %d leaf cells", GFS_VARIABLE (t)->name,
+	     t->band->len, p.nleafs);
+}
+
 static void no_coarse_fine (FttCell * cell,  GfsVariable * v) {}
 
 static void allocate_normal_alpha (GfsVariableTracerVOF * t)
@@ -973,15 +1193,7 @@ static void variable_tracer_vof_update (GfsVariable * v, GfsDomain * domain)
   }
     
   /* update normals and alpha */
-  guint l, depth = gfs_domain_depth (domain);
-  FttComponent c;
-  for (l = 0; l <= depth; l++) {
-    gfs_domain_cell_traverse (domain, FTT_PRE_ORDER, FTT_TRAVERSE_LEVEL, l,
-			      (FttCellTraverseFunc) vof_plane, v);
-    for (c = 0; c < FTT_DIMENSION; c++)
-      gfs_domain_bc (domain, FTT_TRAVERSE_LEVEL, l, t->m[c]);
-    gfs_domain_bc (domain, FTT_TRAVERSE_LEVEL, l, t->alpha);
-  }
+  vof_planes_update (domain, t, myc_normal);
 }
 
 static gboolean variable_tracer_vof_event (GfsEvent * event, 
@@ -1007,6 +1219,7 @@ static void variable_tracer_vof_destroy (GtsObject * o)
     gts_object_destroy (GTS_OBJECT (v->alpha));
   }
   gts_object_destroy (GTS_OBJECT (v->concentrations));
+  g_ptr_array_free (v->band, TRUE);
 
   (* GTS_OBJECT_CLASS (gfs_variable_tracer_vof_class ())->parent_class->destroy) (o);
 }
@@ -1063,23 +1276,32 @@ static void vof_coarse_fine (FttCell * parent, GfsVariable * v)
   else {
     /* interfacial cell */
     gdouble alpha = GFS_VALUE (parent, t->alpha);
-    FttVector m;
+    gdouble alpha1[FTT_CELLS], volume[FTT_CELLS];
+    FttVector m[FTT_CELLS];
     
     for (i = 0; i < FTT_DIMENSION; i++)
-      (&m.x)[i] = GFS_VALUE (parent, t->m[i]);
-    for (i = 0; i < FTT_CELLS; i++)
+      (&m[0].x)[i] = GFS_VALUE (parent, t->m[i]);
+    for (i = 0; i < FTT_CELLS; i++) {
+      m[i] = m[0];
+      alpha1[i] = 0.;
       if (child.c[i]) {
 	/* fixme: this is not mass conserving */
-	gdouble alpha1 = alpha;
+	gdouble a = alpha;
 	FttComponent c;
 	FttVector p;
 	ftt_cell_relative_pos (child.c[i], &p);
 	for (c = 0; c < FTT_DIMENSION; c++) {
-	  alpha1 -= (&m.x)[c]*(0.25 + (&p.x)[c]);
-	  GFS_VALUE (child.c[i], t->m[c]) = (&m.x)[c];
+	  a -= (&m[0].x)[c]*(0.25 + (&p.x)[c]);
+	  GFS_VALUE (child.c[i], t->m[c]) = (&m[0].x)[c];
 	}
-	GFS_VALUE (child.c[i], v) = gfs_plane_volume (&m, 2.*alpha1);
-	GFS_VALUE (child.c[i], t->alpha) = 2.*alpha1;
+	alpha1[i] = 2.*a;
+      }
+    }
+    gfs_plane_volume_array (m, alpha1, volume, FTT_CELLS);
+    for (i = 0; i < FTT_CELLS; i++)
+      if (child.c[i]) {
+	GFS_VALUE (child.c[i], v) = volume[i];
+	GFS_VALUE (child.c[i], t->alpha) = alpha1[i];
       }
 
     /* firs-order interpolation for concentrations in interfacial cells */
@@ -1170,6 +1392,9 @@ static void variable_tracer_vof_init (GfsVariable * v)
   GFS_VARIABLE_TRACER (v)->advection.cfl = 0.5;
   GFS_VARIABLE_TRACER_VOF (v)->concentrations = 
     GTS_SLIST_CONTAINER (gts_container_new (GTS_CONTAINER_CLASS (gts_slist_container_class ())));
+  GFS_VARIABLE_TRACER_VOF (v)->band = g_ptr_array_new ();
+  /* no band until the first reconstruction */
+  GFS_VARIABLE_TRACER_VOF (v)->writes = 1;
 }
 
 GfsVariableTracerVOFClass * gfs_variable_tracer_vof_class (void)
@@ -1192,6 +1417,83 @@ GfsVariableTracerVOFClass * gfs_variable_tracer_vof_class (void)
   return klass;
 }
 
+static gboolean is_band (FttCell * cell, gpointer data)
+{
+  return GFS_IS_INTERFACE_BAND (GFS_VALUE (cell, GFS_VARIABLE (data)));
+}
+
+#ifdef DEBUG
+static void count_band (FttCell * cell, guint * n)
+{
+  (*n)++;
+}
+#endif /* DEBUG */
+
+/**
+ * gfs_vof_interface_traverse:
+ * @t: a #GfsVariableTracerVOF.
+ * @func: the function to call for each visited #FttCell.
+ * @data: user data to pass to @func.
+ *
+ * Calls @func for each leaf cell of the domain of @t for which the
+ * volume fraction is neither zero nor one.
+ *
+ * The list of interfacial cells built by the last update of @t is
+ * used if the topology version of the mesh (see
+ * ftt_topology_version()) and the write count of @t (see
+ * gfs_vof_interface_invalidate()) have not changed since, otherwise
+ * all the leaf cells are traversed. In both cases the current volume
+ * fraction of each cell is checked.
+ */
+void gfs_vof_interface_traverse (GfsVariableTracerVOF * t,
+				 FttCellTraverseFunc func,
+				 gpointer data)
+{
+  g_return_if_fail (t != NULL);
+  g_return_if_fail (func != NULL);
+
+  if (t->band_topology == ftt_topology_version () && t->band_writes == t->writes) {
+    guint i;
+#ifdef DEBUG
+    /* the volume fraction has been modified without calling
+       gfs_vof_interface_invalidate() if this fails */
+    guint n = 0, nall = 0;
+    for (i = 0; i < t->band->len; i++)
+      if (is_band (t->band->pdata[i], t))
+	n++;
+    gfs_domain_cell_traverse_condition (GFS_VARIABLE (t)->domain, 
+					FTT_PRE_ORDER, FTT_TRAVERSE_LEAFS, -1,
+					(FttCellTraverseFunc) count_band, &nall, is_band, t);
+    g_assert (n == nall);
+#endif /* DEBUG */
+    for (i = 0; i < t->band->len; i++)
+      if (is_band (t->band->pdata[i], t))
+	(* func) (t->band->pdata[i], data);
+  }
+  else
+    gfs_domain_cell_traverse_condition (GFS_VARIABLE (t)->domain, 
+					FTT_PRE_ORDER, FTT_TRAVERSE_LEAFS, -1,
+					func, data, is_band, t);
+}
+
+/**
+ * gfs_vof_interface_invalidate:
+ * @v: a #GfsVariable.
+ *
+ * If @v is a #GfsVariableTracerVOF, increments its write count, which
+ * discards its list of interfacial cells until the next update. This
+ * must be called by any code modifying the values of @v outside of
+ * its update (i.e. of the VOF reconstruction). Changes of the mesh are
+ * detected using ftt_topology_version() and do not need this call.
+ */
+void gfs_vof_interface_invalidate (GfsVariable * v)
+{
+  g_return_if_fail (v != NULL);
+
+  if (GFS_IS_VARIABLE_TRACER_VOF (v))
+    GFS_VARIABLE_TRACER_VOF (v)->writes++;
+}
+
 typedef struct {
   GfsAdvectionParams * par, vpar;
   GfsVariable * u, * du[FTT_DIMENSION - 1], * vof;
@@ -1670,7 +1972,9 @@ void gfs_tracer_vof_advection (GfsDomain * domain,
   g_return_if_fail (GFS_IS_VARIABLE_TRACER_VOF (par->v));
   g_return_if_fail (par->cfl <= 0.5);
 
-  gfs_domain_timer_start (domain, "tracer_vof_advection");
+  static GfsTimerCache cache = { 0, NULL };
+  GfsTimer * timer = gfs_domain_timer_cached (domain, "tracer_vof_advection", &cache);
+  gfs_timer_start (domain, timer);
 
   p.par = par;
   p.vof = par->v;
@@ -1765,7 +2069,8 @@ void gfs_tracer_vof_advection (GfsDomain * domain,
   for (d = 0; d < FTT_DIMENSION - 1; d++)
     gts_object_destroy (GTS_OBJECT (p.du[d]));
 
-  gfs_domain_timer_stop (domain, "tracer_vof_advection");
+  gfs_domain_timer_add_leaves (domain);
+  gfs_timer_stop (domain, timer);
 }
 
 static gdouble face_value (FttCell * cell, FttDirection d, GfsVariable * v)
@@ -3432,37 +3737,35 @@ static gboolean height_normal (FttCell * cell, GfsVariable * v, FttVector * m)
   return slope < G_MAXDOUBLE;
 }
 
-static void vof_height_plane (FttCell * cell, GfsVariable * v)
+static void height_or_myc_normal (FttCell * cell, GfsVariable * v, FttVector * m)
 {
-  if (FTT_CELL_IS_LEAF (cell)) {
-    GfsVariableTracerVOF * t = GFS_VARIABLE_TRACER_VOF (v);
-    gdouble f = GFS_VALUE (cell, v);
-    FttComponent c;
+  if (!height_normal (cell, v, m))
+    myc_normal (cell, v, m);
+}
 
-    THRESHOLD (f);
-    if (GFS_IS_FULL (f)) {
-      for (c = 1; c < FTT_DIMENSION; c++)
-	GFS_VALUE (cell, t->m[c]) = 0.;
-      GFS_VALUE (cell, t->m[0]) = 1.;
-      GFS_VALUE (cell, t->alpha) = f;
-    }
-    else {
-      FttVector m;
-      gdouble n = 0.;
+typedef struct {
+  GfsVariableTracerVOFHeight * h;
+  GPtrArray * cells;
+} HeightCells;
 
-      if (!height_normal (cell, v, &m))
-	myc_normal (cell, v, &m);
-      for (c = 0; c < FTT_DIMENSION; c++)
-	n += fabs ((&m.x)[c]);
-      if (n > 0.)
-	for (c = 0; c < FTT_DIMENSION; c++)
-	  (&m.x)[c] /= n;
-      else /* fixme: this is a small fragment */
-	m.x = 1.;
-      for (c = 0; c < FTT_DIMENSION; c++)
-	GFS_VALUE (cell, t->m[c]) = (&m.x)[c];
-      GFS_VALUE (cell, t->alpha) = gfs_plane_alpha (&m, f);
-    }
+/* Resets the heights of @cell in all directions and collects the
+   cells which a pre-order traversal with is_interfacial() as
+   condition would visit */
+static void undefined_heights (FttCell * cell, HeightCells * p)
+{
+  GfsVariable * f = GFS_VARIABLE (p->h);
+  FttComponent c;
+
+  for (c = 0; c < FTT_DIMENSION; c++) {
+    GFS_VALUE (cell, p->h->hb[c]) = GFS_NODATA;
+    GFS_VALUE (cell, p->h->ht[c]) = GFS_NODATA;
+  }
+  if (is_interfacial (cell, f)) {
+    FttCell * parent = ftt_cell_parent (cell);
+    while (parent && is_interfacial (parent, f))
+      parent = ftt_cell_parent (parent);
+    if (parent == NULL)
+      g_ptr_array_add (p->cells, cell);
   }
 }
 
@@ -3482,14 +3785,21 @@ static void variable_tracer_vof_height_update (GfsVariable * v, GfsDomain * doma
   GfsVariableTracerVOFHeight * h = GFS_VARIABLE_TRACER_VOF_HEIGHT (v);
   HFState hf;
   hf.f = v;
+  /* The heights are reset everywhere in a single traversal, which
+     also collects the interfacial cells of all levels. Heights are
+     computed only on these cells and propagated to at most DMAX - 1
+     of their neighbours, so that the passes below visit only them. */
+  HeightCells p;
+  p.h = h;
+  p.cells = g_ptr_array_new ();
+  gfs_domain_cell_traverse (domain, FTT_PRE_ORDER, FTT_TRAVERSE_ALL, -1,
+			    (FttCellTraverseFunc) undefined_heights, &p);
+  guint i;
   for (hf.c = 0; hf.c < FTT_DIMENSION; hf.c++) {
     hf.hb = h->hb[hf.c];
     hf.ht = h->ht[hf.c];
-    gfs_domain_cell_traverse (domain, FTT_PRE_ORDER, FTT_TRAVERSE_ALL, -1,
-			      (FttCellTraverseFunc) undefined_height, &hf);
-    gfs_domain_cell_traverse_condition (domain, FTT_PRE_ORDER, FTT_TRAVERSE_ALL, -1,
-					(FttCellTraverseFunc) height, &hf,
-					is_interfacial, hf.f);
+    for (i = 0; i < p.cells->len; i++)
+      height (p.cells->pdata[i], &hf);
     
     gfs_domain_bc (domain, FTT_TRAVERSE_ALL, -1, hf.hb);
     gfs_domain_bc (domain, FTT_TRAVERSE_ALL, -1, hf.ht);
@@ -3501,21 +3811,14 @@ static void variable_tracer_vof_height_update (GfsVariable * v, GfsDomain * doma
     /* apply contact angle bcs */
     gts_container_foreach (GTS_CONTAINER (domain), (GtsFunc) box_contact_bc, &hf);
 
-    gfs_domain_cell_traverse (domain, FTT_PRE_ORDER, FTT_TRAVERSE_ALL, -1,
-			      (FttCellTraverseFunc) remaining_boundary_height_undefined, &hf);
+    /* only interfacial cells can be left with a BOUNDARY_HIT height */
+    for (i = 0; i < p.cells->len; i++)
+      remaining_boundary_height_undefined (p.cells->pdata[i], &hf);
   }
+  g_ptr_array_free (p.cells, TRUE);
 
   /* update normals and alpha */
-  GfsVariableTracerVOF * t = GFS_VARIABLE_TRACER_VOF (v);
-  guint l, depth = gfs_domain_depth (domain);
-  FttComponent c;
-  for (l = 0; l <= depth; l++) {
-    gfs_domain_cell_traverse (domain, FTT_PRE_ORDER, FTT_TRAVERSE_LEVEL, l,
-			      (FttCellTraverseFunc) vof_height_plane, v);
-    for (c = 0; c < FTT_DIMENSION; c++)
-      gfs_domain_bc (domain, FTT_TRAVERSE_LEVEL, l, t->m[c]);
-    gfs_domain_bc (domain, FTT_TRAVERSE_LEVEL, l, t->alpha);
-  }
+  vof_planes_update (domain, GFS_VARIABLE_TRACER_VOF (v), height_or_myc_normal);
 }
 
 static void variable_tracer_vof_height_destroy (GtsObject * o)
@@ -28,6 +28,8 @@ extern "C" {
 #include "variable.h"
 
 #define GFS_IS_FULL(f)             ((f) == 0. || (f) == 1.)
+/* the cells of the interface band (see gfs_vof_interface_traverse()) */
+#define GFS_IS_INTERFACE_BAND(f)   (!GFS_IS_FULL (f))
 
 gdouble gfs_line_area              (const FttVector * m, 
 				    gdouble alpha);
@@ -40,16 +42,34 @@ gdouble gfs_line_area_center       (const FttVector * m,
 				    FttVector * p);
 gdouble gfs_line_alpha             (const FttVector * m, 
 				    gdouble c);
+void    gfs_line_area_array        (const FttVector * m, 
+				    const gdouble * alpha,
+				    gdouble * area,
+				    guint n);
+void    gfs_line_alpha_array       (const FttVector * m, 
+				    const gdouble * c,
+				    gdouble * alpha,
+				    guint n);
 #if FTT_2D
 #  define gfs_plane_volume         gfs_line_area
 #  define gfs_plane_alpha          gfs_line_alpha
 #  define gfs_plane_center         gfs_line_center
 #  define gfs_plane_area_center     gfs_line_area_center
+#  define gfs_plane_volume_array   gfs_line_area_array
+#  define gfs_plane_alpha_array    gfs_line_alpha_array
 #else /* 3D */
 gdouble gfs_plane_volume           (const FttVector * m, 
 				    gdouble alpha);
 gdouble gfs_plane_alpha            (const FttVector * m, 
 				    gdouble c);
+void    gfs_plane_volume_array     (const FttVector * m, 
+				    const gdouble * alpha,
+				    gdouble * volume,
+				    guint n);
+void    gfs_plane_alpha_array      (const FttVector * m, 
+				    const gdouble * c,
+				    gdouble * alpha,
+				    guint n);
 void    gfs_plane_center           (const FttVector * m, 
 				    gdouble alpha, 
 				    gdouble a,
@@ -72,6 +92,12 @@ struct _GfsVariableTracerVOF {
   GfsVariableTracer parent;
   /* a list of GfsVariableVOFConcentration associated with this VOF tracer */
   GtsSListContainer * concentrations;
+  /* the interfacial leaf cells found by the last reconstruction, for
+     the topology version band_topology and the write count band_writes */
+  GPtrArray * band;
+  guint band_topology, band_writes;
+  /* number of calls to gfs_vof_interface_invalidate() */
+  guint writes;
 
   /*< public >*/
   GfsVariable * m[FTT_DIMENSION], * alpha;
@@ -95,6 +121,10 @@ struct _GfsVariableTracerVOFClass {
 						   gfs_variable_tracer_vof_class ()))
 
 GfsVariableTracerVOFClass * gfs_variable_tracer_vof_class  (void);
+void                        gfs_vof_interface_traverse     (GfsVariableTracerVOF * t,
+							    FttCellTraverseFunc func,
+							    gpointer data);
+void                        gfs_vof_interface_invalidate   (GfsVariable * v);
 
 /* GfsVariableVOFConcentration: header */
 
@@ -57,11 +57,16 @@ static gdouble cell_E (FttCell * cell, FttCellFace * face, GfsDomain * domain)
   GfsVariable *** F = wave->F;
   guint ik, ith;
   gdouble E = 0., sigma = 2.*M_PI*GFS_WAVE_F0, sgamma = (GFS_WAVE_GAMMA - 1./GFS_WAVE_GAMMA)/2.;
+  const gdouble * S = wave->spectrum >= 0 ? &GFS_VALUEI (cell, wave->spectrum) : NULL;
   for (ik = 0; ik < wave->nk; ik++) {
     gdouble df = sigma*sgamma;
     gdouble dE = 0.;
-    for (ith = 0; ith < wave->ntheta; ith++)
-      dE += GFS_VALUE (cell, F[ik][ith]);
+    if (S)
+      for (ith = 0; ith < wave->ntheta; ith++)
+	dE += S[ik*wave->ntheta + ith];
+    else
+      for (ith = 0; ith < wave->ntheta; ith++)
+	dE += GFS_VALUE (cell, F[ik][ith]);
     E += dE*df;
     sigma *= GFS_WAVE_GAMMA;
   }
@@ -162,6 +167,14 @@ static void gse_alleviation_diffusion (GfsDomain * domain, GfsVariable * F,
   gfs_domain_timer_stop (domain, "gse_alleviation");
 }
 
+static void restrict_spectrum (FttCell * cell, GfsVariable ** F)
+{
+  GfsWave * wave = GFS_WAVE (F[0]->domain);
+  guint ith;
+  for (ith = 0; ith < wave->ntheta; ith++)
+    (* F[ith]->fine_coarse) (cell, F[ith]);
+}
+
 static void redo_some_events (GfsEvent * event, GfsSimulation * sim)
 {
   if (GFS_IS_ADAPT (event) || GFS_IS_INIT (event))
@@ -182,6 +195,8 @@ static void wave_run (GfsSimulation * sim)
   gfs_simulation_refine (sim);
   gfs_simulation_init (sim);
 
+  gboolean solids = (sim->solids->items != NULL);
+
   while (sim->time.t < sim->time.end &&
 	 sim->time.i < sim->time.iend) {
     gdouble tstart = gfs_clock_elapsed (domain->timer);
@@ -197,7 +212,18 @@ static void wave_run (GfsSimulation * sim)
     gdouble g = sim->physical_params.g/sim->physical_params.L;
     gdouble tnext = sim->tnext;
     
-    /* spatial advection */
+    /* spatial advection: each spectral component is advected by a
+       separate call to gfs_tracer_advection_diffusion() with its own
+       (uniform) group velocity. The Godunov scheme stores the
+       predicted face values and normal velocities of the component
+       being advected in the single face state vector of each cell
+       (GfsFaceStateVector), so that the components can neither share
+       a traversal nor be advected concurrently: only the boundary
+       conditions and restrictions are batched. The items of the
+       "wave_advection" timer are the advected (cell, component) pairs
+       (see test/wave). */
+    gdouble ncells = gfs_domain_size (domain, FTT_TRAVERSE_LEAFS, -1);
+    gfs_domain_timer_start (domain, "wave_advection");
     guint ik, ith;
     for (ik = 0; ik < wave->nk; ik++) {
       FttVector cg;
@@ -229,22 +255,31 @@ static void wave_run (GfsSimulation * sim)
 				    (FttFaceTraverseFunc) set_group_velocity, &cg);
 	  GfsVariable * t = GFS_WAVE (sim)->F[ik][ith];
 	  sim->advection_params.v = t;
-	  gfs_domain_traverse_leaves (domain, (FttCellTraverseFunc) solid_flux, &par);
+	  /* the group velocity is uniform: without solids the solid
+	     fluxes (and the merged update) vanish */
+	  if (solids)
+	    gfs_domain_traverse_leaves (domain, (FttCellTraverseFunc) solid_flux, &par);
 	  gfs_tracer_advection_diffusion (domain, &sim->advection_params, NULL);
-	  sim->advection_params.fv = par.fv;
-	  gfs_domain_traverse_merged (domain, (GfsMergedTraverseFunc) gfs_advection_update, 
-	  			      &sim->advection_params);
+	  if (solids) {
+	    sim->advection_params.fv = par.fv;
+	    gfs_domain_traverse_merged (domain, (GfsMergedTraverseFunc) gfs_advection_update, 
+					&sim->advection_params);
+	  }
 	  if (wave->alpha_s > 0.)
 	    gse_alleviation_diffusion (domain, t, &cg, sim->advection_params.dt);
-	  gfs_domain_bc (domain, FTT_TRAVERSE_LEAFS, -1, t);
-	  gfs_domain_cell_traverse (domain,
-				    FTT_POST_ORDER, FTT_TRAVERSE_NON_LEAFS, -1,
-				    (FttCellTraverseFunc) t->fine_coarse, t);
 	}
+	/* the directions of frequency ik are independent: their
+	   boundary conditions and restrictions are applied together */
+	gfs_domain_bc_bundle (domain, FTT_TRAVERSE_LEAFS, -1, wave->F[ik], wave->ntheta);
+	gfs_domain_cell_traverse (domain,
+				  FTT_POST_ORDER, FTT_TRAVERSE_NON_LEAFS, -1,
+				  (FttCellTraverseFunc) restrict_spectrum, wave->F[ik]);
+	gfs_domain_timer_add_items (domain, ncells*wave->ntheta);
 	gts_container_foreach (GTS_CONTAINER (sim->events), (GtsFunc) redo_some_events, sim);
 	gfs_simulation_adapt (sim);
       }
     }
+    gfs_domain_timer_stop (domain, "wave_advection");
 
     sim->advection_params.dt = dt;
 
@@ -304,6 +339,14 @@ static void wave_read (GtsObject ** o, GtsFile * fp)
       g_free (name);
       g_free (description);
     }
+
+  /* the source terms and diagnostics access the spectrum of a cell as
+     a single array when possible */
+  wave->spectrum = wave->F[0][0]->i;
+  for (ik = 0; ik < wave->nk; ik++)
+    for (ith = 0; ith < wave->ntheta; ith++)
+      if ((gint) wave->F[ik][ith]->i != wave->spectrum + ik*wave->ntheta + ith)
+	wave->spectrum = -1;
 }
 
 static void wave_write (GtsObject * o, FILE * fp)
@@ -348,6 +391,7 @@ static void wave_init (GfsWave * wave)
   wave->nk = 25;
   wave->ntheta = 24;
   wave->alpha_s = 0.;
+  wave->spectrum = -1;
   /* default for g is acceleration of gravity on Earth with kilometres as
      spatial units, hours as time units and Hz as frequency units */
   GFS_SIMULATION (wave)->physical_params.g = 9.81/1000.*3600.;
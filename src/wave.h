@@ -38,6 +38,7 @@ struct _GfsWave {
   GfsSimulation parent;
   guint ik, ith;
   void (* source) (GfsWave * wave);
+  gint spectrum; /* index of F[0][0] if the spectrum is contiguous, -1 otherwise */
 
   /*< public >*/
   guint nk, ntheta;
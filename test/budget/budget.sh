@@ -0,0 +1,43 @@
+# maxcells: the initial mesh and the criterion both ask for more cells
+# than the budget
+max="-DNAME=max -DLEVEL=5 -DCMAX=1e-4 -DMINCELLS=0 -DMAXCELLS=3000"
+# mincells: the criterion asks for fewer cells than the budget
+min="-DNAME=min -DLEVEL=3 -DCMAX=10 -DMINCELLS=3000 -DMAXCELLS=2147483647"
+
+if test x$donotrun != xtrue; then
+    for args in "$max" "$min"; do
+	if gerris2D $args -DNP=1 $1; then :
+	else
+	    echo "  FAIL: gerris2D $args $1"
+	    exit 1
+	fi
+	if mpirun -np 4 gerris2D $args -DNP=4 $1; then :
+	else
+	    echo "  FAIL: mpirun -np 4 gerris2D $args $1"
+	    exit 1
+	fi
+    done
+fi
+
+# total number of cells (leaves and their parents, over all the
+# processes) of the four quadtrees, which must be within [low,high]
+check()
+{
+    awk -v low=$2 -v high=$3 -v file=$1 '
+      /^Balance summary:/ { np = $3; }
+      /^  domain/ { leaves = np*$5; }
+      END {
+        cells = leaves + (leaves - 4)/3;
+        if (cells < low || cells > high) {
+          print file ": " cells " cells not in [" low "," high "]" > "/dev/stderr"
+          exit 1
+        }
+      }' < $1
+}
+
+for np in 1 4; do
+    if check balance-max-$np 2100 3600 && check balance-min-$np 2400 4500; then :
+    else
+	exit 1
+    fi
+done
@@ -0,0 +1,40 @@
+if test x$donotrun != xtrue; then
+    if gerris2D $1; then :
+    else
+	exit 1
+    fi
+fi
+
+# columns: 15 cycles, 16 instructions, 17 cache misses,
+# 18 branch misses, 19 ipc, 20 scheduled
+awk -F, '
+NR == 1 {
+  if ($20 != "scheduled") {
+    print "unexpected header: " $0 > "/dev/stderr"
+    status = 1
+  }
+}
+NR > 1 {
+  if ($20 < 0. || $20 > 1.) {
+    print $3 ": scheduled " $20 " not in [0,1]" > "/dev/stderr"
+    status = 1
+  }
+  for (i = 15; i <= 18; i++)
+    if ($i < 0. || ($20 == 0. && $i != 0.)) {
+      print $3 ": column " i " = " $i " with scheduled = " $20 > "/dev/stderr"
+      status = 1
+    }
+  ipc = $15 > 0. ? $16/$15 : 0.;
+  if ((ipc - $19)^2 > (1e-4*ipc)^2) {
+    print $3 ": ipc " $19 " != " ipc > "/dev/stderr"
+    status = 1
+  }
+  n++
+}
+END {
+  if (n == 0) {
+    print "no timers" > "/dev/stderr"
+    status = 1
+  }
+  exit status
+}' < counters.csv
@@ -0,0 +1,12 @@
+if test x$donotrun != xtrue; then
+    if gerris2D $1; then :
+    else
+	exit 1
+    fi
+fi
+
+if awk '{ if ($9 > 1e-2) { print $0; exit 1; } }' < error && \
+   awk '{ if ($9 > 1e-12) { print $0; exit 1; } }' < band; then :
+else
+    exit 1
+fi
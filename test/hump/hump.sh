@@ -0,0 +1,28 @@
+if test x$donotrun != xtrue; then
+    for local in 0 1; do
+	if gerris2D -DLOCAL=$local $1; then :
+	else
+	    exit 1
+	fi
+    done
+fi
+
+# CPU time of the global (gradients, predictor and corrector) and
+# local timestepping solvers
+awk -F, '
+  FNR == NR { if ($3 == "gradients" || $3 == "predictor" || $3 == "corrector") g += $7; next; }
+  { if ($3 == "local_timestepping") l += $7; }
+  END { printf ("%.2f & %.2f & %.2f \\\\ \\hline\n", g, l, l > 0. ? g/l : 0.) }' \
+    profile-0 profile-1 > timing.tex
+
+if awk '{ 
+      if (NR == 1) v0 = $5;
+      else if ($5 - v0 > 1e-12*v0 || v0 - $5 > 1e-12*v0) { print $0; exit 1; } 
+    }' < vol-1 && \
+   paste end-0.txt end-1.txt | awk '
+      /^#/ { next; }
+      { d = $4 - $8; if (d < 0.) d = -d; if (d > dmax) dmax = d; }
+      END { if (dmax > 1e-2) { print "local/global difference:", dmax; exit 1; } }'; then :
+else
+    exit 1
+fi
@@ -0,0 +1,16 @@
+if test x$donotrun != xtrue; then
+    rm -f bench error-2D error-3D
+    if gerris2D $1 && mv error error-2D && gerris3D $1 && mv error error-3D; then :
+    else
+	exit 1
+    fi
+fi
+
+awk '{ printf ("%dD & %.3g & %.3g & %.2f \\\\ \\hline\n", $1, $2, $3, $2 > 0. ? $3/$2 : 0.) }' \
+    < bench > bench.tex
+
+if awk '{ if ($9 != 0.) { print $0; exit 1; } }' < error-2D && \
+   awk '{ if ($9 != 0.) { print $0; exit 1; } }' < error-3D; then :
+else
+    exit 1
+fi
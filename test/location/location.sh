@@ -0,0 +1,76 @@
+if test x$donotrun != xtrue; then
+    awk 'BEGIN { for (j = 0; j <= 30; j++) print -0.15 + 0.02*j, 0.05, 0.; }' > locations
+    rm -f reference
+    if gerris2D $1; then :
+    else
+	exit 1
+    fi
+
+    awk 'BEGIN { for (i = 0; i < 100; i++) for (j = 0; j < 100; j++)
+                   print -0.495 + 0.01*i, -0.495 + 0.01*j, 0.; }' > probes
+    for mode in "0 1" "1 1" "0 0"; do
+	set -- $mode
+	if gerris2D -DBINARY=$1 -DINTERPOLATE=$2 bench.gfs; then :
+	else
+	    exit 1
+	fi
+    done
+
+    # a 19x19 grid of locations across the four boxes (and processes)
+    # of parallel.gfs, including the boundaries between boxes and
+    # their common corner
+    awk 'BEGIN { for (i = 0; i <= 18; i++) for (j = 0; j <= 18; j++)
+                   print i/10. - 0.4, j/10. - 0.4, 0.; }' > probes-parallel
+    if gerris2D -DNP=1 parallel.gfs; then :
+    else
+	exit 1
+    fi
+    if mpirun -np 4 gerris2D -DNP=4 parallel.gfs; then :
+    else
+	echo "  FAIL: mpirun -np 4 gerris2D parallel.gfs"
+	exit 1
+    fi
+fi
+
+# millions of locations per second of CPU time
+for f in profile-0-1 profile-1-1 profile-0-0; do
+    awk -F, '{ if ($3 == "GfsOutputLocation") printf ("%g\n", $7 > 0. ? 1e4*$6/$7/1e6 : 0.); }' < $f
+done | awk '{ printf ("%s%.2f", NR > 1 ? " & " : "", $1); } END { print " \\\\ \\hline"; }' \
+    > throughput.tex
+
+# cached values of T against the reference
+if awk '
+  FNR == NR { x[n] = $1; t[n++] = $2; next; }
+  /^# 1:t/ { for (i = 2; i <= NF; i++) { split ($i, a, ":"); if (a[2] == "T") c = a[1]; } next; }
+  {
+    if ($2 != x[m] || (d = $c - t[m]) > 1e-12 || d < -1e-12) {
+      print "location", $2, "time", $1, ":", $c, "instead of", t[m];
+      exit 1;
+    }
+    m++;
+  }
+  END { if (m != n) { print m, "values instead of", n; exit 1; } }' reference text; then :
+else
+    exit 1
+fi
+
+# binary values against the text values
+od -A n -v -t f8 -w8 binary | awk '{ print $1; }' > binary.txt
+if awk '!/^#/ { for (i = 1; i <= NF; i++) print $i; }' < text | paste - binary.txt | awk '
+  { 
+    d = $1 - $2; if (d < 0.) d = -d;
+    a = $1 < 0. ? -$1 : $1;
+    if (d > 1e-14*a) { print "text:", $1, "binary:", $2; exit 1; }
+  }
+  END { if (NR == 0) exit 1; }'; then :
+else
+    exit 1
+fi
+
+# parallel values against the serial values: each location is written
+# once, in the order of the list of locations
+if awk '!/^#/ { n[$1]++; } END { for (t in n) if (n[t] != 361) { print t, n[t]; exit 1; } }' \
+       < text-4 && cmp text-1 text-4 && cmp binary-1 binary-4; then :
+else
+    exit 1
+fi
@@ -0,0 +1,38 @@
+if test x$donotrun != xtrue; then
+    for morton in 0 1; do
+	if gerris2D -DMORTON=$morton $1 && \
+	   gerris2D -DMORTON=$morton cavity.gfs && \
+	   gerris2D -DMORTON=$morton poisson.gfs; then :
+	else
+	    exit 1
+	fi
+    done
+fi
+
+# cache misses and wall-clock time of the top-level timers
+rm -f bench.tex
+for case in advection cavity poisson; do
+    awk -F, -v name=$case '
+      FNR == 1 { file++; }
+      FNR > 1 && $5 == 0 { misses[file] += $17; wall[file] += $9; }
+      END {
+        printf ("%s & %.3g & %.3g & %.3g & %.3g \\\\ \\hline\n", name,
+                misses[1], misses[2], wall[1], wall[2]);
+      }' profile-$case-0 profile-$case-1 >> bench.tex
+done
+
+# order of the boxes written with the morton option
+order=`awk '/^GfsBox/ { for (i = 1; i < NF; i++) if ($i == "id") printf ("%s ", $(i + 2)); }' \
+           < end-1.gfs`
+if test "$order" != "1 5 2 6 3 7 4 8 "; then
+    echo "boxes written in order: $order"
+    exit 1
+fi
+
+# the cells are the same whatever the order of the boxes
+grep -v '^#' end-0.txt | sort > cells-0
+grep -v '^#' end-1.txt | sort > cells-1
+if cmp cells-0 cells-1; then :
+else
+    exit 1
+fi
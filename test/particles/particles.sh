@@ -0,0 +1,30 @@
+if test x$donotrun != xtrue; then
+    if gerris2D -DNP=1 $1; then :
+    else
+	echo "  FAIL: gerris2D $1"
+	exit 1
+    fi
+    if mpirun -np 4 gerris2D -DNP=4 $1; then :
+    else
+	echo "  FAIL: mpirun -np 4 gerris2D $1"
+	exit 1
+    fi
+fi
+
+# number of calls and maximum CPU time of the migration
+awk -F, '{ if ($3 == "particles_migrate") printf ("%d & %.3f \\\\ \\hline\n", $6, $14); }' \
+    < profile-4 > migrate.tex
+
+# particles written by each run, sorted by id
+for np in 1 4; do
+    awk '
+      /GfsParticle {/ { inside = 1; next; }
+      inside && /^}/ { inside = 0; }
+      inside { print $1, $2, $3, $4; }' < end-$np.gfs | sort -n > particles-$np
+done
+
+if test `wc -l < particles-1` = 16 && cmp particles-1 particles-4; then :
+else
+    diff particles-1 particles-4
+    exit 1
+fi
@@ -0,0 +1,39 @@
+if test x$donotrun != xtrue; then
+    if gerris2D $1; then :
+    else
+	exit 1
+    fi
+fi
+
+# the JSON and trace outputs must be valid JSON (the closing bracket
+# of the trace is optional)
+if python -c 'import json, sys; json.load (open (sys.argv[1]))' profile.json; then :
+else
+    exit 1
+fi
+echo "{}]" | cat trace.json - > trace-closed.json
+if python -c 'import json, sys; json.load (open (sys.argv[1]))' trace-closed.json; then :
+else
+    exit 1
+fi
+
+# self CPU time <= total CPU time and items counted by the solvers
+awk -F, '
+NR > 1 {
+  if ($8 > $7 + 1e-6) {
+    print $3 ": self " $8 " > cpu " $7 > "/dev/stderr"
+    status = 1
+  }
+  if (($3 == "poisson_solve" || $3 == "tracer_advection_diffusion") && $10 <= 0) {
+    print $3 ": no items" > "/dev/stderr"
+    status = 1
+  }
+  found[$3] = 1
+}
+END {
+  if (!found["poisson_solve"] || !found["tracer_advection_diffusion"]) {
+    print "missing timers" > "/dev/stderr"
+    status = 1
+  }
+  exit status
+}' < profile.csv
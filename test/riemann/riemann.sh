@@ -0,0 +1,38 @@
+if test x$donotrun != xtrue; then
+    for scheme in kinetic hllc; do
+	for batch in 0 1; do
+	    if gerris2D -DSCHEME=$scheme -DBATCH=$batch $1; then :
+	    else
+		exit 1
+	    fi
+	done
+    done
+fi
+
+# faces/second of the face flux stage of the predictor and corrector steps
+rm -f bench.tex
+for scheme in kinetic hllc; do
+    awk -F, -v scheme=$scheme '
+      FNR == 1 { file++; }
+      $3 == "fluxes" { items[file] += $10; wall[file] += $9; }
+      END { 
+        s = wall[1] > 0. ? items[1]/wall[1] : 0.;
+        b = wall[2] > 0. ? items[2]/wall[2] : 0.;
+        printf ("%s & %.3g & %.3g & %.2f \\\\ \\hline\n", scheme, s, b, s > 0. ? b/s : 0.);
+      }' profile-$scheme-0 profile-$scheme-1 >> bench.tex
+done
+
+for scheme in kinetic hllc; do
+    if paste end-$scheme-0.txt end-$scheme-1.txt | awk '
+      /^#/ { next; }
+      { 
+        for (i = 4; i <= 7; i++) {
+          d = $i - $(i + 7); if (d < 0.) d = -d;
+          if (d > dmax) dmax = d;
+        }
+      }
+      END { if (dmax > 1e-12) { print "batched/face-by-face difference:", dmax; exit 1; } }'; then :
+    else
+	exit 1
+    fi
+done
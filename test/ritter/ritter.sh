@@ -0,0 +1,21 @@
+if test x$donotrun != xtrue; then
+    for dir in 1 -1; do
+	if gerris2D -DDIR=$dir $1; then :
+	else
+	    exit 1
+	fi
+    done
+fi
+
+if awk '{ if ($5 > 1e-2) { print $0; exit 1; } }' < error-1 && \
+   paste error-1 error--1 | awk '{
+      d = $5 - $16; if (d < 0.) d = -d;
+      if (d > 1e-8) { print "asymmetric dam break:", $5, $16; exit 1; }
+    }' && \
+   awk '{ 
+      if (NR == 1) v0 = $5;
+      else if ($5 - v0 > 1e-12*v0 || v0 - $5 > 1e-12*v0) { print $0; exit 1; } 
+    }' < vol--1; then :
+else
+    exit 1
+fi
@@ -0,0 +1,16 @@
+if test x$donotrun != xtrue; then
+    if gerris2D $1; then :
+    else
+	exit 1
+    fi
+fi
+
+cat single-1 single-2 single-3 single-4 single-5 > singles
+if cmp singles list && cmp list rake && \
+   cmp list list-threads && cmp rake rake-threads && \
+   test `grep -c GfsStreamline list` = 5 && \
+   test `grep -c GfsStreamline grid` = 9 && \
+   test `grep -c "^0.10000000000000001 0.20000000000000001 0$" sim.gfs` = 1; then :
+else
+    exit 1
+fi
@@ -0,0 +1,24 @@
+if test x$donotrun != xtrue; then
+    for ntheta in 12 24; do
+	if gerris2D -DNTHETA=$ntheta $1; then :
+	else
+	    exit 1
+	fi
+    done
+fi
+
+rm -f throughput.tex
+for ntheta in 12 24; do
+    # calls, wall-clock time and throughput of the spatial advection
+    awk -F, -v n=$ntheta '{
+      if ($3 == "wave_advection") printf ("%d & %d & %.2f & %.3g \\\\ \\hline\n", n, $6, $9, $11);
+    }' < profile-$ntheta >> throughput.tex
+    # the total energy is conserved
+    if awk '{
+      if (NR == 1) e0 = $5;
+      else if ($5 - e0 > 1e-9*e0 || e0 - $5 > 1e-9*e0) { print $0; exit 1; }
+    }' < energy-$ntheta; then :
+    else
+	exit 1
+    fi
+done